@@ -35,7 +35,6 @@
 /** @endcond */
 
 #  include <stdio.h>
-#  include <regex.h>
 
 #  include <version.h>
 
@@ -44,14 +43,103 @@ extern "C" {
 #  endif
 
 /**
- * @brief struct for compiled regexes.
+ * @brief Enum for the version operators.
  */
-typedef struct lpatom_regex{
-     regex_t atom;     /**< @brief regex for matching a valid atom */
-     regex_t category; /**< @brief regex to check for a category string */
-     regex_t name;     /**< @brief regex to match the package name */
-     regex_t version;  /**< @brief regex to match the package version */
-} lpatom_regex_t;
+typedef enum {
+     LPA_OP_NONE = 0,           /**< @brief no operator */
+     LPA_OP_LT,                 /**< @brief @c < */
+     LPA_OP_LE,                 /**< @brief @c <= */
+     LPA_OP_EQ,                 /**< @brief @c = */
+     LPA_OP_GLOB,               /**< @brief @c = with a trailing @c * */
+     LPA_OP_TILDE,              /**< @brief @c ~ */
+     LPA_OP_GE,                 /**< @brief @c >= */
+     LPA_OP_GT                  /**< @brief @c > */
+} lpatom_op_t;
+
+/**
+ * @brief Enum for the blockers.
+ */
+typedef enum {
+     LPA_BLOCK_NONE = 0,        /**< @brief no blocker */
+     LPA_BLOCK_WEAK,            /**< @brief @c ! */
+     LPA_BLOCK_STRONG           /**< @brief @c !! */
+} lpatom_blocker_t;
+
+/**
+ * @brief Enum for the slot operators.
+ */
+typedef enum {
+     LPA_SLOT_NONE = 0,         /**< @brief no slot operator */
+     LPA_SLOT_EQ,               /**< @brief @c = */
+     LPA_SLOT_ANY               /**< @brief @c * */
+} lpatom_slotop_t;
+
+/**
+ * @brief Enum for the types of use dependencies.
+ */
+typedef enum {
+     LPA_USE_ENABLED = 0,       /**< @brief @c foo */
+     LPA_USE_DISABLED,          /**< @brief @c -foo */
+     LPA_USE_EQUAL,             /**< @brief @c foo= */
+     LPA_USE_NEQUAL,            /**< @brief @c !foo= */
+     LPA_USE_IF,                /**< @brief @c foo? */
+     LPA_USE_IFNOT              /**< @brief @c !foo? */
+} lpatom_usetype_t;
+
+/**
+ * @brief Enum for the defaults of use dependencies.
+ */
+typedef enum {
+     LPA_USEDEF_NONE = 0,       /**< @brief no default */
+     LPA_USEDEF_ENABLED,        /**< @brief @c (+) */
+     LPA_USEDEF_DISABLED        /**< @brief @c (-) */
+} lpatom_usedef_t;
+
+/**
+ * @brief A use dependency.
+ */
+typedef struct lpatom_usedep {
+     char *name;                /**< @brief the name of the use flag. */
+     lpatom_usetype_t type;     /**< @brief the type of the dependency. */
+     lpatom_usedef_t def;       /**< @brief the default of the flag. */
+} lpatom_usedep_t;
+
+/**
+ * @brief The position of a part of an atom string.
+ */
+typedef struct lpatom_field {
+     size_t off;                /**< @brief the offset from the start of the
+                                 * atom string. */
+     size_t len;                /**< @brief the length, @c 0 if the part is
+                                 * missing. */
+} lpatom_field_t;
+
+/**
+ * @brief A parsed atom that points into the string it was parsed from.
+ *
+ * Instead of copies of its parts, a view only stores where they are in the
+ * atom string, so parsing a view does not allocate any memory. The string
+ * has to stay valid as long as the view is used.
+ *
+ * All parts besides the version and the use dependencies are checked as
+ * thoroughly as by lpatom_parse(). The version is only checked for its syntax
+ * and the use dependencies are stored as a whole.
+ */
+typedef struct lpatom_view {
+     const char *src;           /**< @brief the atom string. */
+     size_t len;                /**< @brief the length of the atom string. */
+     lpatom_field_t cat;        /**< @brief the category. */
+     lpatom_field_t name;       /**< @brief the name. */
+     lpatom_field_t version;    /**< @brief the version. */
+     lpatom_field_t slot;       /**< @brief the slot. */
+     lpatom_field_t subslot;    /**< @brief the sub-slot. */
+     lpatom_field_t repo;       /**< @brief the repository. */
+     lpatom_field_t use;        /**< @brief the comma separated use
+                                 * dependencies without the brackets. */
+     lpatom_op_t op;            /**< @brief the version operator. */
+     lpatom_blocker_t blocker;  /**< @brief the blocker. */
+     lpatom_slotop_t slotop;    /**< @brief the slot operator. */
+} lpatom_view_t;
 
 /**
  * @brief The lpatom object handle.
@@ -59,16 +147,92 @@ typedef struct lpatom_regex{
  * This is the handle to be used for any function in this lib to store some
  * date.
  *
+ * The category and the name are interned with lputil_intern(), they are
+ * shared by all atoms and must not be freed. @c cat_id and @c name_id hold
+ * their symbol IDs, two atoms have the same category or name if and only if
+ * the IDs are equal.
+ *
+ * All other strings of a parsed atom and its use dependencies share a single
+ * memory block which starts at @c use. It is only allocated if the atom has a
+ * slot, a repository or use dependencies, otherwise @c use is @c NULL. If the
+ * handle was initialized with lpatom_init_arena(), this block and the version
+ * handle are allocated from the arena instead.
+ *
  * @warning do not allocate or free it yourself, use lpatom_create() or
  * lpversion_destroy().
  */
 typedef struct lpatom {
-     lpatom_regex_t regex;      /**< @brief compiled regexes. */
-     char *name;                /**< @brief the name. */
-     char *cat;                 /**< @brief the category. */
+     const char *name;          /**< @brief the name. */
+     const char *cat;           /**< @brief the category or @c NULL. */
      lpversion_t *version;      /**< @brief a version handle. */
+     char *slot;                /**< @brief the slot or @c NULL. */
+     char *subslot;             /**< @brief the sub-slot or @c NULL. */
+     char *repo;                /**< @brief the repository or @c NULL. */
+     lpatom_usedep_t *use;      /**< @brief array of use dependencies. */
+     size_t use_len;            /**< @brief the length of @c use. */
+     lpatom_op_t op;            /**< @brief the version operator. */
+     lpatom_blocker_t blocker;  /**< @brief the blocker. */
+     lpatom_slotop_t slotop;    /**< @brief the slot operator. */
+     uint32_t name_id;          /**< @brief the symbol ID of @c name. */
+     uint32_t cat_id;           /**< @brief the symbol ID of @c cat or @c 0.
+                                 */
+     /*@null@*/
+     lputil_arena_t *arena;     /**< @brief the arena the parsed atom is
+                                 * allocated from or @c NULL for
+                                 * malloc(3). */
 } lpatom_t;
 
+/**
+ * @brief An entry of a batch parsed by lpatom_parse_batch().
+ */
+typedef struct lpatom_batch_entry {
+     lpatom_t atom;             /**< @brief the parsed atom, only valid if
+                                 * @c error is @c 0. */
+     lpatom_field_t token;      /**< @brief the position of the atom string
+                                 * in the buffer. */
+     size_t line;               /**< @brief the line number, starting at
+                                 * @c 1. */
+     int error;                 /**< @brief @c 0 or the errno value
+                                 * lpatom_parse() failed with. */
+} lpatom_batch_entry_t;
+
+/**
+ * @brief The result of lpatom_parse_batch().
+ *
+ * @warning do not allocate or free it yourself, use lpatom_batch_destroy().
+ */
+typedef struct lpatom_batch {
+     lpatom_batch_entry_t *entries; /**< @brief one entry per atom. */
+     size_t len;                /**< @brief the number of entries. */
+     size_t failed;             /**< @brief the number of entries with an
+                                 * error. */
+     /** @brief the arenas of the workers, private. */
+     lputil_arena_t **arenas;
+     unsigned int arenas_len;   /**< @brief the number of arenas, private. */
+} lpatom_batch_t;
+
+/**
+ * @brief A version constraint compiled by lpatom_constraint_compile().
+ *
+ * The version of the atom is stored as a sort key, see lpversion_key(), so
+ * checking a candidate version is a single memcmp(3) against the candidate's
+ * key.
+ *
+ * @warning do not allocate or free the key yourself, use
+ * lpatom_constraint_reset().
+ */
+typedef struct lpatom_constraint {
+     lpatom_op_t op;            /**< @brief the version operator. */
+     uint8_t *key;              /**< @brief the sort key of the version or
+                                 * @c NULL if the atom has no version. */
+     size_t len;                /**< @brief the length of the key. */
+     size_t prefix;             /**< @brief the length of the key prefix
+                                 * that is compared by @c ~ and @c =*. */
+     unsigned int accept;       /**< @brief the accepted comparison results
+                                 * as a bitmask, bit @c 0 is lower, bit @c 1
+                                 * is equal and bit @c 2 is greater. */
+} lpatom_constraint_t;
+
 /**
  * @brief returns a new lpatom_t handle.
  *
@@ -97,9 +261,36 @@ typedef struct lpatom {
 extern lpatom_t *
 lpatom_create(void);
 
+/**
+ * @brief returns a new lpatom_t handle from an allocator.
+ *
+ * Like lpatom_create(), but the memory of the handle is obtained from
+ * @c alloc. The handle needs to be initialized before it is used and has to
+ * be destroyed with lpatom_destroy_alloc() and the same allocator.
+ *
+ * If an error occured, @c NULL is returned and @c errno is set to indicate
+ * the error.
+ *
+ * @param alloc the allocator or @c NULL for malloc(3).
+ *
+ * @return a pointer to a lpatom_t handle or @c NULL if an error has occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the allocator.
+ *
+ * @sa lputil_alloc_init_arena(), lputil_alloc_init_pool()
+ */
+extern lpatom_t *
+lpatom_create_alloc(const lputil_alloc_t *alloc);
+
 /**
  * @brief Initializes a lpatom_t handle.
  *
+ * This function only sets the members of the handle to their defaults and
+ * does not allocate any memory.
+ *
  * If you want to initialize an already used handle, use lpatom_reset()
  *
  * @param handle a lpatom_t handle to initialize.
@@ -109,6 +300,27 @@ lpatom_create(void);
 extern void
 lpatom_init(lpatom_t *handle);
 
+/**
+ * @brief Initializes a lpatom_t handle that allocates from an arena.
+ *
+ * Works like lpatom_init(), but lpatom_parse() takes all memory for the
+ * parsed atom, including its version handle, from the given arena. This
+ * memory is released together with the arena, lpatom_reset() and
+ * lpatom_destroy() do not free it. The handle keeps the arena when it is
+ * reset.
+ *
+ * The handle itself may be allocated from the arena as well, in that case it
+ * must not be passed to lpatom_destroy().
+ *
+ * @param handle a lpatom_t handle to initialize.
+ *
+ * @param arena the lputil_arena_t handle to allocate from.
+ *
+ * @sa lpatom_init(), lputil_arena_create().
+ */
+extern void
+lpatom_init_arena(lpatom_t *handle, lputil_arena_t *arena);
+
 /**
  * @brief resets an lpatom_t handle.
  *
@@ -122,7 +334,13 @@ lpatom_reset(lpatom_t *handle);
 /**
  * @brief parses an atom string.
  *
- * The given string must be a valid gentoo atom with or without version.
+ * The given string must be a valid gentoo atom with or without version. Full
+ * dependency atoms are understood as well, eg.
+ * @c !!>=cat/pkg-1.0:2/2.1=::gentoo[foo,-bar?], the parts besides category,
+ * name and version are stored in the corresponding members of the handle.
+ *
+ * A version operator requires a version, the @c * suffix is only allowed
+ * together with the @c = operator.
  *
  * If an error occured, \c -1 is returned and \c errno is set to indicate the
  * error.
@@ -138,14 +356,178 @@ lpatom_reset(lpatom_t *handle);
  * @b Errors:
  * 
  * - @c EINVAL s is not a valid package atom.
+ * - @c ERANGE one of the numbers in the version is too big.
  * - This function may also fail and set errno for any of the errors specified
  *   for the routine malloc(3).
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine strdup(3). 
  */
 extern int
 lpatom_parse(lpatom_t *handle, const char *s);
 
+/**
+ * @brief parses an atom string of a given length.
+ *
+ * Works like lpatom_parse() but takes the length of the string, so an atom
+ * can be parsed straight out of a bigger buffer.
+ *
+ * If an error occured, \c -1 is returned and \c errno is set to indicate the
+ * error.
+ *
+ * @param handle a lpatom_t handle.
+ * @param s an atom string, does not need to be @c nul terminated.
+ * @param len the length of the atom string.
+ *
+ * @return @c 0 if sucessful or @c -1 if an error occured
+ *
+ * @sa lpatom_parse()
+ *
+ * @b Errors:
+ * 
+ * - @c EINVAL s is not a valid package atom.
+ * - @c ERANGE one of the numbers in the version is too big.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+extern int
+lpatom_parse_len(lpatom_t *handle, const char *s, size_t len);
+
+/**
+ * @brief parses an atom string into a view.
+ *
+ * Checks the atom string and stores the positions of its parts in the view,
+ * no memory is allocated. The parts can be compared with lpatom_view_eq()
+ * and copied with lpatom_view_strdup(), the version can be parsed with
+ * lpatom_view_version(). To get a full lpatom_t handle, pass @c src and
+ * @c len of the view to lpatom_parse_len().
+ *
+ * If an error occured, \c -1 is returned and \c errno is set to indicate the
+ * error.
+ *
+ * @param view the lpatom_view_t object to fill.
+ * @param s an atom string, does not need to be @c nul terminated.
+ * @param len the length of the atom string.
+ *
+ * @return @c 0 if sucessful or @c -1 if an error occured
+ *
+ * @sa lpatom_parse_len()
+ *
+ * @b Errors:
+ * 
+ * - @c EINVAL s is not a valid package atom.
+ */
+extern int
+lpatom_view_parse(lpatom_view_t *view, const char *s, size_t len);
+
+/**
+ * @brief returns a part of a view as a span.
+ *
+ * @param view a parsed lpatom_view_t object.
+ * @param field a field of the view, eg. @c &view->name.
+ *
+ * @return the part, pointing into the source string of the view, its start
+ * is @c NULL if the part is missing.
+ */
+extern lputil_span_t
+lpatom_view_span(const lpatom_view_t *view, const lpatom_field_t *field);
+
+/**
+ * @brief compares a part of a view with a string.
+ *
+ * @param view a parsed lpatom_view_t object.
+ * @param field a field of the view, eg. @c &view->name.
+ * @param s a @c nul terminated string.
+ *
+ * @return @c 1 if the part exists and equals @c s, @c 0 otherwise.
+ */
+extern int
+lpatom_view_eq(const lpatom_view_t *view, const lpatom_field_t *field,
+               const char *s);
+
+/**
+ * @brief copies a part of a view into a new string.
+ *
+ * The memory for the returned string is obtained by malloc(3) and can be
+ * freed with free(3).
+ *
+ * If an error occured, \c NULL is returned and \c errno is set to indicate
+ * the error.
+ *
+ * @param view a parsed lpatom_view_t object.
+ * @param field a field of the view, eg. @c &view->cat.
+ *
+ * @return the @c nul terminated copy or @c NULL.
+ *
+ * @b Errors:
+ *
+ * - @c ENOENT the part is missing.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+extern char *
+lpatom_view_strdup(const lpatom_view_t *view, const lpatom_field_t *field);
+
+/**
+ * @brief parses the version of a view.
+ *
+ * If an error occured, \c -1 is returned and \c errno is set to indicate the
+ * error.
+ *
+ * @param view a parsed lpatom_view_t object.
+ * @param handle an initialized lpversion_t handle.
+ *
+ * @return @c 0 if sucessful or @c -1 if an error occured
+ *
+ * @sa lpversion_parse_len()
+ *
+ * @b Errors:
+ *
+ * - @c ENOENT the atom has no version.
+ * - @c ERANGE one of the numbers in the version is too big.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+extern int
+lpatom_view_version(const lpatom_view_t *view, lpversion_t *handle);
+
+/**
+ * @brief parses all atoms of a newline separated buffer.
+ *
+ * Every line that is neither empty nor starts with a @c # holds an atom,
+ * leading white space is skipped and the atom ends at the next white space,
+ * so files like @c world or @c package.use can be parsed directly. Trailing
+ * data on a line is ignored.
+ *
+ * The atoms are parsed by up to @c threads threads, each one allocating from
+ * an arena of its own. Lines that are not valid atoms do not stop the
+ * parsing, their entries carry the error.
+ *
+ * If an error occured, \c NULL is returned and \c errno is set to indicate
+ * the error.
+ *
+ * @param buf the buffer, does not need to be @c nul terminated.
+ * @param len the length of the buffer.
+ * @param threads the maximum number of threads or @c 0 for the number of
+ * online processors.
+ *
+ * @return a lpatom_batch_t object or @c NULL if an error occured.
+ *
+ * @sa lpatom_parse(), lpatom_batch_destroy()
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern lpatom_batch_t *
+lpatom_parse_batch(const char *buf, size_t len, unsigned int threads);
+
+/**
+ * @brief destroys a lpatom_batch_t object and all atoms in it.
+ *
+ * @param batch a lpatom_batch_t object as returned by lpatom_parse_batch().
+ */
+extern void
+lpatom_batch_destroy(lpatom_batch_t *batch);
+
 /**
  * @brief destroys an lpatom_t object.
  *
@@ -163,6 +545,20 @@ lpatom_parse(lpatom_t *handle, const char *s);
 extern void
 lpatom_destroy(lpatom_t *atom);
 
+/**
+ * @brief destroys a lpatom_t handle returned by lpatom_create_alloc().
+ *
+ * Releases the members of the handle like lpatom_destroy() and the handle
+ * itself to the allocator. If a @c NULL pointer was given, this function
+ * will just return.
+ *
+ * @param handle a lpatom_t handle.
+ *
+ * @param alloc the allocator the handle was created with.
+ */
+extern void
+lpatom_destroy_alloc(lpatom_t *handle, const lputil_alloc_t *alloc);
+
 /**
  * @brief compare two lpatom_t data structures.
  *
@@ -172,6 +568,9 @@ lpatom_destroy(lpatom_t *atom);
  *
  * This function can directly be used in qsort(3).
  *
+ * Categories and names are only compared as strings if their symbol IDs
+ * differ.
+ *
  * @param atom1 the first lpatom_t struct which is going to be compared.
  *
  * @param atom2 the second lpatom_t struct which is being compared to atom1.
@@ -183,6 +582,83 @@ lpatom_destroy(lpatom_t *atom);
 extern int
 lpatom_cmp(const lpatom_t *atom1, const lpatom_t *atom2);
 
+/**
+ * @brief compare two lpatom_t data structures by their symbol IDs.
+ *
+ * Works like lpatom_cmp(), but orders categories and names by their symbol
+ * IDs instead of alphabetically, so no strings are touched at all. The
+ * order is consistent within a process, but depends on the order in which
+ * the names were first seen. Use it to sort atoms for deduplication or
+ * grouping.
+ *
+ * @param atom1 the first lpatom_t struct which is going to be compared.
+ *
+ * @param atom2 the second lpatom_t struct which is being compared to atom1.
+ *
+ * @return an integer less than, equal to, or greater than zero.
+ *
+ * @sa lpatom_cmp()
+ */
+extern int
+lpatom_cmp_id(const lpatom_t *atom1, const lpatom_t *atom2);
+
+/**
+ * @brief encodes the category, name and version of an atom into a binary
+ * sort key.
+ *
+ * The key consists of the category, a @c nul byte, the name, a @c nul byte
+ * and the key of the version, see lpversion_key(). Their order as given by
+ * memcmp(3), with a key that is a prefix of another one sorting first,
+ * equals the order of lpatom_cmp() for atoms that all have a category and a
+ * version. An atom without a category sorts like one with an empty
+ * category, an atom without a version in front of all versions of the same
+ * package.
+ *
+ * Like snprintf(3), at most @c len bytes are written to @c buf and the
+ * length of the complete key is returned.
+ *
+ * @param handle a lpatom handle.
+ *
+ * @param buf the buffer the key is written to, may be @c NULL if @c len is
+ * @c 0.
+ *
+ * @param len the size of @c buf in bytes.
+ *
+ * @return the length of the key in bytes.
+ *
+ * @sa lpatom_cmp(), lpatom_sort()
+ */
+extern size_t
+lpatom_key(const lpatom_t *handle, void *buf, size_t len);
+
+/**
+ * @brief sorts an array of atoms.
+ *
+ * The atoms are sorted by their keys, see lpatom_key(), atoms with equal
+ * keys keep their relative order. This replaces qsort(3) with lpatom_cmp(),
+ * but every key is built only once and big arrays are sorted by several
+ * threads, see lputil_keysort().
+ *
+ * If an error occurs, @c -1 is returned, @c errno is set to indicate the
+ * error and the array is left unchanged.
+ *
+ * @param atoms an array of parsed atoms.
+ *
+ * @param n the number of atoms.
+ *
+ * @param threads the maximum number of threads or @c 0 for the number of
+ * online processors.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern int
+lpatom_sort(const lpatom_t **atoms, size_t n, unsigned int threads);
+
 /**
  * @brief compiles a lpatom handle into a @c null terminated C string.
  *
@@ -192,10 +668,160 @@ lpatom_cmp(const lpatom_t *atom1, const lpatom_t *atom2);
  * @param handle a lpatom handle.
  *
  * @return a @c null terminated C string with the compiled version.
+ *
+ * @sa lpatom_compile_into()
  */
 extern char *
 lpatom_compile(const lpatom_t *handle);
 
+/**
+ * @brief compiles a lpatom handle into a given buffer.
+ *
+ * Like snprintf(3), at most @c cap bytes including the terminating @c nul
+ * character are written to @c buf and the length of the complete atom
+ * string without the @c nul character is returned. If it is not smaller
+ * than @c cap, the string was truncated and the function needs to be called
+ * again with a bigger buffer. No memory is allocated.
+ *
+ * @param handle a lpatom handle.
+ *
+ * @param buf the buffer, may be @c NULL if @c cap is @c 0.
+ *
+ * @param cap the size of @c buf in bytes.
+ *
+ * @return the length of the atom string.
+ *
+ * @sa lpatom_compile(), lpversion_compile_into()
+ */
+extern size_t
+lpatom_compile_into(const lpatom_t *handle, char *buf, size_t cap);
+
+/**
+ * @brief appends the compiled atom string to a string builder.
+ *
+ * Many atoms can be written into a single builder this way, eg. to
+ * assemble a file, without allocating a string for every one of them.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param handle a lpatom handle.
+ *
+ * @param sb an initialized string builder.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @sa lpatom_compile_into(), lputil_strbuf_init()
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern int
+lpatom_compile_buf(const lpatom_t *handle, lputil_strbuf_t *sb);
+
+/**
+ * @brief compiles the version constraint of an atom.
+ *
+ * The version and the operator of the atom are turned into a predicate that
+ * can be checked with lpatom_constraint_match() without parsing or
+ * comparing any version strings. An atom without a version matches every
+ * version, an atom with a version but without an operator is handled like
+ * @c =. The @c =* operator compares version components, not characters, so
+ * @c =cat/foo-1.2* matches @c 1.2.3 and @c 1.2_rc1 but not @c 1.20.
+ *
+ * The constraint does not reference the atom, it has to be released with
+ * lpatom_constraint_reset().
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param c the constraint to initialize.
+ *
+ * @param atom a parsed atom.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern int
+lpatom_constraint_compile(lpatom_constraint_t *c, const lpatom_t *atom);
+
+/**
+ * @brief frees the memory of a constraint.
+ *
+ * @param c a constraint initialized by lpatom_constraint_compile().
+ */
+extern void
+lpatom_constraint_reset(lpatom_constraint_t *c);
+
+/**
+ * @brief checks a version sort key against a constraint.
+ *
+ * @param c a compiled constraint.
+ *
+ * @param key a key returned by lpversion_key().
+ *
+ * @param len the length of the key.
+ *
+ * @return @c 1 if the version matches or @c 0 if it does not.
+ */
+extern int
+lpatom_constraint_match(const lpatom_constraint_t *c, const void *key,
+                        size_t len);
+
+/**
+ * @brief checks a version against a constraint.
+ *
+ * The key of the version is built on the stack, so this is only worth it
+ * for single checks, use lpatom_constraint_filter() with precomputed keys
+ * for many versions.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param c a compiled constraint.
+ *
+ * @param v a parsed version.
+ *
+ * @return @c 1 if the version matches, @c 0 if it does not or @c -1 if an
+ * error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern int
+lpatom_constraint_match_version(const lpatom_constraint_t *c,
+                                const lpversion_t *v);
+
+/**
+ * @brief checks many version sort keys against a constraint.
+ *
+ * @param c a compiled constraint.
+ *
+ * @param keys an array of @c n keys returned by lpversion_key().
+ *
+ * @param lens the lengths of the keys.
+ *
+ * @param n the number of keys.
+ *
+ * @param mask an array of @c n bytes, each one is set to @c 1 if the
+ * corresponding key matches and to @c 0 if it does not. May be @c NULL if
+ * only the number of matches is needed.
+ *
+ * @return the number of matching keys.
+ */
+extern size_t
+lpatom_constraint_filter(const lpatom_constraint_t *c,
+                         const void *const *keys, const size_t *lens,
+                         size_t n, uint8_t *mask);
+
 #  ifdef __cplusplus
 }
 #  endif
@@ -35,12 +35,65 @@
 /** @endcond */
 
 #  include <regex.h>
+#  include <sys/types.h>
 #  include <stdint.h>
 
 #  ifdef __cplusplus
 extern "C" {
 #  endif
 
+/**
+ * @brief A part of a string that is not copied.
+ *
+ * The span points into a string owned by someone else and is only valid as
+ * long as that string is. It is not @c nul terminated, use
+ * lputil_span_strdup() to get an owned copy.
+ */
+typedef struct lputil_span {
+     const char *s;             /**< @brief the start or @c NULL if the part
+                                 * is missing. */
+     size_t len;                /**< @brief the length of the part. */
+} lputil_span_t;
+
+/**
+ * @brief A tokenizer that splits a string without copying it.
+ *
+ * @warning the members are private, use lputil_tok_init() and
+ * lputil_tok_next().
+ */
+typedef struct lputil_tok {
+     const char *p;             /**< @brief the start of the next token or
+                                 * @c NULL if there is none. */
+     const char *end;           /**< @brief the end of the string. */
+     const char *delim;         /**< @brief the delimiter. */
+     size_t dlen;               /**< @brief the length of the delimiter. */
+} lputil_tok_t;
+
+/**
+ * @brief the number of bytes a lputil_strbuf_t holds before it has to use
+ * the heap.
+ */
+#  define LPUTIL_STRBUF_INLINE  64
+
+/**
+ * @brief A growable string builder.
+ *
+ * Short strings are kept in the builder itself, longer ones on the heap,
+ * whose size is doubled whenever it is too small. The string is always
+ * @c nul terminated.
+ *
+ * @warning the members are private, use lputil_strbuf_init(),
+ * lputil_strbuf_str() and lputil_strbuf_reset().
+ */
+typedef struct lputil_strbuf {
+     char *heap;                /**< @brief the string if it does not fit
+                                 * into @c small or @c NULL. */
+     size_t len;                /**< @brief the length of the string. */
+     size_t cap;                /**< @brief the size of the storage. */
+     /** @brief the inline storage. */
+     char small[LPUTIL_STRBUF_INLINE];
+} lputil_strbuf_t;
+
 /**
  * @brief Get regexp match
  *
@@ -98,9 +151,9 @@ lputil_substr(const char *s, size_t off, size_t len);
 /**
  * @brief Split a String into tokens.
  *
- * Splits a string into tokens with a given delimiter. Delimiter Characters at
- * the Start or the End of the String are ignored. Memory for the returned
- * Data is obtained by malloc(3) and can be freed with free(3).
+ * Splits a string into tokens at every occurence of a given delimiter, empty
+ * tokens are kept. Memory for the returned Data is obtained by malloc(3) and
+ * can be freed with free(3).
  *
  * If you want to free the returned data, you can so so by using
  * lputil_splitstr_destroy().
@@ -109,24 +162,147 @@ lputil_substr(const char *s, size_t off, size_t len);
  * error.
  *
  * @param s the string to be parsed.
- * @param delim a set of characters that delim the tokens in the parsed
- * string.
+ * @param delim the string that delims the tokens in the parsed string.
  *
  * @return a array of c strings which is terminated by the value \c NULL.
  *
- * @sa strtok(3), lputil_splitstr_destroy()
+ * @sa lputil_tok_init(), lputil_splitstr_destroy()
  *
  * @b Errors:
  * 
  * - \c EINVAL one or both of the given pointers are \c NULL
  * - This routine may also fail and set errno for any of the errors specified
  *   for the routine malloc(3).
- * - This routine may also fail and set errno for any of the errors specified
- *   for the routine strdup(3).
  */
 extern char **
 lputil_splitstr(const char *s, const char *delim);
 
+/**
+ * @brief Get regexp match without copying it.
+ *
+ * Like lputil_get_re_match(), but returns the position of the match in the
+ * matched string instead of a copy.
+ *
+ * @param match a array of regmatch_t objects as used by regexec(3).
+ * @param n the wanted element starting by 0 for the first element.
+ * @param s the string that was matched by regexec(3).
+ *
+ * @return the match, its start is @c NULL if the element did not take part
+ * in the match.
+ *
+ * @sa lputil_get_re_match(), lputil_span_strdup()
+ */
+extern lputil_span_t
+lputil_get_re_match_span(const regmatch_t *match, int n, const char *s);
+
+/**
+ * @brief Get a substring without copying it.
+ *
+ * Like lputil_substr(), the substring is not checked to be inside the
+ * borders of the given string.
+ *
+ * @param s the string of which we want the substring
+ * @param off the start of the substring
+ * @param len the length of the substring
+ *
+ * @return the substring.
+ *
+ * @sa lputil_substr(), lputil_span_strdup()
+ */
+extern lputil_span_t
+lputil_substr_span(const char *s, size_t off, size_t len);
+
+/**
+ * @brief Split a String into tokens without copying them.
+ *
+ * Splits the string at every occurence of @c delim, like lputil_splitstr().
+ * Empty tokens are kept, so a string with @c n delimiters always has
+ * @c n+1 tokens. Like snprintf(3), at most @c max tokens are stored in
+ * @c spans and the number of all tokens is returned, so the function can be
+ * called with @c max set to @c 0 to count them first.
+ *
+ * @param s the string to be split, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ * @param delim the @c nul terminated delimiter, if it is empty the whole
+ * string is a single token.
+ * @param spans the tokens are stored here, may be @c NULL if @c max is
+ * @c 0.
+ * @param max the size of @c spans.
+ *
+ * @return the number of tokens.
+ *
+ * @sa lputil_splitstr()
+ */
+extern size_t
+lputil_splitstr_span(const char *s, size_t len, const char *delim,
+                     lputil_span_t *spans, size_t max);
+
+/**
+ * @brief initializes a tokenizer.
+ *
+ * The tokens are the parts of the string between the occurences of
+ * @c delim, they are returned one by one by lputil_tok_next(). Nothing is
+ * allocated or copied, the string and the delimiter have to stay valid as
+ * long as the tokenizer is used. Empty tokens are kept, so a string with
+ * @c n delimiters always has @c n+1 tokens, like with lputil_splitstr().
+ *
+ * @param tok the tokenizer.
+ * @param s the string to be split, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ * @param delim the @c nul terminated delimiter, if it is empty the whole
+ * string is a single token.
+ */
+extern void
+lputil_tok_init(lputil_tok_t *tok, const char *s, size_t len,
+                const char *delim);
+
+/**
+ * @brief returns the next token.
+ *
+ * Single character delimiters are searched with memchr(3), which is
+ * vectorized by most C libraries. For longer delimiters memchr(3) finds the
+ * candidates and the rest is compared.
+ *
+ * @param tok a tokenizer initialized by lputil_tok_init().
+ * @param span the token is stored here.
+ *
+ * @return @c 1 if a token was stored or @c 0 if there are no more tokens.
+ */
+extern int
+lputil_tok_next(lputil_tok_t *tok, lputil_span_t *span);
+
+/**
+ * @brief copies a span into a new string.
+ *
+ * The memory for the returned string is obtained by malloc(3) and can be
+ * freed with free(3).
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param span the span to copy.
+ *
+ * @return the @c nul terminated copy.
+ *
+ * @b Errors:
+ * - @c EINVAL the start of the span is @c NULL.
+ * - This routine may also fail and set errno for any of the errors specified
+ *    for the routine malloc(3).
+ */
+extern char *
+lputil_span_strdup(lputil_span_t span);
+
+/**
+ * @brief compares a span with a string.
+ *
+ * @param span the span, a missing one equals no string.
+ * @param s a @c nul terminated string.
+ *
+ * @return @c 1 if both are equal or @c 0 if they are not.
+ */
+extern int
+lputil_span_eq(lputil_span_t span, const char *s);
+
 /**
  * @brief joins tokens into a String.
  *
@@ -201,6 +377,880 @@ lputil_intlen(int d);
 size_t
 lputil_int64len(int64_t d);
 
+/**
+ * @brief calculates the length in digits of an unsigned 64bit integer.
+ *
+ * The length is derived from the bit length of the number and a table of
+ * powers of ten, no division is needed.
+ *
+ * @param v the number.
+ *
+ * @return the number of decimal digits of @c v.
+ */
+extern size_t
+lputil_u64len(uint64_t v);
+
+/**
+ * @brief formats an unsigned 64bit integer.
+ *
+ * Writes the decimal digits of the number, two at a time, and returns their
+ * number. Unlike sprintf(3) this does not depend on the locale.
+ *
+ * @param buf a buffer of at least 20 bytes, the digits are not @c nul
+ * terminated.
+ * @param v the number.
+ *
+ * @return the number of digits written.
+ *
+ * @sa lputil_u64len()
+ */
+extern size_t
+lputil_u64toa(char *buf, uint64_t v);
+
+/**
+ * @brief formats a signed 64bit integer.
+ *
+ * Like lputil_u64toa(), with a leading @c - for negative numbers.
+ *
+ * @param buf a buffer of at least 20 bytes, the characters are not @c nul
+ * terminated.
+ * @param v the number.
+ *
+ * @return the number of characters written.
+ *
+ * @sa lputil_int64len()
+ */
+extern size_t
+lputil_i64toa(char *buf, int64_t v);
+
+/**
+ * @brief an arena allocator.
+ *
+ * Hands out memory from big chunks obtained by malloc(3). Single allocations
+ * can not be freed, instead all of them are released at once with
+ * lputil_arena_reset() or lputil_arena_destroy().
+ *
+ * @warning do not allocate or free it yourself, use lputil_arena_create() and
+ * lputil_arena_destroy().
+ */
+typedef struct lputil_arena lputil_arena_t;
+
+/**
+ * @brief returns a new lputil_arena_t handle.
+ *
+ * The memory for the first chunk is allocated together with the handle,
+ * further chunks are allocated when needed.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param size the size of a chunk in bytes or @c 0 for a default size.
+ *
+ * @return a pointer to a lputil_arena_t handle or @c NULL if an error has
+ * occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern lputil_arena_t *
+lputil_arena_create(size_t size);
+
+/**
+ * @brief allocates memory from an arena.
+ *
+ * The returned memory is suitably aligned for any kind of variable and stays
+ * valid until the arena is reset or destroyed. Allocations bigger than a
+ * quarter of the chunk size get a chunk of their own.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param arena a lputil_arena_t handle.
+ * @param len the number of bytes to allocate.
+ *
+ * @return a pointer to the allocated memory or @c NULL if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern void *
+lputil_arena_alloc(lputil_arena_t *arena, size_t len);
+
+/**
+ * @brief copies a string into an arena.
+ *
+ * Copies at most @c len characters of @c s and terminates the copy with a
+ * @c nul character.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param arena a lputil_arena_t handle.
+ * @param s the string to copy, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return the copied string or @c NULL if an error occured.
+ *
+ * @sa strndup(3)
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern char *
+lputil_arena_strndup(lputil_arena_t *arena, const char *s, size_t len);
+
+/**
+ * @brief releases all memory allocated from an arena.
+ *
+ * All chunks but the first one are freed, the arena can be used again
+ * afterwards.
+ *
+ * @param arena a lputil_arena_t handle.
+ */
+extern void
+lputil_arena_reset(lputil_arena_t *arena);
+
+/**
+ * @brief destroys a lputil_arena_t handle and all memory allocated from it.
+ *
+ * @param arena a lputil_arena_t handle.
+ */
+extern void
+lputil_arena_destroy(lputil_arena_t *arena);
+
+/**
+ * @brief the parts of the library that allocation statistics are kept for.
+ */
+typedef enum {
+     LPUTIL_MEM_UTIL = 0,       /**< @brief the helpers of util.h. */
+     LPUTIL_MEM_ATOM,           /**< @brief atoms. */
+     LPUTIL_MEM_VERSION,        /**< @brief versions. */
+     LPUTIL_MEM_XPAK,           /**< @brief xpak blobs. */
+     LPUTIL_MEM_ARCHIVE,        /**< @brief archives. */
+     LPUTIL_MEM_MAX             /**< @brief the number of parts. */
+} lputil_mem_subsys_t;
+
+/**
+ * @brief the functions all memory of the library is allocated with.
+ *
+ * They have the semantics of malloc(3), realloc(3) and free(3).
+ */
+typedef struct lputil_memhooks {
+     void *(*alloc)(size_t len); /**< @brief allocates memory. */
+     /** @brief resizes memory. */
+     void *(*resize)(void *p, size_t len);
+     void (*release)(void *p);  /**< @brief frees memory. */
+} lputil_memhooks_t;
+
+/**
+ * @brief allocation statistics of a part of the library.
+ */
+typedef struct lputil_memstat {
+     uint64_t allocs;           /**< @brief the successful allocations. */
+     uint64_t reallocs;         /**< @brief the successful reallocations. */
+     uint64_t frees;            /**< @brief the freed memory blocks. */
+     uint64_t bytes;            /**< @brief the bytes requested by all
+                                 * successful allocations and
+                                 * reallocations. */
+} lputil_memstat_t;
+
+/**
+ * @brief replaces the functions the library allocates memory with.
+ *
+ * The hooks have to be set before the library allocates anything, memory
+ * allocated with one set of hooks must not be freed by another. Memory that
+ * is allocated by other libraries, eg. by regcomp(3) or libarchive, is not
+ * covered. Strings and arrays the library hands to the caller come from the
+ * hooks too, with hooks that are not compatible to free(3) they have to be
+ * released with lputil_mem_free().
+ *
+ * @param hooks the new hooks or @c NULL for the ones of the C library.
+ */
+extern void
+lputil_mem_set_hooks(const lputil_memhooks_t *hooks);
+
+/**
+ * @brief turns the allocation statistics on or off.
+ *
+ * They are off by default. When they are on, every allocation updates the
+ * counters of its part of the library with atomic operations, so they can
+ * be read by lputil_mem_stat() at any time and from any thread.
+ *
+ * @param enable non-zero to turn them on, @c 0 to turn them off.
+ */
+extern void
+lputil_mem_set_counting(int enable);
+
+/**
+ * @brief returns the allocation statistics of a part of the library.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error.
+ *
+ * @param subsys the part of the library.
+ * @param stat the statistics are stored here.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL @c subsys is unknown.
+ */
+extern int
+lputil_mem_stat(lputil_mem_subsys_t subsys, lputil_memstat_t *stat);
+
+/**
+ * @brief sets all allocation statistics to zero.
+ */
+extern void
+lputil_mem_stat_reset(void);
+
+/**
+ * @brief allocates memory with the hooks and counts it.
+ *
+ * This and the following functions are used for all allocations inside the
+ * library.
+ *
+ * @param subsys the part of the library that allocates.
+ * @param len the number of bytes.
+ *
+ * @return like malloc(3).
+ */
+extern void *
+lputil_mem_malloc(lputil_mem_subsys_t subsys, size_t len);
+
+/**
+ * @brief allocates zeroed memory with the hooks and counts it.
+ *
+ * @param subsys the part of the library that allocates.
+ * @param n the number of elements.
+ * @param size the size of an element.
+ *
+ * @return like calloc(3).
+ */
+extern void *
+lputil_mem_calloc(lputil_mem_subsys_t subsys, size_t n, size_t size);
+
+/**
+ * @brief resizes memory with the hooks and counts it.
+ *
+ * @param subsys the part of the library that allocates.
+ * @param p the memory or @c NULL.
+ * @param len the new number of bytes.
+ *
+ * @return like realloc(3).
+ */
+extern void *
+lputil_mem_realloc(lputil_mem_subsys_t subsys, void *p, size_t len);
+
+/**
+ * @brief frees memory with the hooks and counts it.
+ *
+ * @param subsys the part of the library that frees.
+ * @param p the memory or @c NULL.
+ */
+extern void
+lputil_mem_free(lputil_mem_subsys_t subsys, void *p);
+
+/**
+ * @brief copies a string into memory from the hooks and counts it.
+ *
+ * @param subsys the part of the library that allocates.
+ * @param s a @c nul terminated string.
+ *
+ * @return like strdup(3).
+ */
+extern char *
+lputil_mem_strdup(lputil_mem_subsys_t subsys, const char *s);
+
+/**
+ * @brief a pool of objects of the same size.
+ *
+ * Freed objects are kept in a free list and handed out again by the next
+ * allocation, so long running programs can reuse the memory of objects they
+ * create and destroy repeatedly. The objects are carved out of an arena and
+ * all of them are released at once by lputil_pool_reset() or
+ * lputil_pool_destroy(). A pool is not thread safe.
+ *
+ * @warning do not allocate or free it yourself, use lputil_pool_create() and
+ * lputil_pool_destroy().
+ */
+typedef struct lputil_pool lputil_pool_t;
+
+/**
+ * @brief returns a new lputil_pool_t handle.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param size the size of the objects in bytes.
+ *
+ * @return a pointer to a lputil_pool_t handle or @c NULL if an error has
+ * occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern lputil_pool_t *
+lputil_pool_create(size_t size);
+
+/**
+ * @brief allocates an object from a pool.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param pool a lputil_pool_t handle.
+ *
+ * @return a pointer to the object, suitably aligned for any type.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern void *
+lputil_pool_alloc(lputil_pool_t *pool);
+
+/**
+ * @brief returns an object to a pool.
+ *
+ * @param pool a lputil_pool_t handle.
+ * @param p an object allocated from @c pool or @c NULL.
+ */
+extern void
+lputil_pool_free(lputil_pool_t *pool, void *p);
+
+/**
+ * @brief releases all objects of a pool.
+ *
+ * @param pool a lputil_pool_t handle.
+ */
+extern void
+lputil_pool_reset(lputil_pool_t *pool);
+
+/**
+ * @brief destroys a lputil_pool_t handle and all objects allocated from it.
+ *
+ * @param pool a lputil_pool_t handle.
+ */
+extern void
+lputil_pool_destroy(lputil_pool_t *pool);
+
+/**
+ * @brief An allocator that create functions can be given.
+ *
+ * A @c NULL allocator stands for malloc(3) and free(3). Use
+ * lputil_alloc_init_arena() or lputil_alloc_init_pool() to allocate from an
+ * arena or a pool, or fill in the members to use an allocator of your own.
+ */
+typedef struct lputil_alloc {
+     /** @brief allocates @c len bytes, returns @c NULL and sets errno if an
+      * error occurs. */
+     void *(*alloc)(void *ctx, size_t len);
+     /** @brief releases memory returned by @c alloc. */
+     void (*free)(void *ctx, void *p);
+     void *ctx;                 /**< @brief passed to both functions. */
+} lputil_alloc_t;
+
+/**
+ * @brief initializes an allocator that allocates from an arena.
+ *
+ * Freeing does nothing, the memory is released together with the arena.
+ *
+ * @param alloc the allocator.
+ * @param arena a lputil_arena_t handle.
+ */
+extern void
+lputil_alloc_init_arena(lputil_alloc_t *alloc, lputil_arena_t *arena);
+
+/**
+ * @brief initializes an allocator that allocates from a pool.
+ *
+ * Allocations bigger than the objects of the pool fail with @c ENOMEM.
+ *
+ * @param alloc the allocator.
+ * @param pool a lputil_pool_t handle.
+ */
+extern void
+lputil_alloc_init_pool(lputil_alloc_t *alloc, lputil_pool_t *pool);
+
+/**
+ * @brief allocates memory from an allocator.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param alloc the allocator or @c NULL for malloc(3).
+ * @param len the number of bytes.
+ *
+ * @return a pointer to the memory.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the allocator.
+ */
+extern void *
+lputil_alloc(const lputil_alloc_t *alloc, size_t len);
+
+/**
+ * @brief releases memory to an allocator.
+ *
+ * @param alloc the allocator or @c NULL for free(3).
+ * @param p memory returned by lputil_alloc() with the same allocator or
+ * @c NULL.
+ */
+extern void
+lputil_free(const lputil_alloc_t *alloc, void *p);
+
+/**
+ * @brief a table of interned strings.
+ *
+ * Maps strings to small integer IDs and back. Every distinct string is
+ * stored once and stays valid until the table is destroyed, so two interned
+ * strings are equal if and only if their IDs or pointers are. IDs start at
+ * @c 1, @c 0 never names a string. All functions may be called from several
+ * threads at once.
+ *
+ * @warning do not allocate or free it yourself, use lputil_symtab_create()
+ * and lputil_symtab_destroy().
+ */
+typedef struct lputil_symtab lputil_symtab_t;
+
+/**
+ * @brief returns a new, empty lputil_symtab_t handle.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @return a pointer to a lputil_symtab_t handle or @c NULL if an error has
+ * occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routines malloc(3) and pthread_mutex_init(3).
+ */
+extern lputil_symtab_t *
+lputil_symtab_create(void);
+
+/**
+ * @brief interns a string.
+ *
+ * Looks the string up and adds a copy of it to the table if it is not
+ * there yet.
+ *
+ * If an error occurs, @c 0 is returned and errno is set to indicate the
+ * error.
+ *
+ * @param tab a lputil_symtab_t handle.
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ * @param str if not @c NULL, the interned copy of the string is stored
+ * here.
+ *
+ * @return the ID of the string or @c 0 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c ENOMEM the table is full.
+ * - This routine may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+extern uint32_t
+lputil_symtab_intern(lputil_symtab_t *tab, const char *s, size_t len,
+                     const char **str);
+
+/**
+ * @brief looks up the ID of a string without adding it.
+ *
+ * @param tab a lputil_symtab_t handle.
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return the ID of the string or @c 0 if it was not interned yet.
+ */
+extern uint32_t
+lputil_symtab_lookup(lputil_symtab_t *tab, const char *s, size_t len);
+
+/**
+ * @brief returns the string with a given ID.
+ *
+ * If the ID is unknown, @c NULL is returned and errno is set to @c EINVAL.
+ *
+ * @param tab a lputil_symtab_t handle.
+ * @param id an ID as returned by lputil_symtab_intern().
+ *
+ * @return the @c nul terminated string or @c NULL.
+ */
+extern const char *
+lputil_symtab_str(lputil_symtab_t *tab, uint32_t id);
+
+/**
+ * @brief returns the number of strings in a symbol table.
+ *
+ * IDs are handed out in order, so the strings have the IDs @c 1 up to the
+ * returned number.
+ *
+ * @param tab a lputil_symtab_t handle.
+ *
+ * @return the number of strings.
+ */
+extern size_t
+lputil_symtab_count(lputil_symtab_t *tab);
+
+/**
+ * @brief destroys a lputil_symtab_t handle and all strings in it.
+ *
+ * @param tab a lputil_symtab_t handle.
+ */
+extern void
+lputil_symtab_destroy(lputil_symtab_t *tab);
+
+/**
+ * @brief interns a string in the process wide table.
+ *
+ * Works like lputil_symtab_intern() on a table that is created on first use
+ * and lives as long as the process. It holds the categories and package
+ * names of all parsed atoms.
+ *
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ * @param str if not @c NULL, the interned copy of the string is stored
+ * here.
+ *
+ * @return the ID of the string or @c 0 if an error occured.
+ *
+ * @sa lputil_symtab_intern()
+ */
+extern uint32_t
+lputil_intern(const char *s, size_t len, const char **str);
+
+/**
+ * @brief looks up a string in the process wide table without adding it.
+ *
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return the ID of the string or @c 0 if it was not interned yet.
+ *
+ * @sa lputil_symtab_lookup()
+ */
+extern uint32_t
+lputil_intern_lookup(const char *s, size_t len);
+
+/**
+ * @brief returns the string with a given ID from the process wide table.
+ *
+ * @param id an ID as returned by lputil_intern().
+ *
+ * @return the @c nul terminated string or @c NULL.
+ *
+ * @sa lputil_symtab_str()
+ */
+extern const char *
+lputil_intern_str(uint32_t id);
+
+/**
+ * @brief a function that processes a range of items for lputil_parallel().
+ *
+ * @param ctx the context given to lputil_parallel().
+ * @param worker the number of the worker, starting at @c 0.
+ * @param begin the first item of the range.
+ * @param end the item behind the last item of the range.
+ */
+typedef void (*lputil_parallel_fn_t)(void *ctx, unsigned int worker,
+                                     size_t begin, size_t end);
+
+/**
+ * @brief calculates the number of workers for lputil_parallel().
+ *
+ * Every worker gets at least @c min items, so small jobs are not spread over
+ * more threads than they are worth.
+ *
+ * @param n the number of items.
+ * @param min the minimum number of items per worker.
+ * @param threads the maximum number of workers or @c 0 for the number of
+ * online processors.
+ *
+ * @return the number of workers, at least @c 1.
+ */
+extern unsigned int
+lputil_parallel_workers(size_t n, size_t min, unsigned int threads);
+
+/**
+ * @brief processes a range of items with several threads.
+ *
+ * Splits the items @c 0 to @c n-1 into @c workers contiguous ranges of about
+ * the same size and calls @c fn once for every range. The first range is
+ * processed by the calling thread, the others by new threads. If a thread can
+ * not be created, its range is processed by the calling thread as well, so
+ * all items are always processed. The function returns after all ranges are
+ * done.
+ *
+ * @param n the number of items.
+ * @param workers the number of workers as returned by
+ * lputil_parallel_workers().
+ * @param fn the function to call for each range.
+ * @param ctx passed to @c fn.
+ */
+extern void
+lputil_parallel(size_t n, unsigned int workers, lputil_parallel_fn_t fn,
+                void *ctx);
+
+/**
+ * @brief a function that builds the sort key of an item for
+ * lputil_keysort().
+ *
+ * Like snprintf(3), at most @c len bytes are written to @c buf and the
+ * length of the complete key is returned. Keys are compared with memcmp(3),
+ * a key that is a prefix of another one sorts first.
+ *
+ * @param item the item.
+ * @param buf the buffer, may be @c NULL if @c len is @c 0.
+ * @param len the size of @c buf in bytes.
+ *
+ * @return the length of the key.
+ */
+typedef size_t (*lputil_key_fn_t)(const void *item, void *buf, size_t len);
+
+/**
+ * @brief sorts an array of items by their sort keys.
+ *
+ * The key of every item is built once, the items are then sorted with a
+ * stable merge sort over the keys. Big arrays are split into runs that are
+ * built and sorted by several threads, see lputil_parallel().
+ *
+ * If an error occurs, @c -1 is returned, errno is set to indicate the error
+ * and the array is left unchanged.
+ *
+ * @param items the items.
+ * @param n the number of items.
+ * @param key the function building the keys.
+ * @param threads the maximum number of threads or @c 0 for the number of
+ * online processors.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern int
+lputil_keysort(const void **items, size_t n, lputil_key_fn_t key,
+               unsigned int threads);
+
+/**
+ * @brief appends a string to a size limited buffer.
+ *
+ * Copies as much of @c s to offset @c off of @c buf as fits in front of the
+ * last byte, which is kept free for the terminating @c nul character. This
+ * allows functions to format into a caller supplied buffer and still compute
+ * the full length of the output, like snprintf(3).
+ *
+ * @param buf the buffer, may be @c NULL if @c cap is @c 0.
+ * @param cap the size of the buffer in bytes.
+ * @param off the offset to append at, may be beyond the buffer.
+ * @param s the string to append, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return @c off plus @c len.
+ */
+extern size_t
+lputil_bufcat(char *buf, size_t cap, size_t off, const char *s, size_t len);
+
+/**
+ * @brief initializes an empty string builder.
+ *
+ * Nothing is allocated until the string outgrows the inline storage.
+ *
+ * @param sb the builder.
+ */
+extern void
+lputil_strbuf_init(lputil_strbuf_t *sb);
+
+/**
+ * @brief makes room in a string builder.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error, the string is left unchanged.
+ *
+ * @param sb the builder.
+ * @param len the number of bytes that will be appended, not counting the
+ * terminating @c nul character.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c ENOMEM the string would be longer than @c SIZE_MAX bytes.
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern int
+lputil_strbuf_reserve(lputil_strbuf_t *sb, size_t len);
+
+/**
+ * @brief appends a string to a string builder.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error, the string is left unchanged.
+ *
+ * @param sb the builder.
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c ENOMEM the string would be longer than @c SIZE_MAX bytes.
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern int
+lputil_strbuf_append(lputil_strbuf_t *sb, const char *s, size_t len);
+
+/**
+ * @brief appends room for a string to a string builder.
+ *
+ * The length of the string is increased by @c len bytes, which are left for
+ * the caller to fill in. This allows functions that format into a caller
+ * supplied buffer to write to the builder directly.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error, the string is left unchanged.
+ *
+ * @param sb the builder.
+ * @param len the number of bytes to append.
+ *
+ * @return the first appended byte, @c len+1 bytes may be written including
+ * the terminating @c nul character.
+ *
+ * @b Errors:
+ *
+ * - @c ENOMEM the string would be longer than @c SIZE_MAX bytes.
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern char *
+lputil_strbuf_extend(lputil_strbuf_t *sb, size_t len);
+
+/**
+ * @brief appends an unsigned number in decimal to a string builder.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error, the string is left unchanged.
+ *
+ * @param sb the builder.
+ * @param value the number.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern int
+lputil_strbuf_append_u64(lputil_strbuf_t *sb, uint64_t value);
+
+/**
+ * @brief returns the string of a string builder.
+ *
+ * The string is only valid until the builder is changed.
+ *
+ * @param sb the builder.
+ *
+ * @return the @c nul terminated string.
+ */
+extern const char *
+lputil_strbuf_str(const lputil_strbuf_t *sb);
+
+/**
+ * @brief returns the length of the string of a string builder.
+ *
+ * @param sb the builder.
+ *
+ * @return the length of the string.
+ */
+extern size_t
+lputil_strbuf_len(const lputil_strbuf_t *sb);
+
+/**
+ * @brief takes the string out of a string builder.
+ *
+ * The builder is empty afterwards. The memory for the returned string is
+ * obtained by malloc(3) and can be freed with free(3), if the string was
+ * still kept inline it is copied.
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error, the builder is left unchanged.
+ *
+ * @param sb the builder.
+ *
+ * @return the @c nul terminated string.
+ *
+ * @b Errors:
+ *
+ * - This routine may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern char *
+lputil_strbuf_detach(lputil_strbuf_t *sb);
+
+/**
+ * @brief empties a string builder and frees its memory.
+ *
+ * @param sb the builder.
+ */
+extern void
+lputil_strbuf_reset(lputil_strbuf_t *sb);
+
+/**
+ * @brief counts the leading decimal digits of a string.
+ *
+ * Depending on the target, 32 or 16 characters are checked at once with
+ * AVX2, SSE2 or NEON instructions, the rest is checked one by one. The
+ * string is never read beyond @c len bytes.
+ *
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return the number of leading characters in the range @c 0 to @c 9.
+ */
+extern size_t
+lputil_digitspan(const char *s, size_t len);
+
+/**
+ * @brief converts a run of decimal digits into an integer.
+ *
+ * Eight digits at a time are converted with a few integer operations, the
+ * string has to consist of digits only, eg. as found by lputil_digitspan().
+ *
+ * If the number is bigger than @c max, @c -1 is returned and errno is set to
+ * @c ERANGE.
+ *
+ * @param s the digits, do not need to be @c nul terminated.
+ * @param len the number of digits.
+ * @param max the biggest allowed value.
+ * @param value the number is stored here.
+ *
+ * @return @c 0 if successful or @c -1 if the number is too big.
+ */
+extern int
+lputil_digits_u64(const char *s, size_t len, uint64_t max, uint64_t *value);
+
 /**
  * @brief destroys an @c NULL terminated array of @c null terminated C Strings
  * as returned by lputil_splitstr().
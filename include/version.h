@@ -38,9 +38,11 @@
 extern "C" {
 #  endif
 
-#  include <regex.h>
+#  include <sys/types.h>
 #  include <stdint.h>
 
+#  include <util.h>
+
 /**
  * @brief Enum for the suffixes.
  */
@@ -53,17 +55,6 @@ typedef enum {
      LPV_P
 } lpversion_sufenum_t;
 
-/**
- * @brief struct for compiled regexes.
- */
-typedef struct lpversion_regex {
-     regex_t verify;            /**< @brief regex to match a valid version
-                                 * string */
-     regex_t suffix;            /**< @brief regex to match the suffix */
-     regex_t release;           /**< @brief regex to match the release
-                                 * version */
-} lpversion_regex_t;
-
 /**
  * @brief the lpversion object handle.
  *
@@ -74,16 +65,16 @@ typedef struct lpversion_regex {
  * lpversion_destroy().
  */
 typedef struct lpversion {
-     lpversion_regex_t regex;    /**< @brief a struct with compiled regexes */
-     lpversion_sufenum_t suffix; /**< @brief the suffix type */
-     unsigned int suffv;         /**< @brief the numerical suffix version  */
-     unsigned int release;       /**< @brief the release version */
      /*@null@*/
      int64_t *va;                /**< @brief @c -1 terminated array with the
                                   * split up numerical version */
+     lpversion_sufenum_t suffix; /**< @brief the suffix type */
+     unsigned int suffv;         /**< @brief the numerical suffix version  */
+     unsigned int release;       /**< @brief the release version */
      char verc;                  /**< @brief the version character */
      /*@null@*/
-     char *version;              /**< @brief the complete version string */
+     lputil_arena_t *arena;      /**< @brief the arena @c va is allocated
+                                  * from or @c NULL for malloc(3) */
 } lpversion_t;
 
 /**
@@ -114,20 +105,57 @@ extern lpversion_t *
 lpversion_create(void);
 
 /**
- * @brief initialize a lpversion_t handle.
+ * @brief returns a new lpversion_t handle from an allocator.
  *
- * If you want to initialize an already used handle, use lpversion_reset()
+ * Like lpversion_create(), but the memory of the handle is obtained from
+ * @c alloc. The handle needs to be initialized before it is used and has to
+ * be destroyed with lpversion_destroy_alloc() and the same allocator.
+ *
+ * If an error occured, @c NULL is returned and @c errno is set to indicate
+ * the error.
  *
- * @param handle a lpatom_t handle to initialize
+ * @param alloc the allocator or @c NULL for malloc(3).
+ *
+ * @return a pointer to a lpversion_t handle or @c NULL if an error has occured.
  *
  * @b Errors:
  *
  * - This function may fail and set errno for any of the errors specified for
- *   the routine malloc(3).
+ *   the allocator.
+ *
+ * @sa lputil_alloc_init_arena(), lputil_alloc_init_pool()
+ */
+extern lpversion_t *
+lpversion_create_alloc(const lputil_alloc_t *alloc);
+
+/**
+ * @brief initialize a lpversion_t handle.
+ *
+ * This function only sets the members of the handle to their defaults and
+ * does not allocate any memory.
+ *
+ * If you want to initialize an already used handle, use lpversion_reset()
+ *
+ * @param handle a lpversion_t handle to initialize
  */
 extern void
 lpversion_init(/*@special@*/lpversion_t *handle);
 
+/**
+ * @brief initialize a lpversion_t handle that allocates from an arena.
+ *
+ * Works like lpversion_init(), but all memory needed by lpversion_parse()
+ * and lpversion_parse_len() is taken from the given arena. It is released
+ * together with the arena, lpversion_reset() and lpversion_destroy() do not
+ * free it. The handle keeps the arena when it is reset.
+ *
+ * @param handle a lpversion_t handle to initialize
+ *
+ * @param arena the lputil_arena_t handle to allocate from.
+ */
+extern void
+lpversion_init_arena(/*@special@*/lpversion_t *handle, lputil_arena_t *arena);
+
 /**
  * @brief resets a lpversion_t handle.
  *
@@ -144,6 +172,20 @@ lpversion_reset(lpversion_t *handle);
 extern void
 lpversion_destroy(lpversion_t *handle);
 
+/**
+ * @brief destroys a lpversion_t handle returned by lpversion_create_alloc().
+ *
+ * Releases the members of the handle like lpversion_destroy() and the handle
+ * itself to the allocator. If a @c NULL pointer was given, this function
+ * will just return.
+ *
+ * @param handle a lpversion_t handle.
+ *
+ * @param alloc the allocator the handle was created with.
+ */
+extern void
+lpversion_destroy_alloc(lpversion_t *handle, const lputil_alloc_t *alloc);
+
 /**
  * @brief parses an version string.
  *
@@ -163,21 +205,69 @@ lpversion_destroy(lpversion_t *handle);
  * @b Errors:
  *
  * - @c EINVAL the given string is not a valid version.
+ * - @c ERANGE one of the numbers in the given string is too big.
  * - This function may fail and set errno for any of the errors specified for
  *   the routine malloc(3)
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine strdup(3)
  */
 
 extern int
 lpversion_parse(lpversion_t *handle, const char *version);
 
 /**
- * @brief compares two lpatom_t handles.
+ * @brief parses a version string of a given length.
+ *
+ * Works like lpversion_parse() but takes the length of the string, so a
+ * version can be parsed straight out of a bigger string, eg. an atom.
+ *
+ * If an error occurs while parsing the string, @c -1 is returned and @c errno
+ * is set to indicate the error.
+ *
+ * @param handle a lpversion_t handle.
+ *
+ * @param version a version string, does not need to be @c null terminated.
+ *
+ * @param len the length of the version string.
+ *
+ * @return @c 0 if sucessfull or @c -1 if an error has occured.
+ *
+ * @sa lpversion_parse()
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL the given string is not a valid version.
+ * - @c ERANGE one of the numbers in the given string is too big.
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3)
+ */
+extern int
+lpversion_parse_len(lpversion_t *handle, const char *version, size_t len);
+
+/**
+ * @brief checks the syntax of a version string.
+ *
+ * Validates the string just like lpversion_parse_len() but neither stores
+ * nor allocates anything. The size of the numbers is not checked.
+ *
+ * If the string is not a valid version, @c -1 is returned and @c errno is set
+ * to @c EINVAL.
  *
- * @param v1 a lpatom_t handle.
+ * @param version a version string, does not need to be @c null terminated.
  *
- * @param v2 a lpatom_t handle.
+ * @param len the length of the version string.
+ *
+ * @return @c 0 if the string is a valid version or @c -1 if not.
+ *
+ * @sa lpversion_parse_len()
+ */
+extern int
+lpversion_check(const char *version, size_t len);
+
+/**
+ * @brief compares two lpversion_t handles.
+ *
+ * @param v1 a lpversion_t handle.
+ *
+ * @param v2 a lpversion_t handle.
  *
  * @return an integer less than, equal to, or greater than zero if v1 is
  * found, to be less than, to match, or to be greater than v2.
@@ -185,6 +275,67 @@ lpversion_parse(lpversion_t *handle, const char *version);
 extern int
 lpversion_cmp(const lpversion_t *v1, const lpversion_t *v2);
 
+/**
+ * @brief encodes a lpversion_t handle into a binary sort key.
+ *
+ * The key is a sequence of bytes whose lexicographic order, as given by
+ * memcmp(3), equals the order of lpversion_cmp(). No key is a prefix of a
+ * different key, so comparing two keys with memcmp(3) over the length of the
+ * shorter one is sufficient; if they are equal there, the keys are equal.
+ *
+ * Like snprintf(3), at most @c len bytes are written to @c buf and the
+ * length of the complete key is returned. If it is bigger than @c len, the
+ * key was truncated and the function needs to be called again with a bigger
+ * buffer. Each numerical component takes at most 9 bytes, the rest of the
+ * version at most 13 bytes.
+ *
+ * @param handle a lpversion_t handle with a parsed version.
+ *
+ * @param buf the buffer the key is written to, may be @c NULL if @c len is
+ * @c 0.
+ *
+ * @param len the size of @c buf in bytes.
+ *
+ * @return the length of the key in bytes.
+ *
+ * @sa lpversion_cmp()
+ */
+extern size_t
+lpversion_key(const lpversion_t *handle, void *buf, size_t len);
+
+/**
+ * @brief the parts of a sort key, see lpversion_key_prefix().
+ */
+typedef enum {
+     LPV_KEY_COMPONENTS = 0,    /**< @brief the numerical components without
+                                 * their terminator. */
+     LPV_KEY_VERC,              /**< @brief up to the version character. */
+     LPV_KEY_SUFFIX,            /**< @brief up to the suffix. */
+     LPV_KEY_SUFFV,             /**< @brief up to the suffix version, ie.
+                                 * everything but the release. */
+     LPV_KEY_ALL                /**< @brief the whole key. */
+} lpversion_keypart_t;
+
+/**
+ * @brief returns the length of a prefix of a sort key.
+ *
+ * The parts of a key are encoded in the order of lpversion_keypart_t and
+ * each part is self delimiting, so two keys start with the same prefix up
+ * to a part if and only if the versions are equal up to that part. Eg.
+ * comparing the @c LPV_KEY_SUFFV prefix compares the versions without their
+ * release.
+ *
+ * @param handle a lpversion_t handle with a parsed version.
+ *
+ * @param part the last part of the prefix.
+ *
+ * @return the length of the prefix in bytes.
+ *
+ * @sa lpversion_key()
+ */
+extern size_t
+lpversion_key_prefix(const lpversion_t *handle, lpversion_keypart_t part);
+
 /**
  * @brief compiles a lpversion handle into a @c null terminated C string.
  *
@@ -194,10 +345,115 @@ lpversion_cmp(const lpversion_t *v1, const lpversion_t *v2);
  * @param handle a lpversion_t handle.
  *
  * @return a @c null terminated C string with the compiled version.
+ *
+ * @sa lpversion_compile_into()
  */
 extern char *
 lpversion_compile(const lpversion_t *handle);
 
+/**
+ * @brief compiles a lpversion handle into a given buffer.
+ *
+ * Like snprintf(3), at most @c cap bytes including the terminating @c nul
+ * character are written to @c buf and the length of the complete version
+ * string without the @c nul character is returned. If it is not smaller
+ * than @c cap, the string was truncated and the function needs to be called
+ * again with a bigger buffer. No memory is allocated.
+ *
+ * @param handle a lpversion_t handle.
+ *
+ * @param buf the buffer, may be @c NULL if @c cap is @c 0.
+ *
+ * @param cap the size of @c buf in bytes.
+ *
+ * @return the length of the version string.
+ *
+ * @sa lpversion_compile()
+ */
+extern size_t
+lpversion_compile_into(const lpversion_t *handle, char *buf, size_t cap);
+
+/**
+ * @brief appends the compiled version string to a string builder.
+ *
+ * Many versions can be written into a single builder this way, eg. to
+ * assemble a file, without allocating a string for every one of them.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param handle a lpversion_t handle.
+ *
+ * @param sb an initialized string builder.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @sa lpversion_compile_into(), lputil_strbuf_init()
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
+ */
+extern int
+lpversion_compile_buf(const lpversion_t *handle, lputil_strbuf_t *sb);
+
+/**
+ * @brief returns the shared handle of a version.
+ *
+ * Every distinct version is parsed once and kept in a process wide table
+ * until the process exits. Versions that compare equal with lpversion_cmp()
+ * get the same handle, no matter how they are spelled, so eg. @c 1.0-r0 and
+ * @c 1.00 both return the handle of @c 1.0 and two interned versions are
+ * equal if and only if their handles are. This function is thread safe.
+ *
+ * If an error occurs, @c NULL is returned and @c errno is set to indicate
+ * the error.
+ *
+ * @param version the version string, does not need to be @c nul terminated.
+ *
+ * @param len the length of the version string.
+ *
+ * @return the shared handle, it must not be modified, reset or destroyed.
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL the given string is not a valid version.
+ * - @c ERANGE one of the numbers is too big.
+ * - @c ENOMEM the table is full.
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern const lpversion_t *
+lpversion_intern(const char *version, size_t len);
+
+/**
+ * @brief sorts an array of versions.
+ *
+ * The versions are sorted in the order of lpversion_cmp(), equal versions
+ * keep their relative order. The sort key of every version is built only
+ * once and big arrays are sorted by several threads, see lputil_keysort().
+ *
+ * If an error occurs, @c -1 is returned, @c errno is set to indicate the
+ * error and the array is left unchanged.
+ *
+ * @param versions an array of parsed versions.
+ *
+ * @param n the number of versions.
+ *
+ * @param threads the maximum number of threads or @c 0 for the number of
+ * online processors.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+extern int
+lpversion_sort(const lpversion_t **versions, size_t n, unsigned int threads);
+
 #  ifdef __cplusplus
 }
 #  endif
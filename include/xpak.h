@@ -37,6 +37,8 @@
 #  include <sys/types.h>
 #  include <stdint.h>
 
+#  include <util.h>
+
 #  ifdef __cplusplus
 extern "C" {
 #  endif
@@ -46,8 +48,10 @@ extern "C" {
  *
  * This is the data structure that holds one element of the xpak.
  *
- * None of the Pointers in this struct will point to memory regions which are
- * used elsewhere by the lpxpak library.
+ * If the xpak was read by lpxpak_parse_fd() or lpxpak_parse_path(), @c value
+ * points into a read-only mapping of the file that is owned by the lpxpak_t
+ * handle and must not be written to. If it was read by lpxpak_parse_view(),
+ * @c name and @c value point into the blob of the caller.
  */
 typedef struct lpxpak_entry {
      /**
@@ -60,9 +64,17 @@ typedef struct lpxpak_entry {
      /**
       * @brief The Name of the element.
       *
-      * This element is implemented as a null terminated C-String.
+      * This element is implemented as a null terminated C-String, except for
+      * handles from lpxpak_parse_view(), where it is @c name_len bytes long.
       */
      char *name;
+     /**
+      * @brief The length of the name.
+      *
+      * Set by the parse functions, entries that are filled in by hand do not
+      * need it.
+      */
+     size_t name_len;
      /**
       * @brief A pointer to the value - a value_len bytes long memory block.
       */
@@ -79,8 +91,20 @@ typedef struct lpxpak_entry {
  * Beware that you need to initialize an handle using lpxpak_init() first
  * before you use it with any functions provided by libportage.
  *
- * None of the Pointers in this struct will point to memory regions which are
- * used elsewhere by the lpxpak library.
+ * Who owns the names and values depends on the parse function:
+ * - lpxpak_parse_data() copies them, the handle owns all of its memory and
+ *   the blob may be destroyed right after parsing.
+ * - lpxpak_parse_fd() and lpxpak_parse_path() copy the names, but the values
+ *   point into a private mapping of the file which is owned by the handle
+ *   and removed by lpxpak_destroy(). The file must not be truncated or
+ *   rewritten in place while the handle is alive, reading a value from the
+ *   part that was cut off raises SIGBUS. lpxpak_update_path() replaces the
+ *   file instead and is safe, lpxpak_update_fd() is not.
+ * - lpxpak_parse_view() copies nothing, names and values point into the blob
+ *   of the caller, which has to outlive the handle.
+ *
+ * The entry array and the hash table always belong to the handle, they are
+ * allocated from its arena if it was initialised with lpxpak_init_arena().
  *
  *  @sa lpxpak_create(), lpxpak_init(), lpxpak_reinit(), lpxpak_destroy().
  */
@@ -94,6 +118,31 @@ typedef struct lpxpak {
       * structures.
       */
      lpxpak_entry_t *entries;
+     /**
+      * The copy of the data block the values point into or @c NULL.
+      */
+     void *data;
+     /**
+      * The mapped blob the values point into or @c NULL.
+      */
+     struct lpxpak_blob *blob;
+     /**
+      * Non-zero if the names and values point into a blob of the caller.
+      */
+     int borrowed;
+     /**
+      * The hash table of lpxpak_get(), entry numbers plus one with @c 0 for
+      * a free slot, or @c NULL if it was not built yet.
+      */
+     uint32_t *lookup;
+     /**
+      * The number of slots of @c lookup minus one.
+      */
+     size_t lookup_mask;
+     /**
+      * The arena the members are allocated from or @c NULL for malloc(3).
+      */
+     lputil_arena_t *arena;
 } lpxpak_t;
 
 /**
@@ -105,6 +154,9 @@ typedef struct lpxpak {
  * To savely Remove an lpxpak_blob_t datastructure and all the data it points
  * to from memory, use lpxpak_blob_destroy().
  *
+ * A blob returned by lpxpak_blob_map_fd() does not own a copy of the data,
+ * @c data points into a read-only mapping of the file instead.
+ *
  * @sa lpxpak_blob_create(), lpxpak_blob_init(), lpxpak_blob_destroy().
  */
 typedef struct lpxpak_blob {
@@ -120,6 +172,15 @@ typedef struct lpxpak_blob {
       * a Pointer to the start of a memory segment that holds the data.
       */
      void *data;
+     /**
+      * @brief The start of the mapping @c data lies in or @c NULL if @c data
+      * was allocated.
+      */
+     void *map;
+     /**
+      * @brief The length of the mapping.
+      */
+     size_t map_len;
 } lpxpak_blob_t;
 
 /**
@@ -151,6 +212,36 @@ typedef struct lpxpak_blob {
 extern int
 lpxpak_parse_data(lpxpak_t *handle, const lpxpak_blob_t *blob);
 
+/**
+ * @brief Parses a xpak binary blob without copying it.
+ *
+ * Like lpxpak_parse_data(), but the names and values of the entries point
+ * into @c blob, which has to stay valid and unchanged as long as the handle
+ * is used. The names are not @c nul terminated, their length is in
+ * @c name_len. The only allocation is the array of entries.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error.
+ *
+ * @param handle a pointer to an lpxpak_t data structure used for this
+ * operation.
+ *
+ * @param blob a pointer to an lpxpak_blob_t data structure which holds the
+ * xpak blob.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @sa lpxpak_parse_data(), lpxpak_get().
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL The blob is no valid xpak.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+extern int
+lpxpak_parse_view(lpxpak_t *handle, const lpxpak_blob_t *blob);
+
 /**
  * @brief Reads the xpak data out of a file-descriptor.
  *
@@ -158,6 +249,10 @@ lpxpak_parse_data(lpxpak_t *handle, const lpxpak_blob_t *blob);
  * a provided lpxpak_t handle. If an error occurs, @c -1 is returned and errno
  * is set to indicate the error.
  *
+ * The xpak is mapped with lpxpak_blob_map_fd() and the values of the entries
+ * point into the mapping, which stays valid until the handle is destroyed.
+ * Only the names are copied.
+ *
  * @param handle a pointer to an lpxpak_t data structure used for this
  * operation.
  * 
@@ -183,6 +278,8 @@ lpxpak_parse_data(lpxpak_t *handle, const lpxpak_blob_t *blob);
  *   for the routine lseek(2).
  * - This function may also fail and set errno for any of the errors specified
  *   for the routine read(2).
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine mmap(2).
  */
 extern int
 lpxpak_parse_fd(lpxpak_t *handle, int fd);
@@ -250,6 +347,30 @@ lpxpak_parse_path(lpxpak_t *handle, const char *path);
 extern lpxpak_t *
 lpxpak_create(void);
 
+/**
+ * @brief returns a new lpxpak_t handle from an allocator.
+ *
+ * Like lpxpak_create(), but the memory of the handle is obtained from
+ * @c alloc. The handle needs to be initialized before it is used and has to
+ * be destroyed with lpxpak_destroy_alloc() and the same allocator.
+ *
+ * If an error occured, @c NULL is returned and @c errno is set to indicate
+ * the error.
+ *
+ * @param alloc the allocator or @c NULL for malloc(3).
+ *
+ * @return a pointer to a lpxpak_t handle or @c NULL if an error has occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the allocator.
+ *
+ * @sa lputil_alloc_init_arena(), lputil_alloc_init_pool()
+ */
+extern lpxpak_t *
+lpxpak_create_alloc(const lputil_alloc_t *alloc);
+
 /**
  * @brief Initialises a lpxpak_t handle.
  *
@@ -263,6 +384,28 @@ lpxpak_create(void);
 extern void
 lpxpak_init(lpxpak_t *xpak);
 
+/**
+ * @brief Initialises a lpxpak_t handle that allocates from an arena.
+ *
+ * Works like lpxpak_init(), but the parse functions and lpxpak_get() take
+ * the entry array, the names, the copy of the data block and the hash table
+ * from the given arena. This memory is released together with the arena,
+ * lpxpak_destroy() does not free it but still removes the mapping of
+ * lpxpak_parse_fd().
+ *
+ * The handle itself may be allocated from the arena as well with
+ * lpxpak_create_alloc(), in that case it has to be destroyed with
+ * lpxpak_destroy_alloc() and the same allocator.
+ *
+ * @param xpak a lpxpak_t handle.
+ *
+ * @param arena the lputil_arena_t handle to allocate from.
+ *
+ * @sa lpxpak_init(), lputil_arena_create(), lputil_alloc_init_arena().
+ */
+extern void
+lpxpak_init_arena(lpxpak_t *xpak, lputil_arena_t *arena);
+
 /**
  * @brief Destroys an lpxpak_t handle.
  *
@@ -278,12 +421,31 @@ lpxpak_init(lpxpak_t *xpak);
 extern void
 lpxpak_destroy(lpxpak_t *xpak);
 
+/**
+ * @brief destroys a lpxpak_t handle returned by lpxpak_create_alloc().
+ *
+ * Releases the members of the handle like lpxpak_destroy() and the handle
+ * itself to the allocator. If a @c NULL pointer was given, this function
+ * will just return.
+ *
+ * @param xpak a lpxpak_t handle.
+ *
+ * @param alloc the allocator the handle was created with.
+ */
+extern void
+lpxpak_destroy_alloc(lpxpak_t *xpak, const lputil_alloc_t *alloc);
+
 /**
  * @brief Returns the xpak entry for a given key.
  *
  * Searches the provided array for an entry with the given key and returns it,
  * if no corresponding element could be found, @c NULL is returned.
  *
+ * The first lookup builds a hash table of the names, the following ones take
+ * constant time. Because of that, the first lookup on a handle must not run
+ * concurrently with other lookups on it, and the table has to be dropped
+ * with lpxpak_reindex() if the entries are changed by hand afterwards.
+ *
  * @param handle a lpxpak_t handle with parsed data.
  * 
  * @param key a @c null terminated C string with the key to search for.
@@ -295,6 +457,39 @@ lpxpak_destroy(lpxpak_t *xpak);
 extern lpxpak_entry_t *
 lpxpak_get(lpxpak_t *handle, char *key);
 
+/**
+ * @brief Returns the xpak entries for a list of keys.
+ *
+ * Looks up all @c n keys with the hash table of lpxpak_get() and stores the
+ * entry of the i-th key, or @c NULL if there is none, in @c entries[i].
+ *
+ * @param handle a lpxpak_t handle with parsed data.
+ *
+ * @param keys an array of @c n @c nul terminated keys.
+ *
+ * @param n the number of keys.
+ *
+ * @param entries an array of @c n pointers the entries are stored in.
+ *
+ * @return the number of keys that were found.
+ *
+ * @sa lpxpak_get()
+ */
+extern size_t
+lpxpak_get_n(lpxpak_t *handle, const char *const *keys, size_t n,
+             lpxpak_entry_t **entries);
+
+/**
+ * @brief Drops the hash table of lpxpak_get().
+ *
+ * Has to be called after the entries of a handle were changed by hand, the
+ * next lookup builds a new table.
+ *
+ * @param handle a lpxpak_t handle.
+ */
+extern void
+lpxpak_reindex(lpxpak_t *handle);
+
 /**
  * @brief Reads the xpak data out of a Gentoo binary package.
  *
@@ -329,6 +524,42 @@ lpxpak_get(lpxpak_t *handle, char *key);
 extern lpxpak_blob_t *
 lpxpak_blob_get_fd(int fd);
 
+/**
+ * @brief maps the xpak of a Gentoo binary package into memory.
+ *
+ * Like lpxpak_blob_get_fd(), but the xpak is not read into the heap, the
+ * returned blob points into a read-only mapping of the file instead. Only the
+ * pages that are accessed are read from the disk. The mapping stays valid
+ * after @c fd was closed and is removed by lpxpak_blob_destroy().
+ *
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
+ *
+ * @param fd a file descriptor with the gentoo binary package which needs to
+ * be opened in O_RDONLY mode.
+ *
+ * @return a pointer to an lpxpak_blob_t data structure which holds the mapped
+ * xpak or @c NULL, if an error has occured.
+ *
+ * @sa lpxpak_blob_get_fd(), lpxpak_blob_destroy()
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL The file either is no valid gentoo binary package or has an
+ *   invalid xpak.
+ * - @c EBUSY The xpak offset could not be fully read in.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine fstat(2).
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine pread(2).
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine mmap(2).
+ */
+extern lpxpak_blob_t *
+lpxpak_blob_map_fd(int fd);
+
 /**
  * @brief Allocates a new lpxpak_blob_t structure.
  *
@@ -371,6 +602,9 @@ lpxpak_blob_init(lpxpak_blob_t *blob);
  * @brief Destroys an lpxpak_blob_t data structure using free(3). If a @c NULL
  * pointer was given, lpxpak_destroy() will just return.
  *
+ * The mapping of a blob returned by lpxpak_blob_map_fd() is removed with
+ * munmap(2).
+ *
  * @param blob a pointer to an lpxpak_blob_t data structure.
  *
  * @warning Do not try to access the data structure after destroying it or
@@ -433,6 +667,163 @@ lpxpak_blob_get_path(const char *path);
 extern lpxpak_blob_t *
 lpxpak_blob_compile(lpxpak_t *handle);
 
+/**
+ * @brief writes an lpxpak_t object with parsed data to a file descriptor.
+ *
+ * Writes the same bytes lpxpak_blob_compile() would return, but straight from
+ * the names and values of the handle with writev(2), without building the
+ * blob in memory. If @c trailer is non-zero, the xpak offset and the STOP
+ * string follow, so the xpak can be appended to a compressed tarball to
+ * form a Gentoo binary package.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error. Parts of the xpak may have been written then.
+ *
+ * @param handle a lpxpak_t handle with parsed data.
+ *
+ * @param fd a file descriptor opened for writing.
+ *
+ * @param trailer whether the offset and the STOP string are written.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @sa lpxpak_blob_compile()
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL the xpak does not fit into the 32 bit lengths of the format.
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine writev(2).
+ */
+extern int
+lpxpak_write_fd(lpxpak_t *handle, int fd, int trailer);
+
+/**
+ * @brief replaces the xpak of a Gentoo binary package.
+ *
+ * Overwrites the xpak and the trailer at the end of the package with the
+ * compiled @c handle and truncates the file behind them. The compressed
+ * tarball in front is neither read nor written, so only the metadata costs
+ * I/O.
+ *
+ * The new xpak is compiled into memory before the file is changed. If the
+ * names or values of @c handle point into a mapping or a blob of the caller,
+ * the handle is given its own copies first, so @c handle may have been
+ * parsed from the same file. Its entry array is replaced then, pointers
+ * from lpxpak_get() become invalid. Every other mapping of the file, in this
+ * or any other process, raises SIGBUS when it is read past the new end of a
+ * shrunk file, so the caller has to make sure that nobody else has the
+ * package mapped or parsed with lpxpak_parse_fd(). lpxpak_update_path()
+ * replaces the file instead and is safe with readers.
+ *
+ * If @c journal is not @c -1, the old xpak is saved to it together with a
+ * checksum and synced to the disk first, so that an interrupted update can
+ * be undone with lpxpak_recover_fd(). Once the package is synced, the
+ * journal is truncated to zero bytes again, so that lpxpak_recover_fd() does
+ * nothing after a finished update. If this function returns @c -1, the
+ * journal may still hold the old xpak and lpxpak_recover_fd() puts it back.
+ * The caller has to make sure nobody else changes the package at the same
+ * time.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param handle a lpxpak_t handle with the new data.
+ *
+ * @param fd a file descriptor with the gentoo binary package opened for
+ * reading and writing.
+ *
+ * @param journal an empty file opened for writing or @c -1.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @sa lpxpak_update_path(), lpxpak_recover_fd()
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL The file either is no valid gentoo binary package or has an
+ *   invalid xpak, or the new xpak does not fit into the 32 bit lengths.
+ * - @c EBUSY The old xpak could not be fully read in.
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routines malloc(3), pread(2), writev(2), lseek(2), ftruncate(2) and
+ *   fsync(2).
+ */
+extern int
+lpxpak_update_fd(lpxpak_t *handle, int fd, int journal);
+
+/**
+ * @brief replaces the xpak of a Gentoo binary package atomically.
+ *
+ * Locks the package with fcntl(2) against other updates, writes the tarball
+ * and the compiled @c handle to a temporary file in the same directory and
+ * renames it over the package. Readers and handles from lpxpak_parse_fd()
+ * keep the old file, which is never changed, and if the process or the
+ * system dies in between, the package stays untouched. In exchange the
+ * tarball is copied, so unlike lpxpak_update_fd() this costs I/O for the
+ * whole package.
+ *
+ * The file mode is kept, but the new file belongs to the current process.
+ *
+ * Once the temporary file was renamed over the package, @c 0 is returned.
+ * The directory is synced afterwards on a best effort basis, so the rename
+ * itself may not have reached the disk yet if the system dies right after
+ * the call.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param handle a lpxpak_t handle with the new data.
+ *
+ * @param path Path to a gentoo binary package which needs to be readable and
+ * writable by the current process, as well as its directory.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @sa lpxpak_update_fd()
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL The file either is no valid gentoo binary package or has an
+ *   invalid xpak, or the new xpak does not fit into the 32 bit lengths.
+ * - This function may fail and set errno for any of the errors specified for
+ *   lpxpak_write_fd() and the routines open(2), fcntl(2), mkstemp(3),
+ *   pread(2), fchmod(2), fsync(2) and rename(2).
+ */
+extern int
+lpxpak_update_path(lpxpak_t *handle, const char *path);
+
+/**
+ * @brief undoes an interrupted lpxpak_update_fd().
+ *
+ * Writes the old xpak saved in @c journal back into the package. The journal
+ * ends with a checksum of the saved bytes. An empty journal, as left by a
+ * finished update, and a journal that was not completely written, does not
+ * start with the magic or whose checksum does not match are ignored and the
+ * package is left alone. It was not changed yet then, as lpxpak_update_fd()
+ * only touches the package once the journal is synced.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param fd a file descriptor with the gentoo binary package opened for
+ * reading and writing.
+ *
+ * @param journal the journal opened for reading.
+ *
+ * @return @c 1 if the old xpak was put back, @c 0 if the journal was ignored
+ * or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routines malloc(3), pread(2), writev(2), lseek(2), ftruncate(2) and
+ *   fsync(2).
+ */
+extern int
+lpxpak_recover_fd(int fd, int journal);
+
 #  ifdef __cplusplus
 }
 #  endif
@@ -37,6 +37,11 @@
 #include <fcntl.h>
 #include <string.h>
 
+/** @cond */
+#define LPMEM_SUBSYS    LPUTIL_MEM_ARCHIVE
+/** @endcond */
+#include "lpmem.h"
+
 struct lparchive {
      struct archive *archive;
      int fd;
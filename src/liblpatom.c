@@ -40,6 +40,7 @@
 #include <stdbool.h>
 
 #include <sys/types.h>
+#include <stddef.h>
 
 #if HAVE_ERRNO_H
 #  include <errno.h>
@@ -57,92 +58,1099 @@ extern int errno;
 #endif /* STDC_HEADERS */
 
 #include <stdbool.h>
-#include <ctype.h>
 
-/* this function seems to be in glibc right from the beginning */
-#ifdef __GNUC__
-extern char *
-stpcpy(char *dest, const char *src);
+/* the head of a sort key can be loaded with a single load and a byte swap */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#  define LPATOM_BSWAP 1
 #endif
 
+/** @cond */
+#define LPMEM_SUBSYS    LPUTIL_MEM_ATOM
+/** @endcond */
+#include "lpmem.h"
+
+/**
+ * @brief character class of characters allowed in a package name.
+ */
+#define LPATOM_C_NAME   0x01
+/**
+ * @brief character class of characters allowed in a category or slot.
+ */
+#define LPATOM_C_CAT    0x02
+/**
+ * @brief character class of characters a category, package name, slot or
+ * repository may start with.
+ */
+#define LPATOM_C_HEAD   0x04
+/**
+ * @brief character class of characters that may appear in a version.
+ */
+#define LPATOM_C_VER    0x08
+/**
+ * @brief character class of characters allowed in a use flag.
+ */
+#define LPATOM_C_USE    0x10
+/**
+ * @brief character class of characters allowed in a repository name.
+ */
+#define LPATOM_C_REPO   0x20
+/**
+ * @brief character class of characters a use flag may start with.
+ */
+#define LPATOM_C_ALNUM  0x40
+
+/**
+ * @brief number of use dependencies lpatom_lex() keeps on the stack before
+ * it has to move them to the heap.
+ */
+#define LPATOM_USE_STACK        32
+
+/**
+ * @brief returns the character at @c p or @c nul if @c p is at the end.
+ */
+#define LPATOM_PEEK(p, end)     ((p) < (end) ? *(p) : '\0')
+
 /**
- * @brief the regular expression used for validating the given version string.
+ * @brief the minimum number of atoms a worker of lpatom_parse_batch() gets.
  */
-#define LPATOM_RE         "^(([A-Za-z0-9+_][A-Za-z0-9+_.-]*)/)?([A-Za-z0-9+_-]\
-*([A-Za-z+_-]|[A-Za-z+_][0-9]+))(-(([0-9]+([.][0-9]+)*[a-z]?)?)((_(alpha|beta|\
-pre|rc|p)[0-9]*)?)(-r[0-9]+)?)?$"
+#define LPATOM_BATCH_MIN        512
 
 /**
- * @brief the regular expression used for matching the category-
+ * @brief the size of the key buffer lpatom_constraint_match_version() keeps
+ * on the stack.
+ */
+#define LPATOM_KEY_STACK        64
+
+/**
+ * @brief the number of leading key bytes lpatom_constraint_filter() compares
+ * as one integer.
+ */
+#define LPATOM_KEY_HEAD         8
+
+/**
+ * @brief the number of keys lpatom_constraint_filter() compares per pass.
+ */
+#define LPATOM_FILTER_BLOCK     64
+
+/**
+ * @brief loads the first LPATOM_KEY_HEAD bytes of a sort key as a big endian
+ * integer, shorter keys are padded with zeros.
  *
- * This regexp will export:
+ * Sort keys are prefix free, so two keys whose heads differ compare like
+ * their heads and keys with equal heads only need to compare the rest.
+ */
+static inline uint64_t
+lpatom_key_head(const uint8_t *key, size_t len);
+
+/**
+ * @brief builds the sort key of an atom for lputil_keysort().
+ */
+static size_t
+lpatom_sort_key(const void *item, void *buf, size_t len);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief character classes used by the atom lexer.
  *
- * - The category part.
+ * Maps every byte to a combination of the LPATOM_C_* flags, non ASCII
+ * characters do not belong to any class:
+ *
+ * - @c LPATOM_C_NAME: [A-Za-z0-9+_-]
+ * - @c LPATOM_C_CAT: [A-Za-z0-9+_.-]
+ * - @c LPATOM_C_HEAD: [A-Za-z0-9_]
+ * - @c LPATOM_C_VER: [0-9a-z._-]
+ * - @c LPATOM_C_USE: [A-Za-z0-9+_@-]
+ * - @c LPATOM_C_REPO: [A-Za-z0-9_-]
+ * - @c LPATOM_C_ALNUM: [A-Za-z0-9]
  */
-#define LPATOM_RE_CAT     "^([A-Za-z0-9+_][A-Za-z0-9+_.-]*)/"
+static const unsigned char lpatom_ctype[256] = {
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x13, 0x00, 0x3b, 0x0a, 0x00,
+     0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+     0x7f, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x10, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+     0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+     0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+     0x77, 0x77, 0x77, 0x00, 0x00, 0x00, 0x00, 0x3f,
+     0x00, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+     0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+     0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+     0x7f, 0x7f, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
 /**
- * @brief the regular expression used for matching the package name
+ * @brief the strings of the version operators, indexed by lpatom_op_t.
+ */
+static const char *const lpatom_op_str[] = {
+     "", "<", "<=", "=", "=", "~", ">=", ">"
+};
+
+/**
+ * @brief the strings of the blockers, indexed by lpatom_blocker_t.
+ */
+static const char *const lpatom_blocker_str[] = { "", "!", "!!" };
+
+/**
+ * @brief the strings of the slot operators, indexed by lpatom_slotop_t.
+ */
+static const char *const lpatom_slotop_str[] = { "", "=", "*" };
+
+/**
+ * @brief the prefixes of the use dependencies, indexed by lpatom_usetype_t.
+ */
+static const char *const lpatom_useprefix_str[] = {
+     "", "-", "", "!", "", "!"
+};
+
+/**
+ * @brief the suffixes of the use dependencies, indexed by lpatom_usetype_t.
+ */
+static const char *const lpatom_usesuffix_str[] = {
+     "", "", "=", "=", "?", "?"
+};
+
+/**
+ * @brief the strings of the use defaults, indexed by lpatom_usedef_t.
+ */
+static const char *const lpatom_usedef_str[] = { "", "(+)", "(-)" };
+
+/**
+ * @brief a lexed use dependency.
+ */
+typedef struct lpatom_lexuse {
+     lputil_span_t name;        /**< @brief the name of the use flag. */
+     lpatom_usetype_t type;     /**< @brief the type of the dependency. */
+     lpatom_usedef_t def;       /**< @brief the default of the flag. */
+} lpatom_lexuse_t;
+
+/**
+ * @brief the result of lpatom_lex().
+ *
+ * Holds the positions of all parts of an atom string and the parsed version,
+ * nothing is copied.
+ */
+typedef struct lpatom_lex {
+     lputil_span_t cat;         /**< @brief the category. */
+     lputil_span_t name;        /**< @brief the package name. */
+     lputil_span_t ver;         /**< @brief the version. */
+     lputil_span_t slot;        /**< @brief the slot. */
+     lputil_span_t subslot;     /**< @brief the sub-slot. */
+     lputil_span_t repo;        /**< @brief the repository. */
+     lputil_span_t uselist;     /**< @brief the use dependencies between the
+                                 * brackets. */
+     lpversion_t version;       /**< @brief the parsed version. */
+     lpatom_op_t op;            /**< @brief the version operator. */
+     lpatom_blocker_t blocker;  /**< @brief the blocker. */
+     lpatom_slotop_t slotop;    /**< @brief the slot operator. */
+     bool view;                 /**< @brief only check the version and the
+                                 * use dependencies, do not store them. */
+     size_t use_len;            /**< @brief number of use dependencies. */
+     size_t use_size;           /**< @brief the size of @c use. */
+     lpatom_lexuse_t *use;      /**< @brief the use dependencies, points to
+                                 * @c stackuse until it gets too small. */
+     /** @brief initial storage for the use dependencies. */
+     lpatom_lexuse_t stackuse[LPATOM_USE_STACK];
+} lpatom_lex_t;
+
+/**
+ * @brief splits an atom string into its parts.
+ *
+ * The string is read from left to right once, the version is parsed on the
+ * fly. Regardless of the return value, lpatom_lex_free() has to be called
+ * afterwards.
+ *
+ * In view mode, the version and the use dependencies are only checked for
+ * their syntax and nothing is allocated. The size of the numbers in the
+ * version is not checked then.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param lex the lpatom_lex_t object to store the result in.
+ *
+ * @param s the atom string, does not need to be @c nul terminated.
+ *
+ * @param len the length of the atom string.
+ *
+ * @param arena the arena to allocate the version from or @c NULL.
+ *
+ * @param view @c true for view mode.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL s is not a valid package atom.
+ * - @c ERANGE one of the numbers in the version is too big.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
+ */
+static int
+lpatom_lex(lpatom_lex_t *lex, const char *s, size_t len,
+           lputil_arena_t *arena, bool view);
+
+/**
+ * @brief lexes a single use dependency.
+ *
+ * If an error occurs, @c NULL is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param lex the lpatom_lex_t object to append the dependency to.
+ *
+ * @param p the start of the dependency.
  *
- * This regexp will export:
+ * @param end the end of the atom string.
  *
- * - The atom name.
+ * @return the position behind the dependency or @c NULL.
+ *
+ * @b Errors:
+ *
+ * - @c EINVAL p does not point to a valid use dependency.
+ * - This function may also fail and set errno for any of the errors specified
+ *   for the routine malloc(3).
  */
-#define LPATOM_RE_NAME "([A-Za-z0-9+_-]*([A-Za-z+_-]|[A-Za-z+_][0-9]+))(-(([0-\
-9]+([.][0-9]+)*[a-z]?)?)((_(alpha|beta|pre|rc|p)[0-9]*)?)(-r[0-9]+)?)?$"
+static const char *
+lpatom_lex_usedep(lpatom_lex_t *lex, const char *p, const char *end);
+
 /**
- * \@brief the regular expression used for matching the version.
+ * @brief skips an identifier.
  *
- * Thix regexp will export:
+ * @param p the start of the identifier.
  *
- * - the version.
+ * @param end the end of the atom string.
+ *
+ * @param head the character classes the first character must belong to.
+ *
+ * @param tail the character classes the other characters must belong to.
+ *
+ * @return the position behind the identifier, @c p if it is empty.
  */
-#define LPATOM_RE_VER     "(([0-9]+([.][0-9]+)*[a-z]?)(_(alpha|beta|pre|rc|p)[\
-0-9]*)?(-r[0-9]+)?)$"
+static inline const char *
+lpatom_lex_ident(const char *p, const char *end, unsigned char head,
+                 unsigned char tail);
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+/**
+ * @brief frees the memory held by a lpatom_lex_t object.
+ *
+ * @param lex a lpatom_lex_t object.
+ */
+static void
+lpatom_lex_free(lpatom_lex_t *lex);
+
+/**
+ * @brief copies a span into a string area.
+ *
+ * @param str a pointer to the next free byte of the string area, it is
+ * advanced behind the copied and @c nul terminated string.
+ *
+ * @param span the span to copy.
+ *
+ * @return the copied string or @c NULL if the span is missing.
+ */
+static inline char *
+lpatom_span_copy(char **str, const lputil_span_t *span);
+
+/**
+ * @brief checks if a package name is valid.
+ *
+ * A package name must not end in a hyphen followed by something that is a
+ * valid version, as it would be impossible to tell the name and the version
+ * apart. Since a version contains at most one hyphen, only the last two need
+ * to be checked. The characters of the name have already been checked by the
+ * lexer.
+ *
+ * @param name the package name, does not need to be @c nul terminated.
+ *
+ * @param len the length of the name.
+ *
+ * @return @c 0 if the name is valid or @c -1 if not.
+ */
+static int
+lpatom_name_check(const char *name, size_t len);
+
+/**
+ * @brief finds the atoms in a newline separated buffer.
+ *
+ * @param batch the lpatom_batch_t object to store the positions in. If its
+ * @c entries are @c NULL, the atoms are only counted.
+ *
+ * @param buf the buffer.
+ *
+ * @param len the length of the buffer.
+ *
+ * @return the number of atoms.
+ */
+static size_t
+lpatom_batch_scan(lpatom_batch_t *batch, const char *buf, size_t len);
+
+/**
+ * @brief parses a range of the entries of a batch.
+ *
+ * This is the lputil_parallel_fn_t of lpatom_parse_batch().
+ *
+ * @param ctx a lpatom_batch_ctx_t object.
+ * @param worker the number of the worker, selects the arena.
+ * @param begin the first entry.
+ * @param end the entry behind the last one.
+ */
+static void
+lpatom_batch_work(void *ctx, unsigned int worker, size_t begin, size_t end);
+
+/**
+ * @brief the IDs and strings of the process wide symbol table for the IDs of
+ * the symbol table of a worker.
+ */
+typedef struct lpatom_batch_map {
+     uint32_t *ids;             /**< @brief the global IDs, indexed by the
+                                 * local ones. */
+     const char **strs;         /**< @brief the global strings, indexed by
+                                 * the local IDs. */
+} lpatom_batch_map_t;
+
+/**
+ * @brief the context of lpatom_batch_work() and lpatom_batch_remap().
+ */
+typedef struct lpatom_batch_ctx {
+     lpatom_batch_t *batch;     /**< @brief the batch. */
+     const char *buf;           /**< @brief the parsed buffer. */
+     lputil_symtab_t **tabs;    /**< @brief the symbol table of each worker,
+                                 * so the workers do not share a lock. */
+     lpatom_batch_map_t *maps;  /**< @brief the map of each worker. */
+} lpatom_batch_ctx_t;
+
+/**
+ * @brief moves the symbol table of every worker of a batch into the process
+ * wide one.
+ *
+ * Interns every string of every worker once and fills in the maps of the
+ * context. If an error occurs, @c -1 is returned and errno is set to
+ * indicate the error.
+ *
+ * @param c the context of the batch.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ */
+static int
+lpatom_batch_merge(lpatom_batch_ctx_t *c);
+
+/**
+ * @brief replaces the local IDs and strings of a range of the entries of a
+ * batch by the ones of the process wide symbol table.
+ *
+ * This is the lputil_parallel_fn_t run after lpatom_batch_merge(), the
+ * worker of an entry is found through the arena of its atom.
+ *
+ * @param ctx a lpatom_batch_ctx_t object.
+ * @param worker unused.
+ * @param begin the first entry.
+ * @param end the entry behind the last one.
+ */
+static void
+lpatom_batch_remap(void *ctx, unsigned int worker, size_t begin, size_t end);
+
+/**
+ * @brief parses an atom, interning category and name in a given table.
+ *
+ * Works like lpatom_parse_len().
+ *
+ * @param handle the lpatom_t handle.
+ * @param s the atom, does not need to be @c nul terminated.
+ * @param len the length of the atom.
+ * @param tab the table or @c NULL for the process wide one.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ */
+static int
+lpatom_parse_tab(lpatom_t *handle, const char *s, size_t len,
+                 lputil_symtab_t *tab);
+
+static int
+lpatom_lex(lpatom_lex_t *lex, const char *s, size_t len,
+           lputil_arena_t *arena, bool view)
+{
+     const char *p = s, *end = s+len, *start, *v, *vend = NULL;
+     bool catonly = false;
+     unsigned char c;
+
+     memset(lex, 0, offsetof(lpatom_lex_t, stackuse));
+     lpversion_init_arena(&lex->version, arena);
+     lex->use = lex->stackuse;
+     lex->use_size = LPATOM_USE_STACK;
+     lex->view = view;
+
+     /* blocker and version operator */
+     if ( LPATOM_PEEK(p, end) == '!' ) {
+          lex->blocker = LPA_BLOCK_WEAK;
+          ++p;
+          if ( LPATOM_PEEK(p, end) == '!' ) {
+               lex->blocker = LPA_BLOCK_STRONG;
+               ++p;
+          }
+     }
+     switch ( LPATOM_PEEK(p, end) ) {
+     case '<':
+          lex->op = LPATOM_PEEK(p+1, end) == '=' ? LPA_OP_LE : LPA_OP_LT;
+          break;
+     case '>':
+          lex->op = LPATOM_PEEK(p+1, end) == '=' ? LPA_OP_GE : LPA_OP_GT;
+          break;
+     case '=':
+          lex->op = LPA_OP_EQ;
+          break;
+     case '~':
+          lex->op = LPA_OP_TILDE;
+          break;
+     default:
+          break;
+     }
+     p += strlen(lpatom_op_str[lex->op]);
+
+     /* category, name and version: the first slash ends the category, the
+      * first hyphen that is followed by a valid version ends the name. */
+     start = lex->name.s = p;
+     for ( ; p < end; ++p ) {
+          c = lpatom_ctype[(unsigned char)*p];
+          if ( *p == '/' ) {
+               /* only one category which must not be empty */
+               if ( lex->cat.s != NULL || p == start ||
+                    (lpatom_ctype[(unsigned char)*start] & LPATOM_C_HEAD)
+                    == 0 )
+                    goto lpatom_lex_einval;
+               lex->cat.s = start;
+               lex->cat.len = (size_t)(p-start);
+               lex->name.s = p+1;
+               catonly = false;
+               continue;
+          }
+          if ( (c & LPATOM_C_NAME) == 0 ) {
+               /* characters only allowed in categories are fine as long as
+                * a slash follows */
+               if ( (c & LPATOM_C_CAT) == 0 || lex->cat.s != NULL )
+                    break;
+               catonly = true;
+               continue;
+          }
+          if ( *p != '-' || catonly || LPATOM_PEEK(p+1, end) < '0' ||
+               p[1] > '9' )
+               continue;
+          /* a version runs up to the end of the package part of the atom */
+          for ( v = p+1; v < end &&
+                     (lpatom_ctype[(unsigned char)*v] & LPATOM_C_VER) != 0;
+                ++v )
+               ;
+          if ( v != end && *v != ':' && *v != '[' && *v != '*' )
+               continue;
+          if ( (view ? lpversion_check(p+1, (size_t)(v-p-1)) :
+                lpversion_parse_len(&lex->version, p+1, (size_t)(v-p-1)))
+               == 0 ) {
+               lex->ver.s = p+1;
+               lex->ver.len = (size_t)(v-p-1);
+               vend = v;
+               break;
+          }
+          if ( errno != EINVAL )
+               return -1;
+     }
+     lex->name.len = (size_t)(p-lex->name.s);
+     if ( catonly || lpatom_name_check(lex->name.s, lex->name.len) == -1 )
+          goto lpatom_lex_einval;
+     if ( vend != NULL )
+          p = vend;
+
+     /* an operator needs a version, the glob only works with = */
+     if ( lex->op != LPA_OP_NONE && lex->ver.s == NULL )
+          goto lpatom_lex_einval;
+     if ( LPATOM_PEEK(p, end) == '*' ) {
+          if ( lex->op != LPA_OP_EQ )
+               goto lpatom_lex_einval;
+          lex->op = LPA_OP_GLOB;
+          ++p;
+     }
+
+     /* slot, sub-slot and slot operator */
+     if ( LPATOM_PEEK(p, end) == ':' && LPATOM_PEEK(p+1, end) != ':' ) {
+          if ( LPATOM_PEEK(p+1, end) == '*' ) {
+               lex->slotop = LPA_SLOT_ANY;
+               p += 2;
+          } else {
+               ++p;
+               if ( LPATOM_PEEK(p, end) != '=' ) {
+                    lex->slot.s = p;
+                    p = lpatom_lex_ident(p, end, LPATOM_C_HEAD,
+                                         LPATOM_C_CAT);
+                    if ( (lex->slot.len = (size_t)(p-lex->slot.s)) == 0 )
+                         goto lpatom_lex_einval;
+                    if ( LPATOM_PEEK(p, end) == '/' ) {
+                         lex->subslot.s = ++p;
+                         p = lpatom_lex_ident(p, end, LPATOM_C_HEAD,
+                                              LPATOM_C_CAT);
+                         if ( (lex->subslot.len = (size_t)(p-lex->subslot.s))
+                              == 0 )
+                              goto lpatom_lex_einval;
+                    }
+               }
+               if ( LPATOM_PEEK(p, end) == '=' ) {
+                    lex->slotop = LPA_SLOT_EQ;
+                    ++p;
+               }
+          }
+     }
+
+     /* repository */
+     if ( LPATOM_PEEK(p, end) == ':' && LPATOM_PEEK(p+1, end) == ':' ) {
+          lex->repo.s = p += 2;
+          p = lpatom_lex_ident(p, end, LPATOM_C_HEAD, LPATOM_C_REPO);
+          if ( (lex->repo.len = (size_t)(p-lex->repo.s)) == 0 )
+               goto lpatom_lex_einval;
+     }
+
+     /* use dependencies */
+     if ( LPATOM_PEEK(p, end) == '[' ) {
+          lex->uselist.s = p+1;
+          do {
+               if ( (p = lpatom_lex_usedep(lex, p+1, end)) == NULL )
+                    return -1;
+          } while ( LPATOM_PEEK(p, end) == ',' );
+          if ( LPATOM_PEEK(p, end) != ']' )
+               goto lpatom_lex_einval;
+          lex->uselist.len = (size_t)(p-lex->uselist.s);
+          ++p;
+     }
+
+     if ( p != end )
+          goto lpatom_lex_einval;
+
+     return 0;
+
+lpatom_lex_einval:
+     errno = EINVAL;
+     return -1;
+}
+
+static const char *
+lpatom_lex_usedep(lpatom_lex_t *lex, const char *p, const char *end)
+{
+     lpatom_lexuse_t *use, *t;
+     char prefix = '\0';
+
+     /* in view mode the dependencies are not kept, the first slot is
+      * reused */
+     if ( ! lex->view && lex->use_len == lex->use_size ) {
+          if ( lex->use == lex->stackuse ) {
+               if ( (t = malloc(sizeof(lpatom_lexuse_t)*lex->use_size*2))
+                    != NULL )
+                    memcpy(t, lex->stackuse,
+                           sizeof(lpatom_lexuse_t)*lex->use_len);
+          } else
+               t = realloc(lex->use,
+                           sizeof(lpatom_lexuse_t)*lex->use_size*2);
+          if ( t == NULL )
+               return NULL;
+          lex->use = t;
+          lex->use_size *= 2;
+     }
+     use = lex->view ? lex->stackuse : &lex->use[lex->use_len];
+
+     if ( LPATOM_PEEK(p, end) == '!' || LPATOM_PEEK(p, end) == '-' )
+          prefix = *p++;
+     use->name.s = p;
+     p = lpatom_lex_ident(p, end, LPATOM_C_ALNUM, LPATOM_C_USE);
+     if ( (use->name.len = (size_t)(p-use->name.s)) == 0 )
+          goto lpatom_lex_usedep_einval;
+
+     use->def = LPA_USEDEF_NONE;
+     if ( end-p >= 3 && p[0] == '(' && (p[1] == '+' || p[1] == '-') &&
+          p[2] == ')' ) {
+          use->def = p[1] == '+' ? LPA_USEDEF_ENABLED : LPA_USEDEF_DISABLED;
+          p += 3;
+     }
+
+     /* -foo can not be conditional, !foo has to be */
+     switch ( LPATOM_PEEK(p, end) ) {
+     case '=':
+          if ( prefix == '-' )
+               goto lpatom_lex_usedep_einval;
+          use->type = prefix == '!' ? LPA_USE_NEQUAL : LPA_USE_EQUAL;
+          ++p;
+          break;
+     case '?':
+          if ( prefix == '-' )
+               goto lpatom_lex_usedep_einval;
+          use->type = prefix == '!' ? LPA_USE_IFNOT : LPA_USE_IF;
+          ++p;
+          break;
+     default:
+          if ( prefix == '!' )
+               goto lpatom_lex_usedep_einval;
+          use->type = prefix == '-' ? LPA_USE_DISABLED : LPA_USE_ENABLED;
+          break;
+     }
+     ++lex->use_len;
+
+     return p;
+
+lpatom_lex_usedep_einval:
+     errno = EINVAL;
+     return NULL;
+}
+
+static inline const char *
+lpatom_lex_ident(const char *p, const char *end, unsigned char head,
+                 unsigned char tail)
+{
+     if ( p == end || (lpatom_ctype[(unsigned char)*p] & head) == 0 )
+          return p;
+     for ( ++p; p < end && (lpatom_ctype[(unsigned char)*p] & tail) != 0;
+           ++p )
+          ;
+     return p;
+}
+
+static void
+lpatom_lex_free(lpatom_lex_t *lex)
+{
+     lpversion_reset(&lex->version);
+     if ( lex->use != lex->stackuse )
+          free(lex->use);
+     lex->use = lex->stackuse;
+
+     return;
+}
+
+static inline char *
+lpatom_span_copy(char **str, const lputil_span_t *span)
+{
+     char *r = *str;
+
+     if ( span->s == NULL )
+          return NULL;
+     memcpy(r, span->s, span->len);
+     r[span->len] = '\0';
+     *str = r+span->len+1;
+
+     return r;
+}
+
+static int
+lpatom_name_check(const char *name, size_t len)
+{
+     const char *p;
+     int hyphens = 0;
+
+     if ( len == 0 || (lpatom_ctype[(unsigned char)name[0]] & LPATOM_C_HEAD)
+          == 0 || name[len-1] == '-' )
+          return -1;
+
+     for ( p = name+len-1; p > name && hyphens < 2; --p ) {
+          if ( *p != '-' )
+               continue;
+          ++hyphens;
+          if ( lpversion_check(p+1, (size_t)(name+len-p-1)) == 0 )
+               return -1;
+     }
+
+     return 0;
+}
 
 extern int
 lpatom_parse(lpatom_t *handle, const char *s)
-/*@requires isnull handle->fname, handle->cat, handle->name,
-handle->version@*/
+/*@requires isnull handle->cat, handle->name, handle->version,
+handle->use@*/
 {
-     regmatch_t match[512];
-     char *vs;
-     int ret;
+     return lpatom_parse_len(handle, s, strlen(s));
+}
+
+extern int
+lpatom_parse_len(lpatom_t *handle, const char *s, size_t len)
+/*@requires isnull handle->cat, handle->name, handle->version,
+handle->use@*/
+{
+     return lpatom_parse_tab(handle, s, len, NULL);
+}
 
-     /* FIXME: add proper error handling */
-     if ( regexec(&handle->regex.atom, s, 0, match, 0) != 0 ) {
-          errno = EINVAL;
+static int
+lpatom_parse_tab(lpatom_t *handle, const char *s, size_t len,
+                 lputil_symtab_t *tab)
+{
+     lpatom_lex_t lex;
+     lputil_span_t *spans[3];
+     const char *name, *cat = NULL;
+     uint32_t name_id, cat_id = 0;
+     size_t size, i;
+     char *str;
+
+     if ( lpatom_lex(&lex, s, len, handle->arena, false) == -1 )
+          goto lpatom_parse_bailout;
+
+     /* category and name are shared by all atoms */
+     if ( (name_id = tab == NULL ?
+           lputil_intern(lex.name.s, lex.name.len, &name) :
+           lputil_symtab_intern(tab, lex.name.s, lex.name.len, &name)) == 0 )
+          goto lpatom_parse_bailout;
+     if ( lex.cat.s != NULL &&
+          (cat_id = tab == NULL ?
+           lputil_intern(lex.cat.s, lex.cat.len, &cat) :
+           lputil_symtab_intern(tab, lex.cat.s, lex.cat.len, &cat)) == 0 )
+          goto lpatom_parse_bailout;
+
+     /* all other strings and the use dependencies go into a single block,
+      * the use dependencies first to keep them aligned */
+     spans[0] = &lex.slot;
+     spans[1] = &lex.subslot;
+     spans[2] = &lex.repo;
+     size = sizeof(lpatom_usedep_t)*lex.use_len;
+     for ( i=0; i < 3; ++i )
+          if ( spans[i]->s != NULL )
+               size += spans[i]->len+1;
+     for ( i=0; i < lex.use_len; ++i )
+          size += lex.use[i].name.len+1;
+
+     if ( handle->arena != NULL ) {
+          if ( lex.version.va != NULL ) {
+               if ( (handle->version = lputil_arena_alloc(
+                         handle->arena, sizeof(lpversion_t))) == NULL )
+                    goto lpatom_parse_bailout;
+               *handle->version = lex.version;
+               lex.version.va = NULL;
+          }
+          if ( size > 0 &&
+               (handle->use = lputil_arena_alloc(handle->arena, size))
+               == NULL ) {
+               handle->version = NULL;
+               goto lpatom_parse_bailout;
+          }
+     } else {
+          if ( lex.version.va != NULL ) {
+               if ( (handle->version = lpversion_create()) == NULL )
+                    goto lpatom_parse_bailout;
+               *handle->version = lex.version;
+               lex.version.va = NULL;
+          }
+          if ( size > 0 && (handle->use = malloc(size)) == NULL ) {
+               if ( handle->version != NULL ) {
+                    lpversion_destroy(handle->version);
+                    handle->version = NULL;
+               }
+               goto lpatom_parse_bailout;
+          }
+     }
+
+     handle->name = name;
+     handle->name_id = name_id;
+     handle->cat = cat;
+     handle->cat_id = cat_id;
+     str = handle->use != NULL ? (char *)(handle->use+lex.use_len) : NULL;
+     handle->slot = lpatom_span_copy(&str, &lex.slot);
+     handle->subslot = lpatom_span_copy(&str, &lex.subslot);
+     handle->repo = lpatom_span_copy(&str, &lex.repo);
+     for ( i=0; i < lex.use_len; ++i ) {
+          handle->use[i].name = lpatom_span_copy(&str, &lex.use[i].name);
+          handle->use[i].type = lex.use[i].type;
+          handle->use[i].def = lex.use[i].def;
+     }
+     handle->use_len = lex.use_len;
+     handle->op = lex.op;
+     handle->blocker = lex.blocker;
+     handle->slotop = lex.slotop;
+
+     lpatom_lex_free(&lex);
+     return 0;
+
+lpatom_parse_bailout:
+     lpatom_lex_free(&lex);
+     return -1;
+}
+
+extern int
+lpatom_view_parse(lpatom_view_t *view, const char *s, size_t len)
+{
+     lpatom_lex_t lex;
+     lputil_span_t *spans[7];
+     lpatom_field_t *fields[7];
+     size_t i;
+
+     if ( lpatom_lex(&lex, s, len, NULL, true) == -1 )
           return -1;
+
+     spans[0] = &lex.cat;
+     fields[0] = &view->cat;
+     spans[1] = &lex.name;
+     fields[1] = &view->name;
+     spans[2] = &lex.ver;
+     fields[2] = &view->version;
+     spans[3] = &lex.slot;
+     fields[3] = &view->slot;
+     spans[4] = &lex.subslot;
+     fields[4] = &view->subslot;
+     spans[5] = &lex.repo;
+     fields[5] = &view->repo;
+     spans[6] = &lex.uselist;
+     fields[6] = &view->use;
+     for ( i=0; i < 7; ++i ) {
+          fields[i]->off = spans[i]->s != NULL ? (size_t)(spans[i]->s-s) : 0;
+          fields[i]->len = spans[i]->len;
      }
-     
-     /* FIXME: add proper error handling */
-     if ( regexec(&handle->regex.category, s, 4, match, 0 ) == 0 )
-          if ( (handle->cat = lputil_get_re_match(match, 1, s)) == NULL )
-               return -1;
+     view->src = s;
+     view->len = len;
+     view->op = lex.op;
+     view->blocker = lex.blocker;
+     view->slotop = lex.slotop;
+
+     return 0;
+}
+
+extern lputil_span_t
+lpatom_view_span(const lpatom_view_t *view, const lpatom_field_t *field)
+{
+     lputil_span_t ret = { NULL, 0 };
 
-     /* FIXME: add error handling */
-     (void)regexec(&handle->regex.name, s, 5, match, 0 );
-     if ( (handle->name = lputil_get_re_match(match, 1, s)) == NULL )
+     if ( field->len != 0 )
+          ret = lputil_substr_span(view->src, field->off, field->len);
+     return ret;
+}
+
+extern int
+lpatom_view_eq(const lpatom_view_t *view, const lpatom_field_t *field,
+               const char *s)
+{
+     return lputil_span_eq(lpatom_view_span(view, field), s);
+}
+
+extern char *
+lpatom_view_strdup(const lpatom_view_t *view, const lpatom_field_t *field)
+{
+     if ( field->len == 0 ) {
+          errno = ENOENT;
+          return NULL;
+     }
+     return lputil_span_strdup(lpatom_view_span(view, field));
+}
+
+extern int
+lpatom_view_version(const lpatom_view_t *view, lpversion_t *handle)
+{
+     if ( view->version.len == 0 ) {
+          errno = ENOENT;
           return -1;
+     }
+     return lpversion_parse_len(handle, view->src+view->version.off,
+                                view->version.len);
+}
 
-     if ( regexec(&handle->regex.version, s, 2, match, 0 ) == 0 ) {
-          if ( (handle->version = lpversion_create()) == NULL )
-               return -1;
-          lpversion_init(handle->version);
-          if ( (vs = lputil_get_re_match(match, 1, s)) == NULL )
+static size_t
+lpatom_batch_scan(lpatom_batch_t *batch, const char *buf, size_t len)
+{
+     const char *p = buf, *end = buf+len, *eol, *t;
+     size_t n = 0, line = 0;
+
+     for ( ; p < end; p = eol+1 ) {
+          ++line;
+          if ( (eol = memchr(p, '\n', (size_t)(end-p))) == NULL )
+               eol = end;
+          while ( p < eol && (*p == ' ' || *p == '\t') )
+               ++p;
+          if ( p == eol || *p == '#' || *p == '\r' )
+               continue;
+          for ( t = p; t < eol && *t != ' ' && *t != '\t' && *t != '\r';
+                ++t )
+               ;
+          if ( batch->entries != NULL ) {
+               batch->entries[n].token.off = (size_t)(p-buf);
+               batch->entries[n].token.len = (size_t)(t-p);
+               batch->entries[n].line = line;
+          }
+          ++n;
+     }
+
+     return n;
+}
+
+static void
+lpatom_batch_work(void *ctx, unsigned int worker, size_t begin, size_t end)
+{
+     lpatom_batch_ctx_t *c = ctx;
+     lpatom_batch_entry_t *e;
+     size_t i;
+
+     for ( i=begin; i < end; ++i ) {
+          e = &c->batch->entries[i];
+          lpatom_init_arena(&e->atom, c->batch->arenas[worker]);
+          e->error = 0;
+          if ( lpatom_parse_tab(&e->atom, c->buf+e->token.off, e->token.len,
+                                c->tabs != NULL ? c->tabs[worker] : NULL)
+               == -1 ) {
+               e->error = errno;
+               lpatom_reset(&e->atom);
+          }
+     }
+
+     return;
+}
+
+static int
+lpatom_batch_merge(lpatom_batch_ctx_t *c)
+{
+     lpatom_batch_map_t *m;
+     const char *s;
+     unsigned int w;
+     size_t count;
+     uint32_t id;
+
+     for ( w=0; w < c->batch->arenas_len; ++w ) {
+          m = &c->maps[w];
+          count = lputil_symtab_count(c->tabs[w]);
+          if ( (m->ids = malloc(sizeof(uint32_t)*(count+1))) == NULL ||
+               (m->strs = malloc(sizeof(const char *)*(count+1))) == NULL )
                return -1;
-          ret = lpversion_parse(handle->version, vs) == -1;
-          free(vs);
-          
-          return ret;
+          m->ids[0] = 0;
+          m->strs[0] = NULL;
+          for ( id=1; id <= count; ++id ) {
+               s = lputil_symtab_str(c->tabs[w], id);
+               if ( (m->ids[id] = lputil_intern(s, strlen(s), &m->strs[id]))
+                    == 0 )
+                    return -1;
+          }
      }
 
      return 0;
 }
 
+static void
+lpatom_batch_remap(void *ctx, unsigned int worker, size_t begin, size_t end)
+{
+     lpatom_batch_ctx_t *c = ctx;
+     const lpatom_batch_map_t *m = NULL;
+     lpatom_t *a;
+     unsigned int w;
+     size_t i;
+
+     for ( i=begin; i < end; ++i ) {
+          a = &c->batch->entries[i].atom;
+          if ( c->batch->entries[i].error != 0 )
+               continue;
+          /* the ranges are contiguous, so the worker rarely changes */
+          if ( m == NULL || a->arena != c->batch->arenas[m-c->maps] )
+               for ( w=0; w < c->batch->arenas_len; ++w )
+                    if ( a->arena == c->batch->arenas[w] )
+                         m = &c->maps[w];
+          a->name = m->strs[a->name_id];
+          a->name_id = m->ids[a->name_id];
+          a->cat = m->strs[a->cat_id];
+          a->cat_id = m->ids[a->cat_id];
+     }
+
+     return;
+}
+
+extern lpatom_batch_t *
+lpatom_parse_batch(const char *buf, size_t len, unsigned int threads)
+{
+     lpatom_batch_t *batch;
+     lpatom_batch_ctx_t ctx;
+     unsigned int workers = 0, w;
+     size_t i;
+     int saved;
+
+     if ( (batch = malloc(sizeof(lpatom_batch_t))) == NULL )
+          return NULL;
+     batch->entries = NULL;
+     batch->arenas = NULL;
+     batch->arenas_len = 0;
+     batch->failed = 0;
+     ctx.tabs = NULL;
+     ctx.maps = NULL;
+
+     /* count first, so the entries can be allocated at once */
+     batch->len = lpatom_batch_scan(batch, buf, len);
+     if ( batch->len > 0 ) {
+          if ( (batch->entries = malloc(sizeof(lpatom_batch_entry_t)*
+                                        batch->len)) == NULL )
+               goto lpatom_parse_batch_bailout;
+          lpatom_batch_scan(batch, buf, len);
+     }
+
+     /* arenas are not thread safe, every worker gets one of its own, and
+      * with more than one worker a symbol table of its own as well, so that
+      * the workers do not wait for the lock of the process wide one */
+     workers = lputil_parallel_workers(batch->len, LPATOM_BATCH_MIN,
+                                       threads);
+     if ( (batch->arenas = malloc(sizeof(lputil_arena_t *)*workers))
+          == NULL )
+          goto lpatom_parse_batch_bailout;
+     if ( workers > 1 &&
+          ((ctx.tabs = calloc(workers, sizeof(lputil_symtab_t *))) == NULL ||
+           (ctx.maps = calloc(workers, sizeof(lpatom_batch_map_t))) == NULL) )
+          goto lpatom_parse_batch_bailout;
+     for ( ; batch->arenas_len < workers; ++batch->arenas_len )
+          if ( (batch->arenas[batch->arenas_len] = lputil_arena_create(0))
+               == NULL || (ctx.tabs != NULL &&
+               (ctx.tabs[batch->arenas_len] = lputil_symtab_create())
+               == NULL) )
+               goto lpatom_parse_batch_bailout;
+
+     ctx.batch = batch;
+     ctx.buf = buf;
+     lputil_parallel(batch->len, workers, lpatom_batch_work, &ctx);
+
+     /* every distinct string takes the lock of the process wide table once
+      * per worker, then all atoms are moved over to it */
+     if ( ctx.tabs != NULL ) {
+          if ( lpatom_batch_merge(&ctx) == -1 )
+               goto lpatom_parse_batch_bailout;
+          lputil_parallel(batch->len, workers, lpatom_batch_remap, &ctx);
+     }
+
+     for ( i=0; i < batch->len; ++i )
+          if ( batch->entries[i].error != 0 )
+               ++batch->failed;
+
+     for ( w=0; ctx.tabs != NULL && w < workers; ++w ) {
+          lputil_symtab_destroy(ctx.tabs[w]);
+          free(ctx.maps[w].ids);
+          free(ctx.maps[w].strs);
+     }
+     free(ctx.tabs);
+     free(ctx.maps);
+     return batch;
+
+lpatom_parse_batch_bailout:
+     saved = errno;
+     for ( w=0; ctx.tabs != NULL && w < workers; ++w )
+          lputil_symtab_destroy(ctx.tabs[w]);
+     for ( w=0; ctx.maps != NULL && w < workers; ++w ) {
+          free(ctx.maps[w].ids);
+          free(ctx.maps[w].strs);
+     }
+     free(ctx.tabs);
+     free(ctx.maps);
+     lpatom_batch_destroy(batch);
+     errno = saved;
+     return NULL;
+}
+
+extern void
+lpatom_batch_destroy(lpatom_batch_t *batch)
+{
+     unsigned int i;
+
+     if ( batch != NULL ) {
+          /* all atoms live in the arenas */
+          for ( i=0; i < batch->arenas_len; ++i )
+               lputil_arena_destroy(batch->arenas[i]);
+          free(batch->arenas);
+          free(batch->entries);
+          free(batch);
+     }
+     return;
+}
+
 /*@only@*//*@null@*//*@out@*/
 extern lpatom_t *
 lpatom_create(void)
@@ -150,39 +1158,67 @@ lpatom_create(void)
      return malloc(sizeof(lpatom_t));
 }
 
+extern lpatom_t *
+lpatom_create_alloc(const lputil_alloc_t *alloc)
+{
+     /* without an allocator the handle is counted for this module, just
+      * like with lpatom_create() */
+     if ( alloc == NULL )
+          return malloc(sizeof(lpatom_t));
+     return lputil_alloc(alloc, sizeof(lpatom_t));
+}
+
 extern void
 lpatom_init(lpatom_t *handle)
 /*@sets handle@*//*@ensures isnull handle->name, handle->cat,
-handle->version, handle->fname@*/
+handle->version, handle->use@*/
 {
      handle->name = NULL;
      handle->cat = NULL;
      handle->version = NULL;
+     handle->slot = NULL;
+     handle->subslot = NULL;
+     handle->repo = NULL;
+     handle->use = NULL;
+     handle->use_len = 0;
+     handle->op = LPA_OP_NONE;
+     handle->blocker = LPA_BLOCK_NONE;
+     handle->slotop = LPA_SLOT_NONE;
+     handle->name_id = 0;
+     handle->cat_id = 0;
+     handle->arena = NULL;
+
+     return;
+}
+
+extern void
+lpatom_init_arena(lpatom_t *handle, lputil_arena_t *arena)
+/*@sets handle@*//*@ensures isnull handle->name, handle->cat,
+handle->version, handle->use@*/
+{
+     lpatom_init(handle);
+     handle->arena = arena;
 
-     /* FIXME: add error handling */
-     (void)regcomp(&handle->regex.atom, LPATOM_RE, REG_EXTENDED);
-     (void)regcomp(&handle->regex.category, LPATOM_RE_CAT, REG_EXTENDED);
-     (void)regcomp(&handle->regex.name, LPATOM_RE_NAME, REG_EXTENDED);
-     (void)regcomp(&handle->regex.version, LPATOM_RE_VER, REG_EXTENDED);
      return;
 }
 
 extern void
 lpatom_reset(lpatom_t *handle)
 /*@sets handle@*//*@ensures isnull handle->name, handle->cat,
-handle->version, handle->fname@*/
+handle->version, handle->use@*/
 {
-     free(handle->name);
-     free(handle->cat);
+     lputil_arena_t *arena = handle->arena;
 
-     if ( handle->version != NULL ) {
-          lpversion_destroy(handle->version);
-          handle->version = NULL;
+     /* category and name are interned, all other strings live in the block
+      * starting at use, memory from an arena is released together with the
+      * arena */
+     if ( arena == NULL ) {
+          free(handle->use);
+          if ( handle->version != NULL )
+               lpversion_destroy(handle->version);
      }
-     
-     handle->name = NULL;
-     handle->cat = NULL;
-     handle->version = NULL;
+
+     lpatom_init_arena(handle, arena);
 
      return;
 }
@@ -190,18 +1226,23 @@ handle->version, handle->fname@*/
 extern void
 lpatom_destroy(lpatom_t *handle)
 {
-     if (handle != NULL) {
-          regfree(&handle->regex.atom);
-          regfree(&handle->regex.category);
-          regfree(&handle->regex.name);
-          regfree(&handle->regex.version);
+     lpatom_destroy_alloc(handle, NULL);
+     return;
+}
 
-          if ( handle->version != NULL )
-               lpversion_destroy(handle->version);
-          
-          free(handle->name);
-          free(handle->cat);
-          free(handle);
+extern void
+lpatom_destroy_alloc(lpatom_t *handle, const lputil_alloc_t *alloc)
+{
+     if (handle != NULL) {
+          if ( handle->arena == NULL ) {
+               if ( handle->version != NULL )
+                    lpversion_destroy(handle->version);
+               free(handle->use);
+          }
+          if ( alloc == NULL )
+               free(handle);
+          else
+               lputil_free(alloc, handle);
      }
      return;
 }
@@ -211,12 +1252,15 @@ lpatom_cmp(const lpatom_t *atom1, const lpatom_t *atom2)
 {
      int ret;
 
-     if ( atom1->cat != NULL && atom2->cat != NULL )
+     /* equal symbol IDs mean equal strings */
+     if ( atom1->cat != NULL && atom2->cat != NULL &&
+          (atom1->cat_id == 0 || atom1->cat_id != atom2->cat_id) )
           if ( (ret = strcmp(atom1->cat, atom2->cat)) != 0 )
                return ret;
      
-     if ( (ret = strcmp(atom1->name, atom2->name)) != 0 )
-          return ret;
+     if ( atom1->name_id == 0 || atom1->name_id != atom2->name_id )
+          if ( (ret = strcmp(atom1->name, atom2->name)) != 0 )
+               return ret;
      
      if ( atom1->version != NULL && atom2->version != NULL )
           return lpversion_cmp(atom1->version, atom2->version);
@@ -224,39 +1268,343 @@ lpatom_cmp(const lpatom_t *atom1, const lpatom_t *atom2)
      return 0;
 }
 
+extern int
+lpatom_cmp_id(const lpatom_t *atom1, const lpatom_t *atom2)
+{
+     if ( atom1->cat != NULL && atom2->cat != NULL &&
+          atom1->cat_id != atom2->cat_id )
+          return atom1->cat_id < atom2->cat_id ? -1 : 1;
+
+     if ( atom1->name_id != atom2->name_id )
+          return atom1->name_id < atom2->name_id ? -1 : 1;
+
+     if ( atom1->version != NULL && atom2->version != NULL )
+          return lpversion_cmp(atom1->version, atom2->version);
+
+     return 0;
+}
+
+extern size_t
+lpatom_key(const lpatom_t *handle, void *buf, size_t len)
+{
+     uint8_t *key = buf;
+     size_t n = 0, l;
+
+     if ( handle->cat != NULL ) {
+          l = strlen(handle->cat);
+          if ( n < len )
+               memcpy(key+n, handle->cat, l < len-n ? l : len-n);
+          n += l;
+     }
+     if ( n < len )
+          key[n] = 0;
+     ++n;
+     l = strlen(handle->name);
+     if ( n < len )
+          memcpy(key+n, handle->name, l < len-n ? l : len-n);
+     n += l;
+     if ( n < len )
+          key[n] = 0;
+     ++n;
+     if ( handle->version != NULL )
+          n += lpversion_key(handle->version, n < len ? key+n : NULL,
+                             n < len ? len-n : 0);
+
+     return n;
+}
+
+static size_t
+lpatom_sort_key(const void *item, void *buf, size_t len)
+{
+     return lpatom_key(item, buf, len);
+}
+
+extern int
+lpatom_sort(const lpatom_t **atoms, size_t n, unsigned int threads)
+{
+     return lputil_keysort((const void **)atoms, n, lpatom_sort_key,
+                           threads);
+}
+
 extern char *
 lpatom_compile(const lpatom_t *handle)
 {
-     char *ret, *ver = NULL, *tmp;
-     size_t len = 1;
+     lputil_strbuf_t sb;
 
+     lputil_strbuf_init(&sb);
+     if ( lpatom_compile_buf(handle, &sb) == -1 )
+          return NULL;
+
+     return lputil_strbuf_detach(&sb);
+}
+
+extern int
+lpatom_compile_buf(const lpatom_t *handle, lputil_strbuf_t *sb)
+{
+     char *p;
+     size_t len;
+
+     len = lpatom_compile_into(handle, NULL, 0);
+     if ( (p = lputil_strbuf_extend(sb, len)) == NULL )
+          return -1;
+     (void)lpatom_compile_into(handle, p, len+1);
+
+     return 0;
+}
+
+extern size_t
+lpatom_compile_into(const lpatom_t *handle, char *buf, size_t cap)
+{
+     const lpatom_usedep_t *use;
+     const char *t;
+     size_t off = 0, i;
+
+     t = lpatom_blocker_str[handle->blocker];
+     off = lputil_bufcat(buf, cap, off, t, strlen(t));
+     t = lpatom_op_str[handle->op];
+     off = lputil_bufcat(buf, cap, off, t, strlen(t));
+     if ( handle->cat != NULL ) {
+          off = lputil_bufcat(buf, cap, off, handle->cat,
+                              strlen(handle->cat));
+          off = lputil_bufcat(buf, cap, off, "/", 1);
+     }
+     off = lputil_bufcat(buf, cap, off, handle->name, strlen(handle->name));
      if ( handle->version != NULL ) {
-          if ( (ver = lpversion_compile(handle->version)) == NULL )
-               return NULL;
-          else {
-               len += strlen(ver)+1;
-          }
+          off = lputil_bufcat(buf, cap, off, "-", 1);
+          /* the version writes straight into the buffer */
+          off += lpversion_compile_into(handle->version,
+                                        off < cap ? buf+off : NULL,
+                                        off < cap ? cap-off : 0);
+     }
+     if ( handle->op == LPA_OP_GLOB )
+          off = lputil_bufcat(buf, cap, off, "*", 1);
+     if ( handle->slot != NULL || handle->slotop != LPA_SLOT_NONE )
+          off = lputil_bufcat(buf, cap, off, ":", 1);
+     if ( handle->slot != NULL )
+          off = lputil_bufcat(buf, cap, off, handle->slot,
+                              strlen(handle->slot));
+     if ( handle->subslot != NULL ) {
+          off = lputil_bufcat(buf, cap, off, "/", 1);
+          off = lputil_bufcat(buf, cap, off, handle->subslot,
+                              strlen(handle->subslot));
+     }
+     t = lpatom_slotop_str[handle->slotop];
+     off = lputil_bufcat(buf, cap, off, t, strlen(t));
+     if ( handle->repo != NULL ) {
+          off = lputil_bufcat(buf, cap, off, "::", 2);
+          off = lputil_bufcat(buf, cap, off, handle->repo,
+                              strlen(handle->repo));
      }
-     if ( handle->cat != NULL )
-          len += strlen(handle->cat)+1;
-     len += strlen(handle->name);
+     for ( i=0; i < handle->use_len; ++i ) {
+          use = &handle->use[i];
+          off = lputil_bufcat(buf, cap, off, i == 0 ? "[" : ",", 1);
+          t = lpatom_useprefix_str[use->type];
+          off = lputil_bufcat(buf, cap, off, t, strlen(t));
+          off = lputil_bufcat(buf, cap, off, use->name, strlen(use->name));
+          t = lpatom_usedef_str[use->def];
+          off = lputil_bufcat(buf, cap, off, t, strlen(t));
+          t = lpatom_usesuffix_str[use->type];
+          off = lputil_bufcat(buf, cap, off, t, strlen(t));
+     }
+     if ( handle->use_len > 0 )
+          off = lputil_bufcat(buf, cap, off, "]", 1);
+     if ( cap > 0 )
+          buf[off < cap ? off : cap-1] = '\0';
 
-     if ( (ret = malloc(len)) == NULL ) {
-          free(ver);
-          return NULL;
+     return off;
+}
+
+extern int
+lpatom_constraint_compile(lpatom_constraint_t *c, const lpatom_t *atom)
+{
+     const lpversion_t *v = atom->version;
+     lpversion_keypart_t part;
+
+     c->op = atom->op;
+     c->key = NULL;
+     c->len = 0;
+     c->prefix = 0;
+     c->accept = 0;
+     if ( v == NULL )
+          return 0;
+
+     c->len = lpversion_key(v, NULL, 0);
+     if ( (c->key = malloc(c->len)) == NULL )
+          return -1;
+     (void)lpversion_key(v, c->key, c->len);
+
+     switch ( atom->op ) {
+     case LPA_OP_LT:
+          c->accept = 0x1;
+          break;
+     case LPA_OP_LE:
+          c->accept = 0x3;
+          break;
+     case LPA_OP_GE:
+          c->accept = 0x6;
+          break;
+     case LPA_OP_GT:
+          c->accept = 0x4;
+          break;
+     case LPA_OP_TILDE:
+          c->prefix = lpversion_key_prefix(v, LPV_KEY_SUFFV);
+          break;
+     case LPA_OP_GLOB:
+          /* only the components given in the atom are compared */
+          if ( v->release != 0 )
+               part = LPV_KEY_ALL;
+          else if ( v->suffv != 0 )
+               part = LPV_KEY_SUFFV;
+          else if ( v->suffix != LPV_NO )
+               part = LPV_KEY_SUFFIX;
+          else if ( v->verc != '\0' )
+               part = LPV_KEY_VERC;
+          else
+               part = LPV_KEY_COMPONENTS;
+          c->prefix = lpversion_key_prefix(v, part);
+          break;
+     default:
+          c->accept = 0x2;
+          break;
      }
-     tmp = ret;
-     if ( handle->cat != NULL ) {
-          tmp = stpcpy(tmp, handle->cat);
-          tmp = stpcpy(tmp, "/");
+
+     return 0;
+}
+
+extern void
+lpatom_constraint_reset(lpatom_constraint_t *c)
+{
+     free(c->key);
+     c->key = NULL;
+     c->len = 0;
+     c->prefix = 0;
+     c->accept = 0;
+}
+
+extern int
+lpatom_constraint_match(const lpatom_constraint_t *c, const void *key,
+                        size_t len)
+{
+     int r;
+
+     if ( c->key == NULL )
+          return 1;
+     if ( c->accept == 0 )
+          return len >= c->prefix && memcmp(key, c->key, c->prefix) == 0;
+
+     /* keys are prefix free, so a common prefix means equal keys */
+     r = memcmp(key, c->key, len < c->len ? len : c->len);
+     r = (r > 0) - (r < 0) + 1;
+
+     return (int)(c->accept >> r) & 1;
+}
+
+extern int
+lpatom_constraint_match_version(const lpatom_constraint_t *c,
+                                const lpversion_t *v)
+{
+     uint8_t stack[LPATOM_KEY_STACK];
+     uint8_t *key = stack;
+     size_t len;
+     int ret;
+
+     if ( c->key == NULL )
+          return 1;
+     len = lpversion_key(v, stack, sizeof(stack));
+     if ( len > sizeof(stack) ) {
+          if ( (key = malloc(len)) == NULL )
+               return -1;
+          (void)lpversion_key(v, key, len);
      }
-     tmp = stpcpy(tmp, handle->name);
-     if ( ver != NULL ) {
-          tmp = stpcpy(tmp, "-");
-          tmp = stpcpy(tmp, ver);
-          free(ver);
+     ret = lpatom_constraint_match(c, key, len);
+     if ( key != stack )
+          free(key);
+
+     return ret;
+}
+
+static inline uint64_t
+lpatom_key_head(const uint8_t *key, size_t len)
+{
+     uint64_t h = 0;
+     size_t i;
+
+#ifdef LPATOM_BSWAP
+     if ( len >= LPATOM_KEY_HEAD ) {
+          memcpy(&h, key, LPATOM_KEY_HEAD);
+#  if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+          h = __builtin_bswap64(h);
+#  endif
+          return h;
      }
-     
+#endif /* LPATOM_BSWAP */
+     for ( i=0; i < LPATOM_KEY_HEAD && i < len; ++i )
+          h |= (uint64_t)key[i] << (56-8*i);
+
+     return h;
+}
+
+extern size_t
+lpatom_constraint_filter(const lpatom_constraint_t *c,
+                         const void *const *keys, const size_t *lens,
+                         size_t n, uint8_t *mask)
+{
+     uint64_t heads[LPATOM_FILTER_BLOCK];
+     int8_t cmp[LPATOM_FILTER_BLOCK];
+     uint64_t chead, hmask = ~(uint64_t)0;
+     const uint8_t *key;
+     size_t b, i, len, min, ret = 0;
+     uint8_t m;
+     int r;
+
+     if ( c->key == NULL ) {
+          if ( mask != NULL )
+               memset(mask, 1, n);
+          return n;
+     }
+     /* ~ and =* only look at the first prefix bytes */
+     if ( c->accept == 0 )
+          hmask = c->prefix == 0 ? 0 : c->prefix >= LPATOM_KEY_HEAD ? hmask :
+               hmask << (64-8*c->prefix);
+     chead = lpatom_key_head(c->key, c->len) & hmask;
+
+     for ( b=0; b < n; b += len ) {
+          len = n-b < LPATOM_FILTER_BLOCK ? n-b : LPATOM_FILTER_BLOCK;
+
+          /* compare the heads of a whole block of keys at once, this loop
+           * has no branches and is left to the vectorizer */
+          for ( i=0; i < len; ++i )
+               heads[i] = lpatom_key_head(keys[b+i], lens[b+i]) & hmask;
+          for ( i=0; i < len; ++i )
+               cmp[i] = (int8_t)((heads[i] > chead) - (heads[i] < chead));
+
+          /* only keys with the same head as the constraint need memcmp(3) on
+           * the rest */
+          for ( i=0; i < len; ++i ) {
+               key = keys[b+i];
+               if ( c->accept == 0 ) {
+                    m = (uint8_t)(lens[b+i] >= c->prefix && cmp[i] == 0 &&
+                                  (c->prefix <= LPATOM_KEY_HEAD ||
+                                   memcmp(key+LPATOM_KEY_HEAD,
+                                          c->key+LPATOM_KEY_HEAD,
+                                          c->prefix-LPATOM_KEY_HEAD) == 0));
+               } else {
+                    r = cmp[i];
+                    min = lens[b+i] < c->len ? lens[b+i] : c->len;
+                    if ( r == 0 && min > LPATOM_KEY_HEAD ) {
+                         r = memcmp(key+LPATOM_KEY_HEAD,
+                                    c->key+LPATOM_KEY_HEAD,
+                                    min-LPATOM_KEY_HEAD);
+                         r = (r > 0) - (r < 0);
+                    }
+                    m = (uint8_t)((c->accept >> (r+1)) & 1);
+               }
+               if ( mask != NULL )
+                    mask[b+i] = m;
+               ret += m;
+          }
+     }
+
      return ret;
 }
 
@@ -35,6 +35,10 @@
 #include <util.h>
 
 #include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #if HAVE_ERRNO_H
 #  include <errno.h>
@@ -55,16 +59,410 @@ extern int errno
 #  include <memory.h>
 #endif /* HAVE_MEMORY_H */
 
+/* vector instructions are chosen at compile time, eg. by -march */
+#if defined(__GNUC__) && defined(__SSE2__)
+#  define LPUTIL_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__AVX2__)
+#    define LPUTIL_AVX2 1
+#    include <immintrin.h>
+#  endif
+#elif defined(__GNUC__) && defined(__ARM_NEON) && defined(__aarch64__)
+#  define LPUTIL_NEON 1
+#  include <arm_neon.h>
+#endif
+
+/* eight digits can be converted at once if they can be loaded into an
+ * integer in string order */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define LPUTIL_SWAR 1
+#endif
+
+/* the bit length of a number is a single instruction on most targets */
+#if defined(__GNUC__)
+#  define LPUTIL_CLZ 1
+#endif
+
+/** @cond */
+#define LPMEM_SUBSYS    LPUTIL_MEM_UTIL
+/** @endcond */
+#include "lpmem.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* this function seems to be in glibc right from the beginning */
-#ifdef __GNUC__
-extern char *
-stpcpy(char *dest, const char *src);
+/**
+ * @brief the default chunk size of an arena.
+ */
+#define LPUTIL_ARENA_CHUNK      65536
+
+/**
+ * @brief the alignment of memory returned by lputil_arena_alloc().
+ */
+#define LPUTIL_ARENA_ALIGN      sizeof(lputil_arena_align_t)
+
+/**
+ * @brief rounds a size up to a multiple of LPUTIL_ARENA_ALIGN.
+ */
+#define LPUTIL_ARENA_ROUND(n)   \
+     (((n)+LPUTIL_ARENA_ALIGN-1) & ~(LPUTIL_ARENA_ALIGN-1))
+
+/**
+ * @brief a type with the strictest alignment requirement.
+ */
+typedef union lputil_arena_align {
+     long double ld;            /**< @brief a long double. */
+     int64_t i;                 /**< @brief a 64bit integer. */
+     void *p;                   /**< @brief a data pointer. */
+     void (*f)(void);           /**< @brief a function pointer. */
+} lputil_arena_align_t;
+
+/**
+ * @brief a chunk of memory allocated by an arena.
+ *
+ * The usable memory starts at the next multiple of LPUTIL_ARENA_ALIGN
+ * behind the header.
+ */
+typedef struct lputil_arena_chunk {
+     struct lputil_arena_chunk *next; /**< @brief the next chunk. */
+} lputil_arena_chunk_t;
+
+struct lputil_arena {
+     lputil_arena_chunk_t *chunks; /**< @brief the chunks allocated after the
+                                    * first one. */
+     char *pos;                 /**< @brief the next free byte. */
+     char *end;                 /**< @brief the end of the current chunk. */
+     size_t size;               /**< @brief the size of a chunk. */
+};
+
+/**
+ * @brief the size of the header of the arena or a chunk.
+ */
+#define LPUTIL_ARENA_HDR(type)  LPUTIL_ARENA_ROUND(sizeof(type))
+
+/**
+ * @brief the initial number of entries of a symbol table.
+ */
+#define LPUTIL_SYMTAB_ENTRIES   256
+
+/**
+ * @brief the initial number of hash slots of a symbol table, must be a power
+ * of two.
+ */
+#define LPUTIL_SYMTAB_SLOTS     1024
+
+/**
+ * @brief a string in a symbol table.
+ */
+typedef struct lputil_symtab_entry {
+     const char *s;             /**< @brief the interned string. */
+     size_t len;                /**< @brief the length of the string. */
+     uint32_t hash;             /**< @brief the hash of the string. */
+} lputil_symtab_entry_t;
+
+struct lputil_symtab {
+     pthread_mutex_t lock;      /**< @brief protects all other members. */
+     lputil_arena_t *arena;     /**< @brief holds the strings. */
+     lputil_symtab_entry_t *entries; /**< @brief the strings indexed by their
+                                      * ID, the first entry is unused. */
+     size_t count;              /**< @brief used entries including the first
+                                 * one. */
+     size_t size;               /**< @brief the size of @c entries. */
+     uint32_t *slots;           /**< @brief open addressing hash table of
+                                 * IDs, @c 0 marks a free slot. */
+     size_t mask;               /**< @brief the number of slots minus one. */
+};
+
+/**
+ * @brief makes sure the process wide symbol table is created only once.
+ */
+static pthread_once_t lputil_intern_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief the process wide symbol table.
+ */
+static lputil_symtab_t *lputil_intern_tab = NULL;
+
+/**
+ * @brief creates the process wide symbol table.
+ */
+static void
+lputil_intern_init(void);
+
+/**
+ * @brief the functions all memory of the library is allocated with.
+ */
+static lputil_memhooks_t lputil_mem_hooks = { malloc, realloc, free };
+
+/**
+ * @brief non-zero if allocations are counted.
+ */
+static int lputil_mem_counting = 0;
+
+/**
+ * @brief the allocation statistics of each part of the library.
+ */
+static lputil_memstat_t lputil_mem_stats[LPUTIL_MEM_MAX];
+
+/**
+ * @brief adds to a counter of lputil_mem_stats, atomically where the
+ * compiler allows it.
+ */
+#if defined(__GNUC__)
+#  define LPUTIL_MEM_ADD(counter, n)                             \
+     __atomic_fetch_add(&(counter), (n), __ATOMIC_RELAXED)
+#else
+#  define LPUTIL_MEM_ADD(counter, n)    ((counter) += (n))
 #endif
 
+/**
+ * @brief counts an allocation if counting is turned on.
+ *
+ * @param subsys the part of the library that allocated.
+ * @param which the counter of the allocation.
+ * @param len the number of bytes requested, @c 0 for frees.
+ */
+#define LPUTIL_MEM_COUNT(subsys, which, len)                           \
+     do {                                                               \
+          if ( lputil_mem_counting && (unsigned)(subsys) < LPUTIL_MEM_MAX ) { \
+               LPUTIL_MEM_ADD(lputil_mem_stats[subsys].which, 1);       \
+               LPUTIL_MEM_ADD(lputil_mem_stats[subsys].bytes, (len));   \
+          }                                                             \
+     } while (0)
+
+/**
+ * @brief hashes a string with FNV-1a.
+ *
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ *
+ * @return the hash value.
+ */
+static inline uint32_t
+lputil_hash(const char *s, size_t len);
+
+/**
+ * @brief finds a string in a symbol table.
+ *
+ * The lock of the table has to be held by the caller.
+ *
+ * @param tab a lputil_symtab_t handle.
+ * @param s the string, does not need to be @c nul terminated.
+ * @param len the length of the string.
+ * @param hash the hash of the string.
+ * @param slot the slot holding the string or the free slot where it would
+ * go is stored here.
+ *
+ * @return the ID of the string or @c 0 if it is not in the table.
+ */
+static uint32_t
+lputil_symtab_find(const lputil_symtab_t *tab, const char *s, size_t len,
+                   uint32_t hash, size_t *slot);
+
+/**
+ * @brief doubles the number of hash slots of a symbol table.
+ *
+ * The lock of the table has to be held by the caller.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error.
+ *
+ * @param tab a lputil_symtab_t handle.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
+ */
+static int
+lputil_symtab_grow(lputil_symtab_t *tab);
+
+struct lputil_pool {
+     lputil_arena_t *arena;     /**< @brief holds the objects. */
+     void *free;                /**< @brief the first free object, each one
+                                 * points to the next. */
+     size_t size;               /**< @brief the size of the objects. */
+};
+
+/**
+ * @brief allocates from an arena, for lputil_alloc_init_arena().
+ */
+static void *
+lputil_alloc_arena_alloc(void *ctx, size_t len);
+
+/**
+ * @brief does nothing, for lputil_alloc_init_arena().
+ */
+static void
+lputil_alloc_arena_free(void *ctx, void *p);
+
+/**
+ * @brief allocates from a pool, for lputil_alloc_init_pool().
+ */
+static void *
+lputil_alloc_pool_alloc(void *ctx, size_t len);
+
+/**
+ * @brief returns an object to a pool, for lputil_alloc_init_pool().
+ */
+static void
+lputil_alloc_pool_free(void *ctx, void *p);
+
+/**
+ * @brief the maximum number of workers of lputil_parallel().
+ */
+#define LPUTIL_PARALLEL_MAX     64
+
+/**
+ * @brief the arguments of a worker thread of lputil_parallel().
+ */
+typedef struct lputil_parallel_arg {
+     lputil_parallel_fn_t fn;   /**< @brief the function to call. */
+     void *ctx;                 /**< @brief the context of @c fn. */
+     unsigned int worker;       /**< @brief the number of the worker. */
+     size_t begin;              /**< @brief the first item. */
+     size_t end;                /**< @brief the item behind the last one. */
+} lputil_parallel_arg_t;
+
+/**
+ * @brief the start routine of the worker threads of lputil_parallel().
+ *
+ * @param arg a lputil_parallel_arg_t object.
+ *
+ * @return always @c NULL.
+ */
+static void *
+lputil_parallel_run(void *arg);
+
+/**
+ * @brief the minimum number of items a worker of lputil_keysort() gets.
+ */
+#define LPUTIL_KEYSORT_MIN      4096
+
+/**
+ * @brief runs up to this length are sorted by insertion.
+ */
+#define LPUTIL_KEYSORT_INSERT   16
+
+/**
+ * @brief an item and its key as sorted by lputil_keysort().
+ */
+typedef struct lputil_keysort_rec {
+     uint64_t head;             /**< @brief the first eight bytes of the key
+                                 * in big-endian order, padded with zeros. */
+     const uint8_t *key;        /**< @brief the key. */
+     size_t len;                /**< @brief the length of the key. */
+     const void *item;          /**< @brief the item. */
+} lputil_keysort_rec_t;
+
+/**
+ * @brief the context of the workers of lputil_keysort().
+ */
+typedef struct lputil_keysort_ctx {
+     const void **items;        /**< @brief the items. */
+     lputil_key_fn_t key;       /**< @brief builds the keys. */
+     lputil_keysort_rec_t *recs; /**< @brief one record per item. */
+     lputil_keysort_rec_t *tmp; /**< @brief scratch space for merging. */
+     uint8_t *keys;             /**< @brief the memory of the keys. */
+     size_t *runs;              /**< @brief the boundaries of the sorted
+                                 * runs. */
+     size_t nruns;              /**< @brief the number of runs. */
+} lputil_keysort_ctx_t;
+
+/**
+ * @brief compares two records of lputil_keysort().
+ *
+ * @param a a record.
+ * @param b a record.
+ *
+ * @return an integer less than, equal to or greater than zero if the key of
+ * @c a is lower, equal or greater than the key of @c b.
+ */
+static inline int
+lputil_keysort_cmp(const lputil_keysort_rec_t *a,
+                   const lputil_keysort_rec_t *b);
+
+/**
+ * @brief merges two sorted runs.
+ *
+ * The runs @c a[0] to @c a[m-1] and @c a[m] to @c a[n-1] are merged into
+ * @c a, @c tmp must have room for @c n records.
+ *
+ * @param a the runs.
+ * @param tmp scratch space.
+ * @param m the length of the first run.
+ * @param n the length of both runs.
+ */
+static void
+lputil_keysort_merge(lputil_keysort_rec_t *a, lputil_keysort_rec_t *tmp,
+                     size_t m, size_t n);
+
+/**
+ * @brief sorts a run of records.
+ *
+ * @param a the records.
+ * @param tmp scratch space for @c n records.
+ * @param n the number of records.
+ */
+static void
+lputil_keysort_run(lputil_keysort_rec_t *a, lputil_keysort_rec_t *tmp,
+                   size_t n);
+
+/**
+ * @brief measures the keys of a range of items, for lputil_parallel().
+ */
+static void
+lputil_keysort_measure(void *ctx, unsigned int worker, size_t begin,
+                       size_t end);
+
+/**
+ * @brief builds the keys of a range of items and sorts them, for
+ * lputil_parallel().
+ */
+static void
+lputil_keysort_build(void *ctx, unsigned int worker, size_t begin,
+                     size_t end);
+
+/**
+ * @brief merges a range of pairs of runs, for lputil_parallel().
+ */
+static void
+lputil_keysort_pairs(void *ctx, unsigned int worker, size_t begin,
+                     size_t end);
+
+/**
+ * @brief the powers of ten that fit into 64 bits.
+ */
+static const uint64_t lputil_pow10[20] = {
+     1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+     10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+     100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+     100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+     100000000000000000ULL, 1000000000000000000ULL,
+     10000000000000000000ULL
+};
+
+/**
+ * @brief the numbers from @c 00 to @c 99 as pairs of digits.
+ */
+static const char lputil_digits100[200] =
+     "00010203040506070809101112131415161718192021222324252627282930313233"
+     "34353637383940414243444546474849505152535455565758596061626364656667"
+     "6869707172737475767778798081828384858687888990919293949596979899";
+
+#ifdef LPUTIL_SWAR
+/**
+ * @brief converts eight decimal digits into an integer.
+ *
+ * The digits are loaded into a 64bit integer and combined in pairs, then in
+ * groups of four and finally all eight, using three multiplications.
+ *
+ * @param s eight digits.
+ *
+ * @return the value of the digits.
+ */
+static inline uint64_t
+lputil_digits8(const char *s);
+#endif /* LPUTIL_SWAR */
+
 extern char *
 lputil_get_re_match(const regmatch_t *match, int n, const char *s)
 {
@@ -74,30 +472,126 @@ lputil_get_re_match(const regmatch_t *match, int n, const char *s)
           return NULL;
      }
      /* get the substring and return it  */
-     return lputil_substr(s, match[n].rm_so, match[n].rm_eo-match[n].rm_so);
+     return lputil_span_strdup(lputil_get_re_match_span(match, n, s));
 }
 
 extern char *
 lputil_substr(const char *s, size_t off, size_t len)
 {
-     char *r;
      /* check if the given pointer is NULL  */
      if ( s == NULL ) {
           errno = EINVAL;
           return NULL;
      }
-     /* allocate oe+1 bytes on the Heap and assign a pointer to that region to
-      * r */
-     if ( (r = malloc(len+1)) == NULL )
-          return NULL;
+     return lputil_span_strdup(lputil_substr_span(s, off, len));
+}
 
-     /* copy oe bytes starting from s+os to r, null terminate r and return the
-      * created c string */
-     memcpy(r, s+off, len);
-     r[len] = '\0';
+extern lputil_span_t
+lputil_get_re_match_span(const regmatch_t *match, int n, const char *s)
+{
+     lputil_span_t ret = { NULL, 0 };
+
+     if ( match[n].rm_so != -1 )
+          ret = lputil_substr_span(s, (size_t)match[n].rm_so,
+                                   (size_t)(match[n].rm_eo-match[n].rm_so));
+     return ret;
+}
+
+extern lputil_span_t
+lputil_substr_span(const char *s, size_t off, size_t len)
+{
+     lputil_span_t ret;
+
+     ret.s = s+off;
+     ret.len = len;
+     return ret;
+}
+
+extern size_t
+lputil_splitstr_span(const char *s, size_t len, const char *delim,
+                     lputil_span_t *spans, size_t max)
+{
+     lputil_tok_t tok;
+     lputil_span_t span;
+     size_t n = 0;
+
+     lputil_tok_init(&tok, s, len, delim);
+     for ( ; lputil_tok_next(&tok, &span) == 1; ++n )
+          if ( n < max )
+               spans[n] = span;
+
+     return n;
+}
+
+extern void
+lputil_tok_init(lputil_tok_t *tok, const char *s, size_t len,
+                const char *delim)
+{
+     tok->p = s;
+     tok->end = s+len;
+     tok->delim = delim;
+     tok->dlen = strlen(delim);
+
+     return;
+}
+
+extern int
+lputil_tok_next(lputil_tok_t *tok, lputil_span_t *span)
+{
+     const char *p = tok->p, *q = NULL;
+     size_t dlen = tok->dlen;
+
+     if ( p == NULL )
+          return 0;
+
+     if ( dlen == 1 )
+          q = memchr(p, tok->delim[0], (size_t)(tok->end-p));
+     else if ( dlen > 1 ) {
+          /* the delimiter can not start in its last dlen-1 characters */
+          q = p;
+          while ( (size_t)(tok->end-q) >= dlen &&
+                  (q = memchr(q, tok->delim[0], (size_t)(tok->end-q)-dlen+1))
+                  != NULL && memcmp(q+1, tok->delim+1, dlen-1) != 0 )
+               ++q;
+          if ( q != NULL && (size_t)(tok->end-q) < dlen )
+               q = NULL;
+     }
+
+     span->s = p;
+     if ( q == NULL ) {
+          span->len = (size_t)(tok->end-p);
+          tok->p = NULL;
+     } else {
+          span->len = (size_t)(q-p);
+          tok->p = q+dlen;
+     }
+
+     return 1;
+}
+
+extern char *
+lputil_span_strdup(lputil_span_t span)
+{
+     char *r;
+
+     if ( span.s == NULL ) {
+          errno = EINVAL;
+          return NULL;
+     }
+     if ( (r = malloc(span.len+1)) == NULL )
+          return NULL;
+     memcpy(r, span.s, span.len);
+     r[span.len] = '\0';
      return r;
 }
 
+extern int
+lputil_span_eq(lputil_span_t span, const char *s)
+{
+     return span.s != NULL && strlen(s) == span.len &&
+          memcmp(span.s, s, span.len) == 0;
+}
+
 extern void *
 lputil_memdup(const void *s, size_t len)
 {
@@ -121,49 +615,32 @@ lputil_memdup(const void *s, size_t len)
 extern char **
 lputil_splitstr(const char *s, const char *delim)
 {
-     char **r, **rt, *st, *stt;
-     unsigned int i, size = 10;
-     size_t dlen = strlen(delim);
+     lputil_tok_t tok;
+     lputil_span_t span;
+     char **r, *st;
+     size_t len, n, i;
 
-     /* allocate memory */
-     if ( (r = malloc(sizeof(char *)*size)) == NULL )
+     if ( s == NULL || delim == NULL ) {
+          errno = EINVAL;
+          return NULL;
+     }
+     len = strlen(s);
+     /* count first, so that the array is allocated exactly once */
+     n = lputil_splitstr_span(s, len, delim, NULL, 0);
+     if ( (r = malloc(sizeof(char *)*(n+1))) == NULL )
           return NULL;
-     if ( (st = strdup(s)) == NULL )
+     if ( (st = lputil_memdup(s, len+1)) == NULL ) {
+          free(r);
           return NULL;
+     }
 
-     /* iterate over chrchr matches */
-     for ( i=0; (stt = strstr(st, delim)) != NULL; ++i ) {
-          /* check if we got enough space left in r */
-          if ( i == (size-1) ) {
-               /* allocate some more space */
-               size += 5;
-               if ( (rt = realloc(r, size)) == NULL ) {
-                    lputil_splitstr_destroy(r);
-                    return NULL;
-               }
-               r = rt;
-          }
-          /* set the start of the found delimiter to \0 */
-          stt[0] = '\0';
-          /* assign the first character after the previously found delimiter
-           * to r[i] */
-          r[i] = st;
-          /* assign the first character after the currently found delimiter to
-           * st */
-          st = stt+dlen;
-     }
-     /* assign the first character after the last delimiter to r[i] */
-     r[i] = st;
-     /* shrink r to optimal size */
-     if ( i < (size) ) {
-          if ( (rt = realloc(r, sizeof(char *)*(i+2))) == NULL ) {
-               lputil_splitstr_destroy(r);
-               return NULL;
-          }
-          r = rt;
+     /* the tokens are terminated in place of the delimiters */
+     lputil_tok_init(&tok, st, len, delim);
+     for ( i=0; lputil_tok_next(&tok, &span) == 1; ++i ) {
+          r[i] = st+(span.s-st);
+          r[i][span.len] = '\0';
      }
-     /* NULL terminate r */
-     r[i+1] = NULL;
+     r[i] = NULL;
      
      return r;
 }
@@ -171,49 +648,66 @@ lputil_splitstr(const char *s, const char *delim)
 extern size_t
 lputil_intlen(int d)
 {
-     size_t i = 0;
+     return lputil_int64len(d);
+}
 
-     /* avoid overflow on negation: value range -2^n .. (2^n)-1 */
-     if ( d == INT_MIN ) {
-          d = INT_MAX;
-          ++i;
-     }
-     if ( d < 0 ) {
-          d = -d;
-          ++i;
-     }
+extern size_t
+lputil_int64len(int64_t d)
+{
+     /* negate as unsigned, so that INT64_MIN does not overflow */
+     if ( d < 0 )
+          return 1+lputil_u64len(-(uint64_t)d);
+     return lputil_u64len((uint64_t)d);
+}
 
-     while ( d >= 10 ) {
-          ++i;
-          d /= 10;
-     }
-     /* we still got one digit left */
-     ++i;
-     return i;
+extern size_t
+lputil_u64len(uint64_t v)
+{
+     size_t n;
+
+#ifdef LPUTIL_CLZ
+     /* 1233/4096 is a little more than log10(2), so n is the number of
+      * digits minus one or one less than that; v|1 has as many digits as v
+      * and a bit length for 0 */
+     v |= 1;
+     n = ((size_t)(64-__builtin_clzll(v))*1233) >> 12;
+     return n+(v >= lputil_pow10[n]);
+#else
+     for ( n=1; n < 20 && v >= lputil_pow10[n]; ++n )
+          ;
+     return n;
+#endif /* LPUTIL_CLZ */
 }
 
 extern size_t
-lputil_int64len(int64_t d)
+lputil_u64toa(char *buf, uint64_t v)
 {
-     size_t i = 0;
+     size_t n = lputil_u64len(v), i;
+     char *p = buf+n;
 
-     /* avoid overflow on negation: value range -2^n .. (2^n)-1 */
-     if ( d == INT64_MIN ) {
-          d = INT64_MAX;
-          ++i;
-     }
-     if ( d < 0 ) {
-          d = -d;
-          ++i;
+     while ( v >= 100 ) {
+          i = (size_t)(v%100)*2;
+          v /= 100;
+          *--p = lputil_digits100[i+1];
+          *--p = lputil_digits100[i];
      }
+     if ( v >= 10 ) {
+          *--p = lputil_digits100[v*2+1];
+          *--p = lputil_digits100[v*2];
+     } else
+          *--p = (char)('0'+v);
+
+     return n;
+}
 
-     while ( d >= 10 ) {
-          ++i;
-          d /= 10;
+extern size_t
+lputil_i64toa(char *buf, int64_t v)
+{
+     if ( v < 0 ) {
+          *buf = '-';
+          return 1+lputil_u64toa(buf+1, -(uint64_t)v);
      }
-     /* we still got one digit left */
-     ++i;
-     return i;
+     return lputil_u64toa(buf, (uint64_t)v);
 }
 
 extern void
@@ -226,26 +720,1076 @@ lputil_splitstr_destroy(char **splitstr)
 extern char *
 lputil_joinstr(const char *sa[], const char *sep)
 {
-     size_t len=1;
-     unsigned int i, j;
-     char *s, *tmp;
+     lputil_strbuf_t sb;
+     size_t seplen = strlen(sep);
+     unsigned int i;
+
+     lputil_strbuf_init(&sb);
+     for ( i=0; sa[i] != NULL; ++i ) {
+          if ( (i > 0 && lputil_strbuf_append(&sb, sep, seplen) == -1) ||
+               lputil_strbuf_append(&sb, sa[i], strlen(sa[i])) == -1 ) {
+               lputil_strbuf_reset(&sb);
+               return NULL;
+          }
+     }
+
+     return lputil_strbuf_detach(&sb);
+}
+
+extern lputil_arena_t *
+lputil_arena_create(size_t size)
+{
+     lputil_arena_t *arena;
+
+     if ( size == 0 )
+          size = LPUTIL_ARENA_CHUNK;
+     size = LPUTIL_ARENA_ROUND(size);
+
+     /* the first chunk directly follows the handle */
+     if ( (arena = malloc(LPUTIL_ARENA_HDR(lputil_arena_t)+size)) == NULL )
+          return NULL;
+     arena->chunks = NULL;
+     arena->size = size;
+     arena->pos = (char *)arena+LPUTIL_ARENA_HDR(lputil_arena_t);
+     arena->end = arena->pos+size;
+
+     return arena;
+}
+
+extern void *
+lputil_arena_alloc(lputil_arena_t *arena, size_t len)
+{
+     lputil_arena_chunk_t *chunk;
+     size_t hdr = LPUTIL_ARENA_HDR(lputil_arena_chunk_t);
+     char *r;
+
+     if ( len > SIZE_MAX-hdr-LPUTIL_ARENA_ALIGN ) {
+          errno = ENOMEM;
+          return NULL;
+     }
+     len = LPUTIL_ARENA_ROUND(len);
+     if ( len <= (size_t)(arena->end-arena->pos) ) {
+          r = arena->pos;
+          arena->pos += len;
+          return r;
+     }
+
+     /* big allocations get a chunk of their own, so the rest of the current
+      * chunk is not wasted */
+     if ( len > arena->size/4 ) {
+          if ( (chunk = malloc(hdr+len)) == NULL )
+               return NULL;
+          chunk->next = arena->chunks;
+          arena->chunks = chunk;
+          return (char *)chunk+hdr;
+     }
+
+     if ( (chunk = malloc(hdr+arena->size)) == NULL )
+          return NULL;
+     chunk->next = arena->chunks;
+     arena->chunks = chunk;
+     r = (char *)chunk+hdr;
+     arena->pos = r+len;
+     arena->end = r+arena->size;
 
-     for ( i=0; sa[i] != NULL; ++i )
-          len += strlen(sa[i]);
-     len += (i-1)*strlen(sep);
+     return r;
+}
+
+extern char *
+lputil_arena_strndup(lputil_arena_t *arena, const char *s, size_t len)
+{
+     char *r;
 
-     if ( (s = malloc(len)) == NULL )
+     if ( (r = lputil_arena_alloc(arena, len+1)) == NULL )
           return NULL;
+     memcpy(r, s, len);
+     r[len] = '\0';
+
+     return r;
+}
+
+extern void
+lputil_arena_reset(lputil_arena_t *arena)
+{
+     lputil_arena_chunk_t *chunk, *next;
+
+     for ( chunk = arena->chunks; chunk != NULL; chunk = next ) {
+          next = chunk->next;
+          free(chunk);
+     }
+     arena->chunks = NULL;
+     arena->pos = (char *)arena+LPUTIL_ARENA_HDR(lputil_arena_t);
+     arena->end = arena->pos+arena->size;
 
-     tmp = s;
+     return;
+}
+
+extern void
+lputil_arena_destroy(lputil_arena_t *arena)
+{
+     if ( arena != NULL ) {
+          lputil_arena_reset(arena);
+          free(arena);
+     }
+     return;
+}
+
+extern lputil_pool_t *
+lputil_pool_create(size_t size)
+{
+     lputil_pool_t *pool;
 
-     for ( j=0; j < i-1; ++j ) {
-          tmp = stpcpy(tmp, sa[j]);
-          tmp = stpcpy(tmp, sep);
+     if ( (pool = malloc(sizeof(lputil_pool_t))) == NULL )
+          return NULL;
+     if ( (pool->arena = lputil_arena_create(0)) == NULL ) {
+          free(pool);
+          return NULL;
      }
-     stpcpy(tmp, sa[j]);
+     pool->free = NULL;
+     /* free objects have to hold the link to the next one */
+     pool->size = size < sizeof(void *) ? sizeof(void *) : size;
+
+     return pool;
+}
+
+extern void *
+lputil_pool_alloc(lputil_pool_t *pool)
+{
+     void *r = pool->free;
+
+     if ( r == NULL )
+          return lputil_arena_alloc(pool->arena, pool->size);
+     pool->free = *(void **)r;
+
+     return r;
+}
+
+extern void
+lputil_pool_free(lputil_pool_t *pool, void *p)
+{
+     if ( p == NULL )
+          return;
+     *(void **)p = pool->free;
+     pool->free = p;
+
+     return;
+}
+
+extern void
+lputil_pool_reset(lputil_pool_t *pool)
+{
+     lputil_arena_reset(pool->arena);
+     pool->free = NULL;
+
+     return;
+}
+
+extern void
+lputil_pool_destroy(lputil_pool_t *pool)
+{
+     if ( pool == NULL )
+          return;
+     lputil_arena_destroy(pool->arena);
+     free(pool);
+
+     return;
+}
+
+static void *
+lputil_alloc_arena_alloc(void *ctx, size_t len)
+{
+     return lputil_arena_alloc(ctx, len);
+}
+
+static void
+lputil_alloc_arena_free(void *ctx, void *p)
+{
+     return;
+}
+
+static void *
+lputil_alloc_pool_alloc(void *ctx, size_t len)
+{
+     lputil_pool_t *pool = ctx;
+
+     if ( len > pool->size ) {
+          errno = ENOMEM;
+          return NULL;
+     }
+     return lputil_pool_alloc(pool);
+}
+
+static void
+lputil_alloc_pool_free(void *ctx, void *p)
+{
+     lputil_pool_free(ctx, p);
+
+     return;
+}
+
+extern void
+lputil_alloc_init_arena(lputil_alloc_t *alloc, lputil_arena_t *arena)
+{
+     alloc->alloc = lputil_alloc_arena_alloc;
+     alloc->free = lputil_alloc_arena_free;
+     alloc->ctx = arena;
+
+     return;
+}
+
+extern void
+lputil_alloc_init_pool(lputil_alloc_t *alloc, lputil_pool_t *pool)
+{
+     alloc->alloc = lputil_alloc_pool_alloc;
+     alloc->free = lputil_alloc_pool_free;
+     alloc->ctx = pool;
+
+     return;
+}
+
+extern void *
+lputil_alloc(const lputil_alloc_t *alloc, size_t len)
+{
+     if ( alloc == NULL )
+          return malloc(len);
+     return alloc->alloc(alloc->ctx, len);
+}
+
+extern void
+lputil_free(const lputil_alloc_t *alloc, void *p)
+{
+     if ( alloc == NULL )
+          free(p);
+     else if ( p != NULL )
+          (alloc->free)(alloc->ctx, p);
+
+     return;
+}
+
+static void
+lputil_intern_init(void)
+{
+     lputil_intern_tab = lputil_symtab_create();
+
+     return;
+}
+
+static inline uint32_t
+lputil_hash(const char *s, size_t len)
+{
+     uint32_t h = 2166136261U;
+     size_t i;
+
+     for ( i=0; i < len; ++i ) {
+          h ^= (unsigned char)s[i];
+          h *= 16777619U;
+     }
+
+     return h;
+}
+
+static uint32_t
+lputil_symtab_find(const lputil_symtab_t *tab, const char *s, size_t len,
+                   uint32_t hash, size_t *slot)
+{
+     const lputil_symtab_entry_t *e;
+     size_t i;
+     uint32_t id;
+
+     /* linear probing, the table is never more than half full */
+     for ( i = hash & tab->mask; (id = tab->slots[i]) != 0;
+           i = (i+1) & tab->mask ) {
+          e = &tab->entries[id];
+          if ( e->hash == hash && e->len == len &&
+               memcmp(e->s, s, len) == 0 )
+               break;
+     }
+     *slot = i;
+
+     return id;
+}
+
+static int
+lputil_symtab_grow(lputil_symtab_t *tab)
+{
+     uint32_t *slots;
+     size_t mask = tab->mask*2+1, i, j;
+
+     if ( (slots = calloc(mask+1, sizeof(uint32_t))) == NULL )
+          return -1;
+     for ( i=1; i < tab->count; ++i ) {
+          for ( j = tab->entries[i].hash & mask; slots[j] != 0;
+                j = (j+1) & mask )
+               ;
+          slots[j] = (uint32_t)i;
+     }
+     free(tab->slots);
+     tab->slots = slots;
+     tab->mask = mask;
+
+     return 0;
+}
+
+extern lputil_symtab_t *
+lputil_symtab_create(void)
+{
+     lputil_symtab_t *tab;
+     int err;
+
+     if ( (tab = malloc(sizeof(lputil_symtab_t))) == NULL )
+          return NULL;
+     tab->arena = NULL;
+     tab->slots = NULL;
+     if ( (tab->entries = malloc(sizeof(lputil_symtab_entry_t)*
+                                 LPUTIL_SYMTAB_ENTRIES)) == NULL ||
+          (tab->slots = calloc(LPUTIL_SYMTAB_SLOTS, sizeof(uint32_t)))
+          == NULL || (tab->arena = lputil_arena_create(0)) == NULL )
+          goto lputil_symtab_create_bailout;
+     if ( (err = pthread_mutex_init(&tab->lock, NULL)) != 0 ) {
+          errno = err;
+          goto lputil_symtab_create_bailout;
+     }
+     tab->count = 1;
+     tab->size = LPUTIL_SYMTAB_ENTRIES;
+     tab->mask = LPUTIL_SYMTAB_SLOTS-1;
+
+     return tab;
+
+lputil_symtab_create_bailout:
+     lputil_arena_destroy(tab->arena);
+     free(tab->slots);
+     free(tab->entries);
+     free(tab);
+     return NULL;
+}
+
+extern uint32_t
+lputil_symtab_intern(lputil_symtab_t *tab, const char *s, size_t len,
+                     const char **str)
+{
+     lputil_symtab_entry_t *e;
+     uint32_t hash = lputil_hash(s, len), id;
+     size_t slot;
+     char *copy;
+
+     pthread_mutex_lock(&tab->lock);
+     if ( (id = lputil_symtab_find(tab, s, len, hash, &slot)) != 0 )
+          goto lputil_symtab_intern_unlock;
+
+     if ( tab->count > UINT32_MAX ) {
+          errno = ENOMEM;
+          goto lputil_symtab_intern_unlock;
+     }
+     if ( tab->count == tab->size ) {
+          if ( (e = realloc(tab->entries, sizeof(lputil_symtab_entry_t)*
+                            tab->size*2)) == NULL )
+               goto lputil_symtab_intern_unlock;
+          tab->entries = e;
+          tab->size *= 2;
+     }
+     if ( tab->count*2 > tab->mask ) {
+          if ( lputil_symtab_grow(tab) == -1 )
+               goto lputil_symtab_intern_unlock;
+          lputil_symtab_find(tab, s, len, hash, &slot);
+     }
+     if ( (copy = lputil_arena_strndup(tab->arena, s, len)) == NULL )
+          goto lputil_symtab_intern_unlock;
+
+     id = (uint32_t)tab->count++;
+     e = &tab->entries[id];
+     e->s = copy;
+     e->len = len;
+     e->hash = hash;
+     tab->slots[slot] = id;
+
+lputil_symtab_intern_unlock:
+     if ( id != 0 && str != NULL )
+          *str = tab->entries[id].s;
+     pthread_mutex_unlock(&tab->lock);
+     return id;
+}
+
+extern uint32_t
+lputil_symtab_lookup(lputil_symtab_t *tab, const char *s, size_t len)
+{
+     uint32_t hash = lputil_hash(s, len), id;
+     size_t slot;
+
+     pthread_mutex_lock(&tab->lock);
+     id = lputil_symtab_find(tab, s, len, hash, &slot);
+     pthread_mutex_unlock(&tab->lock);
+
+     return id;
+}
+
+extern const char *
+lputil_symtab_str(lputil_symtab_t *tab, uint32_t id)
+{
+     const char *r = NULL;
+
+     pthread_mutex_lock(&tab->lock);
+     if ( id != 0 && id < tab->count )
+          r = tab->entries[id].s;
+     pthread_mutex_unlock(&tab->lock);
+
+     if ( r == NULL )
+          errno = EINVAL;
+     return r;
+}
+
+extern size_t
+lputil_symtab_count(lputil_symtab_t *tab)
+{
+     size_t count;
+
+     pthread_mutex_lock(&tab->lock);
+     count = tab->count-1;
+     pthread_mutex_unlock(&tab->lock);
+
+     return count;
+}
+
+extern void
+lputil_symtab_destroy(lputil_symtab_t *tab)
+{
+     if ( tab != NULL ) {
+          pthread_mutex_destroy(&tab->lock);
+          lputil_arena_destroy(tab->arena);
+          free(tab->slots);
+          free(tab->entries);
+          free(tab);
+     }
+     return;
+}
+
+extern uint32_t
+lputil_intern(const char *s, size_t len, const char **str)
+{
+     pthread_once(&lputil_intern_once, lputil_intern_init);
+     if ( lputil_intern_tab == NULL ) {
+          errno = ENOMEM;
+          return 0;
+     }
+     return lputil_symtab_intern(lputil_intern_tab, s, len, str);
+}
+
+extern uint32_t
+lputil_intern_lookup(const char *s, size_t len)
+{
+     pthread_once(&lputil_intern_once, lputil_intern_init);
+     if ( lputil_intern_tab == NULL )
+          return 0;
+     return lputil_symtab_lookup(lputil_intern_tab, s, len);
+}
+
+extern const char *
+lputil_intern_str(uint32_t id)
+{
+     pthread_once(&lputil_intern_once, lputil_intern_init);
+     if ( lputil_intern_tab == NULL ) {
+          errno = EINVAL;
+          return NULL;
+     }
+     return lputil_symtab_str(lputil_intern_tab, id);
+}
+
+static void *
+lputil_parallel_run(void *arg)
+{
+     lputil_parallel_arg_t *a = arg;
+
+     a->fn(a->ctx, a->worker, a->begin, a->end);
+
+     return NULL;
+}
+
+extern unsigned int
+lputil_parallel_workers(size_t n, size_t min, unsigned int threads)
+{
+     long cpus;
+
+     if ( threads == 0 ) {
+          cpus = sysconf(_SC_NPROCESSORS_ONLN);
+          threads = cpus > 0 ? (unsigned int)cpus : 1;
+     }
+     if ( threads > LPUTIL_PARALLEL_MAX )
+          threads = LPUTIL_PARALLEL_MAX;
+     if ( min == 0 )
+          min = 1;
+     if ( n/min < threads )
+          threads = (unsigned int)(n/min);
+
+     return threads > 0 ? threads : 1;
+}
+
+extern void
+lputil_parallel(size_t n, unsigned int workers, lputil_parallel_fn_t fn,
+                void *ctx)
+{
+     lputil_parallel_arg_t args[LPUTIL_PARALLEL_MAX];
+     pthread_t threads[LPUTIL_PARALLEL_MAX];
+     bool started[LPUTIL_PARALLEL_MAX];
+     size_t chunk, rest, begin = 0;
+     unsigned int i;
+
+     if ( workers > LPUTIL_PARALLEL_MAX )
+          workers = LPUTIL_PARALLEL_MAX;
+     if ( workers <= 1 || n < workers ) {
+          fn(ctx, 0, 0, n);
+          return;
+     }
+
+     /* the first rest ranges get one item more */
+     chunk = n/workers;
+     rest = n%workers;
+     for ( i=0; i < workers; ++i ) {
+          args[i].fn = fn;
+          args[i].ctx = ctx;
+          args[i].worker = i;
+          args[i].begin = begin;
+          begin += chunk+(i < rest ? 1 : 0);
+          args[i].end = begin;
+     }
+
+     for ( i=1; i < workers; ++i )
+          started[i] = pthread_create(&threads[i], NULL, lputil_parallel_run,
+                                      &args[i]) == 0;
+     fn(ctx, 0, args[0].begin, args[0].end);
+     for ( i=1; i < workers; ++i ) {
+          if ( started[i] )
+               pthread_join(threads[i], NULL);
+          else
+               fn(ctx, i, args[i].begin, args[i].end);
+     }
+
+     return;
+}
+
+extern size_t
+lputil_bufcat(char *buf, size_t cap, size_t off, const char *s, size_t len)
+{
+     if ( off+1 < cap )
+          memcpy(buf+off, s, off+len+1 < cap ? len : cap-off-1);
+
+     return off+len;
+}
+
+extern void
+lputil_strbuf_init(lputil_strbuf_t *sb)
+{
+     sb->heap = NULL;
+     sb->len = 0;
+     sb->cap = sizeof(sb->small);
+     sb->small[0] = '\0';
+
+     return;
+}
+
+extern int
+lputil_strbuf_reserve(lputil_strbuf_t *sb, size_t len)
+{
+     size_t cap = sb->cap;
+     char *t;
+
+     /* the string and its nul have to fit into a size_t */
+     if ( len > SIZE_MAX-sb->len-1 ) {
+          errno = ENOMEM;
+          return -1;
+     }
+     if ( sb->len+len < sb->cap )
+          return 0;
+     /* double the capacity, but do not let it wrap around */
+     while ( cap <= sb->len+len )
+          cap = cap > SIZE_MAX/2 ? SIZE_MAX : cap*2;
+     if ( (t = realloc(sb->heap, cap)) == NULL )
+          return -1;
+     /* moving from the inline storage to the heap */
+     if ( sb->heap == NULL )
+          memcpy(t, sb->small, sb->len+1);
+     sb->heap = t;
+     sb->cap = cap;
+
+     return 0;
+}
+
+extern char *
+lputil_strbuf_extend(lputil_strbuf_t *sb, size_t len)
+{
+     char *ret;
+
+     if ( lputil_strbuf_reserve(sb, len) == -1 )
+          return NULL;
+     ret = (sb->heap != NULL ? sb->heap : sb->small)+sb->len;
+     sb->len += len;
+     ret[len] = '\0';
+
+     return ret;
+}
+
+extern int
+lputil_strbuf_append(lputil_strbuf_t *sb, const char *s, size_t len)
+{
+     char *p;
+
+     if ( (p = lputil_strbuf_extend(sb, len)) == NULL )
+          return -1;
+     memcpy(p, s, len);
+
+     return 0;
+}
+
+extern int
+lputil_strbuf_append_u64(lputil_strbuf_t *sb, uint64_t value)
+{
+     char *p;
+
+     if ( (p = lputil_strbuf_extend(sb, lputil_u64len(value))) == NULL )
+          return -1;
+     (void)lputil_u64toa(p, value);
+
+     return 0;
+}
+
+extern const char *
+lputil_strbuf_str(const lputil_strbuf_t *sb)
+{
+     return sb->heap != NULL ? sb->heap : sb->small;
+}
+
+extern size_t
+lputil_strbuf_len(const lputil_strbuf_t *sb)
+{
+     return sb->len;
+}
+
+extern char *
+lputil_strbuf_detach(lputil_strbuf_t *sb)
+{
+     char *ret = sb->heap;
+
+     if ( ret == NULL ) {
+          if ( (ret = lputil_memdup(sb->small, sb->len+1)) == NULL )
+               return NULL;
+     }
+     lputil_strbuf_init(sb);
+
+     return ret;
+}
+
+extern void
+lputil_strbuf_reset(lputil_strbuf_t *sb)
+{
+     free(sb->heap);
+     lputil_strbuf_init(sb);
+
+     return;
+}
+
+extern size_t
+lputil_digitspan(const char *s, size_t len)
+{
+     size_t i = 0;
+#ifdef LPUTIL_AVX2
+     const __m256i zero32 = _mm256_set1_epi8('0');
+     const __m256i nine32 = _mm256_set1_epi8(9);
+     __m256i d32;
+     uint32_t m32;
+#endif
+#ifdef LPUTIL_SSE2
+     const __m128i zero16 = _mm_set1_epi8('0');
+     const __m128i nine16 = _mm_set1_epi8(9);
+     __m128i d16;
+     unsigned int m16;
+#endif
+#ifdef LPUTIL_NEON
+     uint8x16_t d;
+     uint64_t m;
+#endif
+
+     /* a character is a digit if it minus '0' is at most 9 unsigned, the
+      * mask has a bit set for every character that is not */
+#ifdef LPUTIL_AVX2
+     for ( ; i+32 <= len; i += 32 ) {
+          d32 = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(s+i)),
+                                zero32);
+          d32 = _mm256_cmpeq_epi8(_mm256_max_epu8(d32, nine32), nine32);
+          if ( (m32 = ~(uint32_t)_mm256_movemask_epi8(d32)) != 0 )
+               return i+(size_t)__builtin_ctz(m32);
+     }
+#endif
+#ifdef LPUTIL_SSE2
+     for ( ; i+16 <= len; i += 16 ) {
+          d16 = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(s+i)),
+                             zero16);
+          d16 = _mm_cmpeq_epi8(_mm_max_epu8(d16, nine16), nine16);
+          if ( (m16 = ~(unsigned int)_mm_movemask_epi8(d16) & 0xffff) != 0 )
+               return i+(size_t)__builtin_ctz(m16);
+     }
+#endif
+#ifdef LPUTIL_NEON
+     for ( ; i+16 <= len; i += 16 ) {
+          d = vsubq_u8(vld1q_u8((const uint8_t *)(s+i)), vdupq_n_u8('0'));
+          d = vcgtq_u8(d, vdupq_n_u8(9));
+          /* narrow to four bits per character */
+          m = vget_lane_u64(vreinterpret_u64_u8(
+                                 vshrn_n_u16(vreinterpretq_u16_u8(d), 4)), 0);
+          if ( m != 0 )
+               return i+(size_t)(__builtin_ctzll(m)/4);
+     }
+#endif
+     for ( ; i < len && s[i] >= '0' && s[i] <= '9'; ++i )
+          ;
+
+     return i;
+}
+
+#ifdef LPUTIL_SWAR
+static inline uint64_t
+lputil_digits8(const char *s)
+{
+     uint64_t v;
+
+     memcpy(&v, s, sizeof(v));
+     v -= 0x3030303030303030ULL;
+     /* pairs: 10*first+second in every second byte */
+     v = v*10+(v >> 8);
+     /* groups of four, then all eight */
+     v = (((v & 0x000000ff000000ffULL)*(100+(1000000ULL << 32))) +
+          (((v >> 16) & 0x000000ff000000ffULL)*(1+(10000ULL << 32)))) >> 32;
+
+     return v;
+}
+#endif /* LPUTIL_SWAR */
+
+extern int
+lputil_digits_u64(const char *s, size_t len, uint64_t max, uint64_t *value)
+{
+     uint64_t v = 0, d;
+     size_t i = 0;
+
+#ifdef LPUTIL_SWAR
+     for ( ; i+8 <= len; i += 8 ) {
+          d = lputil_digits8(s+i);
+          if ( d > max || v > (max-d)/100000000 )
+               goto lputil_digits_u64_erange;
+          v = v*100000000+d;
+     }
+#endif
+     for ( ; i < len; ++i ) {
+          d = (uint64_t)(s[i]-'0');
+          if ( v > (max-d)/10 )
+               goto lputil_digits_u64_erange;
+          v = v*10+d;
+     }
+     *value = v;
+
+     return 0;
+
+lputil_digits_u64_erange:
+     errno = ERANGE;
+     return -1;
+}
+
+static inline int
+lputil_keysort_cmp(const lputil_keysort_rec_t *a,
+                   const lputil_keysort_rec_t *b)
+{
+     int ret;
+
+     if ( a->head != b->head )
+          return a->head < b->head ? -1 : 1;
+     if ( a->len <= 8 || b->len <= 8 )
+          return (a->len > b->len) - (a->len < b->len);
+     if ( (ret = memcmp(a->key+8, b->key+8,
+                        (a->len < b->len ? a->len : b->len)-8)) != 0 )
+          return ret;
+     return (a->len > b->len) - (a->len < b->len);
+}
+
+static void
+lputil_keysort_merge(lputil_keysort_rec_t *a, lputil_keysort_rec_t *tmp,
+                     size_t m, size_t n)
+{
+     size_t i = 0, j = m, k = 0;
+
+     /* nothing to do if the runs are in order already */
+     if ( m == 0 || m == n || lputil_keysort_cmp(&a[m-1], &a[m]) <= 0 )
+          return;
+     memcpy(tmp, a, n*sizeof(*a));
+     /* take from the left run on ties to stay stable */
+     while ( i < m && j < n )
+          a[k++] = lputil_keysort_cmp(&tmp[j], &tmp[i]) < 0 ? tmp[j++] :
+               tmp[i++];
+     if ( i < m )
+          memcpy(a+k, tmp+i, (m-i)*sizeof(*a));
+     else
+          memcpy(a+k, tmp+j, (n-j)*sizeof(*a));
+
+     return;
+}
+
+static void
+lputil_keysort_run(lputil_keysort_rec_t *a, lputil_keysort_rec_t *tmp,
+                   size_t n)
+{
+     lputil_keysort_rec_t r;
+     size_t i, j;
+
+     if ( n <= LPUTIL_KEYSORT_INSERT ) {
+          for ( i=1; i < n; ++i ) {
+               r = a[i];
+               for ( j=i; j > 0 && lputil_keysort_cmp(&r, &a[j-1]) < 0; --j )
+                    a[j] = a[j-1];
+               a[j] = r;
+          }
+          return;
+     }
+     lputil_keysort_run(a, tmp, n/2);
+     lputil_keysort_run(a+n/2, tmp+n/2, n-n/2);
+     lputil_keysort_merge(a, tmp, n/2, n);
+
+     return;
+}
+
+static void
+lputil_keysort_measure(void *ctx, unsigned int worker, size_t begin,
+                       size_t end)
+{
+     lputil_keysort_ctx_t *c = ctx;
+     size_t i;
+
+     for ( i=begin; i < end; ++i )
+          c->recs[i].len = c->key(c->items[i], NULL, 0);
+
+     return;
+}
+
+static void
+lputil_keysort_build(void *ctx, unsigned int worker, size_t begin,
+                     size_t end)
+{
+     lputil_keysort_ctx_t *c = ctx;
+     lputil_keysort_rec_t *r;
+     size_t i, j;
+
+     for ( i=begin; i < end; ++i ) {
+          r = &c->recs[i];
+          (void)c->key(c->items[i], (uint8_t *)r->key, r->len);
+          r->item = c->items[i];
+          r->head = 0;
+          for ( j=0; j < 8; ++j )
+               r->head = (r->head << 8) | (j < r->len ? r->key[j] : 0);
+     }
+     lputil_keysort_run(c->recs+begin, c->tmp+begin, end-begin);
+     c->runs[worker+1] = end;
+
+     return;
+}
+
+static void
+lputil_keysort_pairs(void *ctx, unsigned int worker, size_t begin,
+                     size_t end)
+{
+     lputil_keysort_ctx_t *c = ctx;
+     size_t i, b, m, e;
+
+     for ( i=begin; i < end; ++i ) {
+          b = c->runs[2*i];
+          m = c->runs[2*i+1];
+          e = c->runs[2*i+2];
+          lputil_keysort_merge(c->recs+b, c->tmp+b, m-b, e-b);
+     }
+
+     return;
+}
+
+extern int
+lputil_keysort(const void **items, size_t n, lputil_key_fn_t key,
+               unsigned int threads)
+{
+     lputil_keysort_ctx_t ctx;
+     size_t runs[LPUTIL_PARALLEL_MAX+1], size = 0, i, pairs;
+     unsigned int workers;
+
+     if ( n < 2 )
+          return 0;
+     ctx.items = items;
+     ctx.key = key;
+     ctx.runs = runs;
+     ctx.keys = NULL;
+     ctx.tmp = NULL;
+     if ( (ctx.recs = malloc(n*sizeof(*ctx.recs))) == NULL )
+          return -1;
+     if ( (ctx.tmp = malloc(n*sizeof(*ctx.tmp))) == NULL )
+          goto lputil_keysort_bailout;
+
+     /* all keys go into a single block, so they are measured first */
+     workers = lputil_parallel_workers(n, LPUTIL_KEYSORT_MIN, threads);
+     lputil_parallel(n, workers, lputil_keysort_measure, &ctx);
+     for ( i=0; i < n; ++i )
+          size += ctx.recs[i].len;
+     if ( (ctx.keys = malloc(size > 0 ? size : 1)) == NULL )
+          goto lputil_keysort_bailout;
+     for ( i=0, size=0; i < n; ++i ) {
+          ctx.recs[i].key = ctx.keys+size;
+          size += ctx.recs[i].len;
+     }
+
+     /* every worker sorts its own range, which become the first runs */
+     if ( n < workers )
+          workers = 1;
+     runs[0] = 0;
+     lputil_parallel(n, workers, lputil_keysort_build, &ctx);
+     ctx.nruns = workers;
+
+     /* then neighbouring runs are merged pairwise until one is left */
+     while ( ctx.nruns > 1 ) {
+          pairs = ctx.nruns/2;
+          lputil_parallel(pairs, lputil_parallel_workers(pairs, 1, threads),
+                          lputil_keysort_pairs, &ctx);
+          for ( i=1; i <= pairs; ++i )
+               runs[i] = runs[2*i];
+          if ( ctx.nruns%2 != 0 )
+               runs[++pairs] = runs[ctx.nruns];
+          ctx.nruns = pairs;
+     }
+
+     for ( i=0; i < n; ++i )
+          items[i] = ctx.recs[i].item;
+     free(ctx.keys);
+     free(ctx.tmp);
+     free(ctx.recs);
+     return 0;
+
+lputil_keysort_bailout:
+     free(ctx.keys);
+     free(ctx.tmp);
+     free(ctx.recs);
+     return -1;
+}
+
+extern void
+lputil_mem_set_hooks(const lputil_memhooks_t *hooks)
+{
+     if ( hooks == NULL ) {
+          lputil_mem_hooks.alloc = malloc;
+          lputil_mem_hooks.resize = realloc;
+          lputil_mem_hooks.release = free;
+     } else
+          lputil_mem_hooks = *hooks;
+
+     return;
+}
+
+extern void
+lputil_mem_set_counting(int enable)
+{
+     lputil_mem_counting = enable != 0;
+
+     return;
+}
+
+extern int
+lputil_mem_stat(lputil_mem_subsys_t subsys, lputil_memstat_t *stat)
+{
+     lputil_memstat_t *s;
+
+     if ( (unsigned)subsys >= LPUTIL_MEM_MAX ) {
+          errno = EINVAL;
+          return -1;
+     }
+     s = &lputil_mem_stats[subsys];
+#if defined(__GNUC__)
+     stat->allocs = __atomic_load_n(&s->allocs, __ATOMIC_RELAXED);
+     stat->reallocs = __atomic_load_n(&s->reallocs, __ATOMIC_RELAXED);
+     stat->frees = __atomic_load_n(&s->frees, __ATOMIC_RELAXED);
+     stat->bytes = __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+#else
+     *stat = *s;
+#endif
+
+     return 0;
+}
+
+extern void
+lputil_mem_stat_reset(void)
+{
+     int i;
+
+     for ( i=0; i < LPUTIL_MEM_MAX; ++i ) {
+#if defined(__GNUC__)
+          __atomic_store_n(&lputil_mem_stats[i].allocs, 0, __ATOMIC_RELAXED);
+          __atomic_store_n(&lputil_mem_stats[i].reallocs, 0, __ATOMIC_RELAXED);
+          __atomic_store_n(&lputil_mem_stats[i].frees, 0, __ATOMIC_RELAXED);
+          __atomic_store_n(&lputil_mem_stats[i].bytes, 0, __ATOMIC_RELAXED);
+#else
+          memset(&lputil_mem_stats[i], 0, sizeof(lputil_memstat_t));
+#endif
+     }
+
+     return;
+}
+
+extern void *
+lputil_mem_malloc(lputil_mem_subsys_t subsys, size_t len)
+{
+     void *p;
+
+     if ( (p = lputil_mem_hooks.alloc(len)) != NULL )
+          LPUTIL_MEM_COUNT(subsys, allocs, len);
+
+     return p;
+}
+
+extern void *
+lputil_mem_calloc(lputil_mem_subsys_t subsys, size_t n, size_t size)
+{
+     void *p;
+
+     if ( size != 0 && n > SIZE_MAX / size ) {
+          errno = ENOMEM;
+          return NULL;
+     }
+     if ( (p = lputil_mem_malloc(subsys, n*size)) != NULL )
+          memset(p, 0, n*size);
+
+     return p;
+}
+
+extern void *
+lputil_mem_realloc(lputil_mem_subsys_t subsys, void *p, size_t len)
+{
+     void *q;
+
+     if ( p == NULL )
+          return lputil_mem_malloc(subsys, len);
+     if ( (q = lputil_mem_hooks.resize(p, len)) != NULL )
+          LPUTIL_MEM_COUNT(subsys, reallocs, len);
+
+     return q;
+}
+
+extern void
+lputil_mem_free(lputil_mem_subsys_t subsys, void *p)
+{
+     if ( p == NULL )
+          return;
+     lputil_mem_hooks.release(p);
+     LPUTIL_MEM_COUNT(subsys, frees, 0);
+
+     return;
+}
+
+extern char *
+lputil_mem_strdup(lputil_mem_subsys_t subsys, const char *s)
+{
+     size_t len = strlen(s)+1;
+     char *p;
+
+     if ( (p = lputil_mem_malloc(subsys, len)) != NULL )
+          memcpy(p, s, len);
 
-     return s;
+     return p;
 }
 
 #ifdef __cplusplus
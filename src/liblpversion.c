@@ -39,9 +39,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
+#include <limits.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #if HAVE_ERRNO_H
 #  include <errno.h>
@@ -51,112 +52,220 @@
 extern int errno;
 #endif /*! errno */
 
+/** @cond */
+#define LPMEM_SUBSYS    LPUTIL_MEM_VERSION
+/** @endcond */
+#include "lpmem.h"
+
 #  ifdef __cplusplus
 extern "C" {
 #  endif
 
-/* this function seems to be in glibc right from the beginning */
-#ifdef __GNUC__
-extern char *
-stpcpy(char *dest, const char *src);
-#endif
+/**
+ * @brief number of version components lpversion_parse() keeps on the stack
+ * before it has to move them to the heap.
+ */
+#define LPVERSION_VA_STACK      16
 
 /**
- * @brief the regular expression used for validating and tokenizing of the
- * given version string.
- *
- * This regexp will export:
- *
- * - The numeric version part with optional version character.
+ * @brief compares two values and returns @c -1, @c 0 or @c 1.
  */
-#define LPVERSION_RE            "^([0-9]+([.][0-9]+)*[a-z]?)((_(alpha|beta|pre\
-|rc|p)[0-9]*)?)(-r[0-9]+)?$"
+#define LPVERSION_CMP(a, b)     (((a) > (b)) - ((a) < (b)))
 
 /**
- * @brief regular expression for matching the suffix and the suffix version
+ * @brief the header byte of a number in a sort key that has no significant
+ * bytes.
  *
- * This regular expression will export:
- *
- * - The suffix string (alpha, beta ..)
- * - The suffix Version
+ * Numbers are encoded as this value plus their count of significant bytes
+ * followed by these bytes in big-endian order, so that longer numbers sort
+ * behind shorter ones. Everything below this value is free to be used as
+ * separator.
  */
-#define LPVERSION_RE_SUF        "_(alpha|beta|pre|rc|p)([0-9]+)"
+#define LPVERSION_KEY_NUM       1
 
 /**
- * @brief regex for matching the release version
+ * @brief appends a number to a sort key.
+ *
+ * Writes as many bytes as fit into the remaining space of the key and
+ * returns the offset behind the encoded number regardless.
+ *
+ * @param key the buffer holding the key.
  *
- * This regular expression will export:
+ * @param len the size of the buffer.
  *
- * - The release version number.
+ * @param off the offset to write the number to.
+ *
+ * @param value the number to encode.
+ *
+ * @return the offset behind the encoded number.
  */
-#define LPVERSION_RE_REL        "-r([0-9]+)$"
+static inline size_t
+lpversion_key_num(uint8_t *key, size_t len, size_t off, uint64_t value);
 
 /**
- * @brief parses the numerical part of a version string into an @c -1
- * terminated int array.
+ * @brief validates and decomposes a version string.
  *
- * If an error occurs, \c NULL is returned and \c errno is set to indicate
- * the error.
+ * This is the scanner behind lpversion_parse(), lpversion_parse_len() and
+ * lpversion_check(). The string is read from left to right exactly once, if
+ * @c handle is @c NULL it is only validated and nothing is allocated.
  *
- * @param ver a \c nul terminated version string eg: 4.2.1.9.
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
  *
- * @return a \c -1 terminated integer array.
+ * @param handle a lpversion_t handle or @c NULL.
+ *
+ * @param version the version string, does not need to be @c nul terminated.
+ *
+ * @param len the length of the version string.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
  *
  * @b Errors:
  *
+ * - @c EINVAL the given string is not a valid version.
+ * - @c ERANGE one of the numbers is too big, only checked if @c handle is
+ *   not @c NULL.
  * - This function may fail and set errno for any of the errors specified for
- *   the routine strdup(3).
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine malloc(3).
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine realloc(3).
+ *   the routine malloc(3).
  */
-/*@null@*//*@only@*/
-static inline int64_t *
-lpversion_version_parse(const char *ver);
+static int
+lpversion_scan(lpversion_t *handle, const char *version, size_t len);
 
 /**
- * @brief compiles the numerical version part.
+ * @brief scans a decimal number.
  *
- * If an error occurs, \c NULL is returned and \c errno is set to indicate
- * the error.
+ * Reads the run of digits starting at @c *s, stores its value in @c value
+ * and advances @c *s behind the last digit.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
  *
- * @param ver a \c nul terminated version string eg: 4.2.1.9.
+ * @param s a pointer to the position to start scanning at.
  *
- * @return a \c -1 terminated integer array.
+ * @param end the end of the string.
+ *
+ * @param max the biggest value that is accepted.
+ *
+ * @param value a pointer to the location to store the value to, if it is
+ * @c NULL the digits are only skipped.
+ *
+ * @return @c 0 if successful or @c -1 if an error occured.
  *
  * @b Errors:
  *
- * - This function may fail and set errno for any of the errors specified for
- *   the routine strdup(3).
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine malloc(3).
- * - This function may also fail and set errno for any of the errors specified
- *   for the routine realloc(3).
+ * - @c EINVAL @c *s does not point to a digit.
+ * - @c ERANGE the number is bigger than @c max.
  */
-/*@null@*//*@only@*/
-static inline char *
-lpversion_version_compile(const lpversion_t *handle);
+static inline int
+lpversion_scan_num(const char **s, const char *end, uint64_t max,
+                   uint64_t *value);
 
 /**
- * @brief parses a suffix string.
+ * @brief scans a suffix keyword.
+ *
+ * Matches one of alpha, beta, pre, rc or p at @c *s and advances @c *s behind
+ * it.
  *
- * @param suffix a @c nul terminated C string with the suffix.
+ * @param s a pointer to the position right behind the underscore.
  *
- * @return the suffix number.
+ * @param end the end of the string.
+ *
+ * @return the suffix or @c LPV_NO if no keyword could be matched.
  */
 static inline lpversion_sufenum_t
-lpversion_suffix_parse(const char *suffix);
+lpversion_scan_suffix(const char **s, const char *end);
+
+/**
+ * @brief the names of the suffixes, indexed by lpversion_sufenum_t.
+ */
+static const char *const lpversion_suffix_str[] = {
+     "alpha", "beta", "pre", "rc", "", "p"
+};
+
+/**
+ * @brief builds the sort key of a version for lputil_keysort().
+ */
+static size_t
+lpversion_sort_key(const void *item, void *buf, size_t len);
+
+/**
+ * @brief makes sure the intern table is created only once.
+ */
+static pthread_once_t lpversion_intern_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief protects the intern table.
+ */
+static pthread_mutex_t lpversion_intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief maps version strings to IDs, both the given and the compiled
+ * spelling of a version are added.
+ */
+static lputil_symtab_t *lpversion_intern_tab = NULL;
+
+/**
+ * @brief holds the interned handles and their components.
+ */
+static lputil_arena_t *lpversion_intern_arena = NULL;
+
+/**
+ * @brief the interned handles, indexed by the IDs of their strings.
+ */
+static const lpversion_t **lpversion_intern_handles = NULL;
+
+/**
+ * @brief the size of lpversion_intern_handles.
+ */
+static size_t lpversion_intern_size = 0;
+
+/**
+ * @brief creates the intern table.
+ */
+static void
+lpversion_intern_init(void);
 
 /**
- * @brief compiles the suffix into a string.
+ * @brief stores the handle of an ID in the intern table.
+ *
+ * Must be called with lpversion_intern_lock held.
+ *
+ * If an error occurs, @c -1 is returned and @c errno is set to indicate the
+ * error.
+ *
+ * @param id an ID of lpversion_intern_tab.
  *
- * @param handle a lpversion_t object.
+ * @param handle the interned handle.
  *
- * @return a @c null terminated character string.
+ * @return @c 0 if successful or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine realloc(3).
  */
-static inline char *
-lpversion_suffix_compile(const lpversion_t *handle);
+static int
+lpversion_intern_set(uint32_t id, const lpversion_t *handle);
+
+/**
+ * @brief copies a parsed version into the intern arena.
+ *
+ * Must be called with lpversion_intern_lock held.
+ *
+ * If an error occurs, @c NULL is returned and @c errno is set to indicate
+ * the error.
+ *
+ * @param v the parsed version.
+ *
+ * @return the copy or @c NULL if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine malloc(3).
+ */
+static lpversion_t *
+lpversion_intern_copy(const lpversion_t *v);
 
 extern lpversion_t *
 lpversion_create(void)
@@ -164,18 +273,36 @@ lpversion_create(void)
      return malloc(sizeof(lpversion_t));
 }
 
+extern lpversion_t *
+lpversion_create_alloc(const lputil_alloc_t *alloc)
+{
+     /* without an allocator the handle is counted for this module, just
+      * like with lpversion_create() */
+     if ( alloc == NULL )
+          return malloc(sizeof(lpversion_t));
+     return lputil_alloc(alloc, sizeof(lpversion_t));
+}
+
 extern void
 lpversion_init(lpversion_t *handle)
-/*@sets handle@*//*@ensures isnull handle->version, handle->va@*/
+/*@sets handle@*//*@ensures isnull handle->va@*/
 {
      handle->va = NULL;
      handle->suffv = 0;
      handle->release = 0;
      handle->verc = (char)0;
      handle->suffix = LPV_NO;
-     (void)regcomp(&handle->regex.verify, LPVERSION_RE, REG_EXTENDED);
-     (void)regcomp(&handle->regex.suffix, LPVERSION_RE_SUF, REG_EXTENDED);
-     (void)regcomp(&handle->regex.release, LPVERSION_RE_REL, REG_EXTENDED);
+     handle->arena = NULL;
+
+     return;
+}
+
+extern void
+lpversion_init_arena(lpversion_t *handle, lputil_arena_t *arena)
+/*@sets handle@*//*@ensures isnull handle->va@*/
+{
+     lpversion_init(handle);
+     handle->arena = arena;
 
      return;
 }
@@ -183,11 +310,11 @@ lpversion_init(lpversion_t *handle)
 extern void
 lpversion_reset(lpversion_t *handle)
 {
-     free(handle->va);
+     if ( handle->arena == NULL )
+          free(handle->va);
      handle->va = NULL;
      handle->suffix = LPV_NO;
      handle->suffv = 0;
-     handle->suffix = LPV_NO;
      handle->release = 0;
      handle->verc = (char)0;
 
@@ -197,58 +324,142 @@ lpversion_reset(lpversion_t *handle)
 extern void
 lpversion_destroy(lpversion_t *handle)
 {
-     free(handle->va);
-     regfree(&handle->regex.verify);
-     regfree(&handle->regex.suffix);
-     regfree(&handle->regex.release);
-     free(handle);
+     lpversion_destroy_alloc(handle, NULL);
+
+     return;
+}
+
+extern void
+lpversion_destroy_alloc(lpversion_t *handle, const lputil_alloc_t *alloc)
+{
+     if ( handle == NULL )
+          return;
+     if ( handle->arena == NULL )
+          free(handle->va);
+     if ( alloc == NULL )
+          free(handle);
+     else
+          lputil_free(alloc, handle);
 
      return;
 }
 
 extern int
 lpversion_parse(lpversion_t *handle, const char *version)
-/*@requires isnull handle->va, handle->version@*/
+/*@requires isnull handle->va@*/
 {
-     regmatch_t match[3];
-     char *tmp;
-     size_t len;
+     return lpversion_scan(handle, version, strlen(version));
+}
 
-     /* validate input */
-     if ( regexec(&handle->regex.verify, version, 3, match, 0) != 0 ) {
-          errno = EINVAL;
-          return -1;
+extern int
+lpversion_parse_len(lpversion_t *handle, const char *version, size_t len)
+/*@requires isnull handle->va@*/
+{
+     return lpversion_scan(handle, version, len);
+}
+
+extern int
+lpversion_check(const char *version, size_t len)
+{
+     return lpversion_scan(NULL, version, len);
+}
+
+static int
+lpversion_scan(lpversion_t *handle, const char *version, size_t len)
+{
+     int64_t stackva[LPVERSION_VA_STACK];
+     int64_t *va = stackva, *t;
+     size_t n = 0, size = LPVERSION_VA_STACK;
+     uint64_t v, suffv = 0, release = 0;
+     lpversion_sufenum_t suffix = LPV_NO;
+     const char *p = version, *end = version+len;
+     char verc = (char)0;
+
+     /* numerical part: one or more dot separated digit runs */
+     for (;;) {
+          if ( lpversion_scan_num(&p, end, INT64_MAX,
+                                  handle != NULL ? &v : NULL) == -1 )
+               goto lpversion_scan_bailout;
+          if ( handle != NULL ) {
+               if ( n == size-1 ) {
+                    /* keep one slot free for the -1 terminator */
+                    size <<= 1;
+                    if ( va == stackva ) {
+                         if ( (t = malloc(sizeof(int64_t)*size)) != NULL )
+                              memcpy(t, stackva, sizeof(int64_t)*n);
+                    } else
+                         t = realloc(va, sizeof(int64_t)*size);
+                    if ( t == NULL )
+                         goto lpversion_scan_bailout;
+                    va = t;
+               }
+               va[n++] = (int64_t)v;
+          }
+          if ( p == end || *p != '.' )
+               break;
+          ++p;
      }
-     if ( (tmp = lputil_get_re_match(match, 1, version)) == NULL )
-          return -1;
-     len = strlen(tmp);
-     if ( islower((int)tmp[len-1]) != 0 ) {
-          handle->verc = tmp[len-1];
-          tmp[len-1] = '\0';
+     /* optional version character */
+     if ( p < end && *p >= 'a' && *p <= 'z' )
+          verc = *p++;
+     /* optional suffix with optional suffix version */
+     if ( p < end && *p == '_' ) {
+          ++p;
+          if ( (suffix = lpversion_scan_suffix(&p, end)) == LPV_NO ) {
+               errno = EINVAL;
+               goto lpversion_scan_bailout;
+          }
+          if ( p < end && *p >= '0' && *p <= '9' )
+               if ( lpversion_scan_num(&p, end, UINT_MAX,
+                                       handle != NULL ? &suffv : NULL) == -1 )
+                    goto lpversion_scan_bailout;
      }
-     if ( (handle->va = lpversion_version_parse(tmp)) == NULL ) {
-          free(tmp);
-          return -1;
+     /* optional release */
+     if ( p < end && *p == '-' ) {
+          if ( ++p == end || *p != 'r' ) {
+               errno = EINVAL;
+               goto lpversion_scan_bailout;
+          }
+          ++p;
+          if ( lpversion_scan_num(&p, end, UINT_MAX,
+                                  handle != NULL ? &release : NULL) == -1 )
+               goto lpversion_scan_bailout;
      }
-     free(tmp);
-     if ( regexec(&handle->regex.suffix, version, 3, match, 0) == 0 ) {
-          if ( (tmp = lputil_get_re_match(match, 1, version)) == NULL )
-               return -1;
-          handle->suffix = lpversion_suffix_parse(tmp);
-          free(tmp);
-          if ( (tmp = lputil_get_re_match(match, 2, version)) == NULL )
-               return -1;
-          handle->suffv = (unsigned int)atoi(tmp);
-          free(tmp);
+     if ( p != end ) {
+          errno = EINVAL;
+          goto lpversion_scan_bailout;
      }
-     if ( regexec(&handle->regex.release, version, 3, match, 0) == 0 ) {
-          if ( (tmp = lputil_get_re_match(match, 1, version)) == NULL )
+     if ( handle == NULL )
+          return 0;
+
+     /* everything is valid, hand the result over to the handle */
+     if ( handle->arena != NULL ) {
+          if ( (t = lputil_arena_alloc(handle->arena,
+                                       sizeof(int64_t)*(n+1))) == NULL )
+               goto lpversion_scan_bailout;
+          memcpy(t, va, sizeof(int64_t)*n);
+          if ( va != stackva )
+               free(va);
+          va = t;
+     } else if ( va == stackva ) {
+          if ( (t = malloc(sizeof(int64_t)*(n+1))) == NULL )
                return -1;
-          handle->release = (unsigned int)atoi(tmp);
-          free(tmp);
+          memcpy(t, stackva, sizeof(int64_t)*n);
+          va = t;
      }
+     va[n] = -1;
+     handle->va = va;
+     handle->verc = verc;
+     handle->suffix = suffix;
+     handle->suffv = (unsigned int)suffv;
+     handle->release = (unsigned int)release;
 
      return 0;
+
+lpversion_scan_bailout:
+     if ( va != stackva )
+          free(va);
+     return -1;
 }
 
 extern int
@@ -257,192 +468,345 @@ lpversion_cmp(const lpversion_t *v1, const lpversion_t *v2)
 {
      int i;
 
-     for ( i=0; v1->va[i] != -1 || v2->va[i] != -1; ++i )
+     /* only compare signs, the differences may not fit into an int */
+     for ( i=0; v1->va[i] != -1 && v2->va[i] != -1; ++i )
           if ( v1->va[i] != v2->va[i] )
-               return (int)(v1->va[i] - v2->va[i]);
+               return LPVERSION_CMP(v1->va[i], v2->va[i]);
 
+     /* the version with more components is the bigger one */
      if ( v1->va[i] != v2->va[i] )
-          return (int)(v1->va[i] - v2->va[i]);
+          return v1->va[i] == -1 ? -1 : 1;
 
      if ( v1->verc != v2->verc )
-          return (int)(v1->verc - v2->verc);
+          return LPVERSION_CMP((unsigned char)v1->verc,
+                               (unsigned char)v2->verc);
 
      if ( v1->suffix != v2->suffix )
-          return (int)(v1->suffix - v2->suffix);
+          return LPVERSION_CMP(v1->suffix, v2->suffix);
 
-     return (int)(v1->release - v2->release);
+     if ( v1->suffv != v2->suffv )
+          return LPVERSION_CMP(v1->suffv, v2->suffv);
+
+     return LPVERSION_CMP(v1->release, v2->release);
 }
 
-static inline int64_t *
-lpversion_version_parse(const char *ver)
+extern size_t
+lpversion_key(const lpversion_t *handle, void *buf, size_t len)
+/*@requires notnull handle->va@*/
 {
-     int64_t *ia;
-     size_t len, i;
-     char **sv;
-
-     if ( (sv = lputil_splitstr(ver, ".")) == NULL )
-          return NULL;
-     for ( i=0; sv[i] != NULL; ++i )
-          ;
-     len = i++;
-     if ( (ia = malloc(sizeof(int64_t)*i)) == NULL ) {
-          lputil_splitstr_destroy(sv);
-          return NULL;
-     }
-     for ( i=0; i < len; ++i )
-          /* see inttypes.h for SCNi64 */
-          (void)sscanf(sv[i], "%"SCNi64, &ia[i]);
-     ia[len] = -1;
-     lputil_splitstr_destroy(sv);
+     uint8_t *key = buf;
+     size_t n = 0;
+     unsigned int i;
 
-     return ia;
+     for ( i=0; handle->va[i] != -1; ++i )
+          n = lpversion_key_num(key, len, n, (uint64_t)handle->va[i]);
+     /* terminate the numerical part with a byte lower than any number
+      * header, so that 1 sorts before 1.0 */
+     if ( n < len )
+          key[n] = 0;
+     ++n;
+     if ( n < len )
+          key[n] = (uint8_t)handle->verc;
+     ++n;
+     if ( n < len )
+          key[n] = (uint8_t)handle->suffix;
+     ++n;
+     n = lpversion_key_num(key, len, n, handle->suffv);
+     n = lpversion_key_num(key, len, n, handle->release);
+
+     return n;
 }
 
-/*@null@*//*@only@*/
-static inline char *
-lpversion_version_compile(const lpversion_t *handle)
+extern size_t
+lpversion_key_prefix(const lpversion_t *handle, lpversion_keypart_t part)
+/*@requires notnull handle->va@*/
 {
-     unsigned int i, j;
-     char **va, *ret, *tmp, *tmp2;
+     size_t n = 0;
+     unsigned int i;
 
+     /* lpversion_key_num() only counts if there is no room */
      for ( i=0; handle->va[i] != -1; ++i )
+          n = lpversion_key_num(NULL, 0, n, (uint64_t)handle->va[i]);
+     switch ( part ) {
+     case LPV_KEY_COMPONENTS:
+          return n;
+     case LPV_KEY_VERC:
+          return n+2;
+     case LPV_KEY_SUFFIX:
+          return n+3;
+     case LPV_KEY_SUFFV:
+          return lpversion_key_num(NULL, 0, n+3, handle->suffv);
+     default:
+          n = lpversion_key_num(NULL, 0, n+3, handle->suffv);
+          return lpversion_key_num(NULL, 0, n, handle->release);
+     }
+}
+
+static inline size_t
+lpversion_key_num(uint8_t *key, size_t len, size_t off, uint64_t value)
+{
+     unsigned int n, i;
+
+     /* count the significant bytes, 0 is encoded without any */
+     for ( n=0; n < 8 && (value >> (n*8)) != 0; ++n )
           ;
-     if ( (va = malloc(sizeof(char *)*(i+2))) == NULL )
-          return NULL;
+     if ( off < len )
+          key[off] = (uint8_t)(LPVERSION_KEY_NUM+n);
+     ++off;
+     for ( i=n; i > 0; --i, ++off )
+          if ( off < len )
+               key[off] = (uint8_t)(value >> ((i-1)*8));
+
+     return off;
+}
 
-     for ( j=0; j<i; ++j ) {
-          if ( (va[j] = malloc(lputil_int64len(handle->va[j])+1)) == NULL ) {
-               for ( i=0; i<j; ++i )
-                    free(va[i]);
-               return NULL;
-          }
-          (void)sprintf(va[j], "%"PRIi64, handle->va[j]);
-     }
-     va[j] = NULL;
-     ret = lputil_joinstr((const char **)va, ".");
-     for (j=0; j<i; ++j)
-          free(va[j]);
-     free(va);
-
-     if (handle->verc != 0 ) {
-          if ( (tmp = malloc(strlen(ret)+2)) == NULL ) {
-               free(ret);
-               return NULL;
-          }
-          tmp2 = stpcpy(tmp, ret);
-          free(ret);
-          *tmp2++ = handle->verc;
-          *tmp2 = '\0';
-          ret = tmp;
+static inline int
+lpversion_scan_num(const char **s, const char *end, uint64_t max,
+                   uint64_t *value)
+{
+     size_t n;
+
+     if ( (n = lputil_digitspan(*s, (size_t)(end-*s))) == 0 ) {
+          errno = EINVAL;
+          return -1;
      }
-     return ret;
+     if ( value != NULL && lputil_digits_u64(*s, n, max, value) == -1 )
+          return -1;
+
+     *s += n;
+     return 0;
 }
 
 static inline lpversion_sufenum_t
-lpversion_suffix_parse(const char *suffix)
+lpversion_scan_suffix(const char **s, const char *end)
 {
-     switch(suffix[0]) {
+     const char *p = *s;
+     size_t len = (size_t)(end-p);
+
+     if ( len == 0 )
+          return LPV_NO;
+     switch(p[0]) {
      case 'a':
+          if ( len < 5 || memcmp(p, "alpha", 5) != 0 )
+               return LPV_NO;
+          *s = p+5;
           return LPV_ALPHA;
      case 'b':
+          if ( len < 4 || memcmp(p, "beta", 4) != 0 )
+               return LPV_NO;
+          *s = p+4;
           return LPV_BETA;
      case 'p':
-          switch(suffix[1]) {
-          case 'r':
+          if ( len > 1 && p[1] == 'r' ) {
+               if ( len < 3 || p[2] != 'e' )
+                    return LPV_NO;
+               *s = p+3;
                return LPV_PRE;
-          default:
-               return LPV_P;
           }
+          *s = p+1;
+          return LPV_P;
      case 'r':
+          if ( len < 2 || p[1] != 'c' )
+               return LPV_NO;
+          *s = p+2;
           return LPV_RC;
      default:
           return LPV_NO;
      }
 }
 
-static inline char *
-lpversion_suffix_compile(const lpversion_t *handle)
+/*@null@*//*@only@*/
+extern char *
+lpversion_compile(const lpversion_t *handle)
+{
+     lputil_strbuf_t sb;
+
+     lputil_strbuf_init(&sb);
+     if ( lpversion_compile_buf(handle, &sb) == -1 )
+          return NULL;
+
+     return lputil_strbuf_detach(&sb);
+}
+
+extern int
+lpversion_compile_buf(const lpversion_t *handle, lputil_strbuf_t *sb)
 {
-     char *suffix, *ret, *tmp;
+     char *p;
      size_t len;
 
-     switch(handle->suffix) {
-     case LPV_ALPHA:
-          suffix = strdup("alpha");
-          break;
-     case LPV_BETA:
-          suffix = strdup("beta");
-          break;
-     case LPV_PRE:
-          suffix = strdup("pre");
-          break;
-     case LPV_P:
-          suffix = strdup("p");
-          break;
-     case LPV_RC:
-          suffix = strdup("rc");
-          break;
-     default:
-          suffix = strdup("");
-          break;
+     len = lpversion_compile_into(handle, NULL, 0);
+     if ( (p = lputil_strbuf_extend(sb, len)) == NULL )
+          return -1;
+     (void)lpversion_compile_into(handle, p, len+1);
+
+     return 0;
+}
+
+extern size_t
+lpversion_compile_into(const lpversion_t *handle, char *buf, size_t cap)
+{
+     const char *suffix;
+     char num[20];
+     size_t off = 0, i;
+
+     for ( i=0; handle->va[i] != -1; ++i ) {
+          if ( i > 0 )
+               off = lputil_bufcat(buf, cap, off, ".", 1);
+          off = lputil_bufcat(buf, cap, off, num,
+                              lputil_u64toa(num, (uint64_t)handle->va[i]));
+     }
+     if ( handle->verc != 0 )
+          off = lputil_bufcat(buf, cap, off, &handle->verc, 1);
+     if ( handle->suffix != LPV_NO ) {
+          suffix = lpversion_suffix_str[handle->suffix];
+          off = lputil_bufcat(buf, cap, off, "_", 1);
+          off = lputil_bufcat(buf, cap, off, suffix, strlen(suffix));
+          /* a missing suffix version is parsed as 0, so leave it out */
+          if ( handle->suffv != 0 )
+               off = lputil_bufcat(buf, cap, off, num,
+                                   lputil_u64toa(num, handle->suffv));
+     }
+     if ( handle->release != 0 ) {
+          off = lputil_bufcat(buf, cap, off, "-r", 2);
+          off = lputil_bufcat(buf, cap, off, num,
+                              lputil_u64toa(num, handle->release));
      }
+     if ( cap > 0 )
+          buf[off < cap ? off : cap-1] = '\0';
 
-     len = strlen(suffix)+lputil_intlen(handle->suffv)+1;
-     if ( (ret = malloc(len)) == NULL ) {
-          free(suffix);
-          return NULL;
+     return off;
+}
+
+static void
+lpversion_intern_init(void)
+{
+     lpversion_intern_tab = lputil_symtab_create();
+     lpversion_intern_arena = lputil_arena_create(0);
+
+     return;
+}
+
+static int
+lpversion_intern_set(uint32_t id, const lpversion_t *handle)
+{
+     const lpversion_t **t;
+     size_t size;
+
+     if ( id >= lpversion_intern_size ) {
+          size = lpversion_intern_size == 0 ? 64 : lpversion_intern_size*2;
+          while ( size <= id )
+               size *= 2;
+          if ( (t = realloc(lpversion_intern_handles,
+                            size*sizeof(*t))) == NULL )
+               return -1;
+          memset(t+lpversion_intern_size, 0,
+                 (size-lpversion_intern_size)*sizeof(*t));
+          lpversion_intern_handles = t;
+          lpversion_intern_size = size;
      }
+     lpversion_intern_handles[id] = handle;
 
-     tmp = stpcpy(ret, suffix);
-     (void)sprintf(tmp, "%d", handle->suffv);
-     free(suffix);
-     return ret;
+     return 0;
 }
 
-extern char *
-lpversion_compile(const lpversion_t *handle)
+static lpversion_t *
+lpversion_intern_copy(const lpversion_t *v)
 {
-     char *suffix=NULL, *numver, *ret, *tmp;
-     size_t len = 0;
+     lpversion_t *ret;
+     size_t n;
 
-     if ( (numver = lpversion_version_compile(handle)) == NULL )
+     for ( n=1; v->va[n-1] != -1; ++n )
+          ;
+     if ( (ret = lputil_arena_alloc(lpversion_intern_arena,
+                                    sizeof(*ret))) == NULL )
           return NULL;
-     len += strlen(numver);
-     if ( handle->suffix != LPV_NO ) {
-          if ( (suffix = lpversion_suffix_compile(handle)) == NULL ) {
-               free(numver);
-               return NULL;
-          }
-          if ( suffix[0] != '\0') {
-               len += strlen(suffix);
-               len += lputil_intlen(handle->suffv);
-               ++len;
-          }
-     }
-     if ( handle->release > 0 ) {
-          len += lputil_intlen(handle->release);
-          len+=2;
-     }
-     if ( (ret = malloc(len+1)) == NULL ) {
-          free(numver);
-          free(suffix);
+     *ret = *v;
+     ret->arena = lpversion_intern_arena;
+     if ( (ret->va = lputil_arena_alloc(lpversion_intern_arena,
+                                        n*sizeof(*ret->va))) == NULL )
+          return NULL;
+     memcpy(ret->va, v->va, n*sizeof(*ret->va));
+
+     return ret;
+}
+
+extern const lpversion_t *
+lpversion_intern(const char *version, size_t len)
+{
+     const lpversion_t *ret = NULL;
+     lpversion_t v;
+     lputil_strbuf_t sb;
+     const char *s;
+     size_t slen;
+     uint32_t id, sid;
+
+     pthread_once(&lpversion_intern_once, lpversion_intern_init);
+     if ( lpversion_intern_tab == NULL || lpversion_intern_arena == NULL ) {
+          errno = ENOMEM;
           return NULL;
      }
-     tmp = stpcpy(ret, numver);
-     free(numver);
-     if (suffix != NULL) {
-          tmp = stpcpy(tmp, "_");
-          tmp = stpcpy(tmp, suffix);
-          free(suffix);
+
+     pthread_mutex_lock(&lpversion_intern_lock);
+     id = lputil_symtab_lookup(lpversion_intern_tab, version, len);
+     if ( id != 0 && id < lpversion_intern_size )
+          ret = lpversion_intern_handles[id];
+     pthread_mutex_unlock(&lpversion_intern_lock);
+     if ( ret != NULL )
+          return ret;
+
+     /* parse and compile outside of the lock, the compiled string is the
+      * same for all spellings of a version */
+     lpversion_init(&v);
+     if ( lpversion_scan(&v, version, len) == -1 )
+          return NULL;
+     lputil_strbuf_init(&sb);
+     if ( lpversion_compile_buf(&v, &sb) == -1 )
+          goto lpversion_intern_bailout;
+     s = lputil_strbuf_str(&sb);
+     slen = lputil_strbuf_len(&sb);
+
+     pthread_mutex_lock(&lpversion_intern_lock);
+     if ( (sid = lputil_symtab_intern(lpversion_intern_tab, s, slen,
+                                      NULL)) == 0 )
+          goto lpversion_intern_unlock;
+     if ( sid < lpversion_intern_size )
+          ret = lpversion_intern_handles[sid];
+     if ( ret == NULL ) {
+          if ( (ret = lpversion_intern_copy(&v)) == NULL ||
+               lpversion_intern_set(sid, ret) == -1 ) {
+               ret = NULL;
+               goto lpversion_intern_unlock;
+          }
      }
-     if (handle->release != 0) {
-          tmp = stpcpy(tmp, "-r");
-          (void)sprintf(ret+strlen(ret), "%d", handle->release);
+     /* the given spelling is only a shortcut for the next lookup, so it
+      * does not matter if it cannot be added */
+     if ( slen != len || memcmp(s, version, len) != 0 ) {
+          if ( (id = lputil_symtab_intern(lpversion_intern_tab, version, len,
+                                          NULL)) != 0 )
+               (void)lpversion_intern_set(id, ret);
      }
 
+lpversion_intern_unlock:
+     pthread_mutex_unlock(&lpversion_intern_lock);
+lpversion_intern_bailout:
+     lputil_strbuf_reset(&sb);
+     lpversion_reset(&v);
      return ret;
 }
 
+static size_t
+lpversion_sort_key(const void *item, void *buf, size_t len)
+{
+     return lpversion_key(item, buf, len);
+}
+
+extern int
+lpversion_sort(const lpversion_t **versions, size_t n, unsigned int threads)
+{
+     return lputil_keysort((const void **)versions, n, lpversion_sort_key,
+                           threads);
+}
+
 #  ifdef __cplusplus
 }
 #  endif
@@ -40,9 +40,14 @@
 #include <util.h>
 
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 
 #include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
 
 #if HAVE_UNISTD_H
 #  include <unistd.h>
@@ -67,6 +72,11 @@ extern int errno;
 #  include <memory.h>
 #endif /* HAVE_MEMORY_H */
 
+/** @cond */
+#define LPMEM_SUBSYS    LPUTIL_MEM_XPAK
+/** @endcond */
+#include "lpmem.h"
+
 /**
  * @brief The Offset for the STOP String - calculated from SEEK_END.
  */
@@ -105,6 +115,52 @@ extern int errno;
  */
 #define LPXPAK_INT_SIZE       4
 
+/**
+ * @brief the length of the header of a xpak, the INTRO string and the lengths
+ * of the index and the data block.
+ */
+#define LPXPAK_HEAD_LEN         (LPXPAK_INTRO_LEN+LPXPAK_INT_SIZE*2)
+
+/**
+ * @brief appended to the path of a binary package to get the template of the
+ * temporary file of lpxpak_update_path().
+ */
+#define LPXPAK_TEMP_SUFFIX      ".XXXXXX"
+
+/**
+ * @brief the size of the buffer lpxpak_update_path() copies the tarball with.
+ */
+#define LPXPAK_COPY_LEN         65536
+
+/**
+ * @brief the length of the first bytes of a journal.
+ */
+#define LPXPAK_JOURNAL_MAGIC_LEN 8
+/**
+ * @brief the first bytes of a journal.
+ */
+#define LPXPAK_JOURNAL_MAGIC    "XPAKJRNL"
+
+/**
+ * @brief the length of the header of a journal, the magic, the offset of the
+ * old xpak and the length of the saved bytes.
+ */
+#define LPXPAK_JOURNAL_HEAD_LEN 24
+
+/**
+ * @brief the length of the checksum behind the saved bytes of a journal.
+ */
+#define LPXPAK_JOURNAL_SUM_LEN  8
+
+/**
+ * @brief the number of iovecs writev(2) takes at once.
+ */
+#ifdef IOV_MAX
+#  define LPXPAK_IOV_MAX        IOV_MAX
+#else
+#  define LPXPAK_IOV_MAX        16
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -115,358 +171,464 @@ extern "C" {
 typedef uint32_t lpxpak_int_t;
 
 /**
- * @brief A xpak index element.
+ * @brief returns the length of the name of a xpak entry.
+ *
+ * The names of a handle from lpxpak_parse_view() are not @c nul terminated,
+ * all other handles may have been filled in by the caller and only have a
+ * valid @c name.
  *
- * This is the Datastructure that holds one element of the Index Data parsed
- * by __lpxpak_parse_index.
+ * @param handle the handle of the entry.
  *
- * None of the Pointers in this struct will point to memory regions which are
- * used elsewhere by the lpxpak library.
+ * @param entry a xpak entry.
+ *
+ * @return the length of the name.
  */
-typedef struct lpxpak_index_entry {
-     /**
-      * @brief The Offset of the Data.
-      *
-      * The Offset needed to find the corresponding data block, calculated
-      * from the start of the data block.
-      */
-     size_t offset;
-     /**
-      * @brief The Length of the Data Block.
-      *
-      * The Length needed to copy out the corresponding data block.
-      */
-     size_t len;
-     /**
-      * @brief The Name of the Element.
-      *
-      * This Element is implemented as a null terminated C String.
-      */
-     char *name;
-} lpxpak_index_entry_t;
+static inline size_t
+lpxpak_entry_name_len(const lpxpak_t *handle, const lpxpak_entry_t *entry);
+
+/**
+ * @brief allocates memory for the members of a lpxpak_t handle.
+ *
+ * Takes the memory from the arena of the handle or from malloc(3).
+ *
+ * @param handle the handle the memory belongs to.
+ *
+ * @param len the number of bytes.
+ *
+ * @return the memory or @c NULL if an error occured.
+ */
+static void *
+lpxpak_alloc(const lpxpak_t *handle, size_t len);
+
+/**
+ * @brief frees memory from lpxpak_alloc().
+ *
+ * Memory from an arena is released together with the arena.
+ *
+ * @param handle the handle the memory belongs to.
+ *
+ * @param p the memory or @c NULL.
+ */
+static void
+lpxpak_release(const lpxpak_t *handle, void *p);
 
 /**
- * @brief The xpak data structure.
+ * @brief reads an integer from a xpak in network byte order.
  *
- * None of the Pointers in this struct will point to memory regions which are
- * used elsewhere by the lpxpak library.
+ * @param p the integer, does not need to be aligned.
  *
- * @sa lpxpak_create(), lpxpak_init(), lpxpak_reinit(), lpxpak_destroy().
+ * @return the integer in host byte order.
  */
-typedef struct lpxpak_index {
-     /**
-      * The length of the array entries.
-      */
-     size_t len;
-     /**
-      * A pointer to an array holding <len> lpxpak_index_entrie_t elements.
-      */
-     lpxpak_index_entry_t *entries;
-} lpxpak_index_t;
+static inline lpxpak_int_t
+lpxpak_int_read(const uint8_t *p);
 
 /**
  * @brief Parses the Index block of an XPAK.
  *
- * Gets a pointer to the index block of an xpak and the length of that index
- * block and parses it into the provided lpxpak_index_t handle. If an error
- * occurred, \c -1 is returned and errno is set to indicate the error.
+ * Walks the index block and stores an entry for each element in
+ * @c entries, with the name and the value pointing into the index and the
+ * data block. Nothing is copied or allocated. If an error occurred, @c -1 is
+ * returned and errno is set to indicate the error.
+ *
+ * @param entries the entries are stored here, there has to be room for one
+ * entry per LPXPAK_INT_SIZE*3 bytes of the index.
  *
- * The provided Index data will not be modified by this function.
+ * @param index the index block.
  *
- * @param handle a pointer to an lpxpak_index_t data structure used for this
- * operation.
+ * @param index_len the length of the index block.
  *
- * @param data a pointer to a memory segment which holds the index block.
- * 
- * @param len the length of the index block pointed to by data.
+ * @param data the data block.
  *
- * @return 0 if successfull or -1 if an error occured.
+ * @param data_len the length of the data block.
  *
- * @sa lpxpak_index_destroy().
+ * @return the number of entries or @c -1 if an error occured.
  *
  * @b Errors:
- * 
- * - This function may fail and set errno for any of the errors specified for
- *   the routine malloc(3).
+ *
+ * - @c EINVAL an element does not fit into the index or its value does not
+ *   fit into the data block or the values do not add up to the data block.
  */
-static int
-lpxpak_index_parse(lpxpak_index_t *handle, const void *data, size_t len);
+static ssize_t
+lpxpak_index_scan(lpxpak_entry_t *entries, const uint8_t *index,
+                  size_t index_len, const uint8_t *data, size_t data_len);
 
 /**
- * @brief Allocates a new lpxpak_index_t object and returns a pointer to it.
+ * @brief hashes a name with FNV-1a.
  *
- * If an error occurs, @c NULL is returned and errno is set.
+ * @param s the name, does not need to be @c nul terminated.
  *
- * The returned data structure can be initialized by lpxpak_index_init().
- * 
- * The Memory for the returned array including all its members can be freed
- * with lpxpak_index_destroy().
+ * @param len the length of the name.
  *
- * @return a pointer to an lpxpak_index_t object or @c NULL if an error
- * occured.
+ * @return the hash value.
+ */
+static inline uint32_t
+lpxpak_hash(const char *s, size_t len);
+
+/**
+ * @brief builds the hash table of lpxpak_get().
+ *
+ * The table uses linear probing and is never more than half full. If an
+ * error occurs, @c -1 is returned and errno is set to indicate the error.
+ *
+ * @param handle a lpxpak_t handle with parsed data.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
  *
- * @sa lpxpak_index_init(), lpxpak_index_destroy().
- * 
  * @b Errors:
  *
  * - This function may fail and set errno for any of the errors specified for
  *   the routine malloc(3).
  */
-static lpxpak_index_t *
-lpxpak_index_create(void);
+static int
+lpxpak_lookup_build(lpxpak_t *handle);
 
 /**
- * @brief Initialises a lpxpak_index_t object.
+ * @brief returns the entry with a name.
+ *
+ * Builds the hash table if there is none yet, if that fails the entries are
+ * searched one after another.
+ *
+ * @param handle a lpxpak_t handle with parsed data.
+ *
+ * @param key the name, does not need to be @c nul terminated.
  *
- * This function sets all values of the structure to @c 0 and all pointers to
- * @c NULL.
+ * @param len the length of the name.
  *
- * @param index a pointer to an lpxpak_index_t object.
- * 
- * @sa lpxpak_index_create(), lpxpak_index_destroy().
+ * @return the first entry with the name or @c NULL if there is none.
  */
-static void
-lpxpak_index_init(lpxpak_index_t *index);
+static lpxpak_entry_t *
+lpxpak_lookup(lpxpak_t *handle, const char *key, size_t len);
 
 /**
- * @brief resize an lpxpak_index_t object.
+ * @brief reads the xpak offset at the end of a Gentoo binary package.
  *
- * Resizes an lpxpak_index_t object and initializes the newly created entries.
+ * Reads the offset and the STOP string with a single pread(2) and checks
+ * that the xpak fits into the file. If an error occurs, @c -1 is returned
+ * and errno is set to indicate the error.
  *
- * @param index a pointer to an lpxpak_index_t object.
+ * @param fd a file descriptor with the gentoo binary package.
  *
- * @param size the new size it needs to be resized to.
+ * @param size the size of the file.
+ *
+ * @param len the length of the xpak is stored here.
  *
  * @return @c 0 if successfull or @c -1 if an error occured.
  *
  * @b Errors:
  *
+ * - @c EINVAL The file either is no valid gentoo binary package or has an
+ *   invalid xpak.
+ * - @c EBUSY The xpak offset could not be fully read in.
  * - This function may also fail and set errno for any of the errors specified
- *   for the routine realloc(3).
+ *   for the routine pread(2).
  */
 static int
-lpxpak_index_resize(lpxpak_index_t *index, size_t size);
+lpxpak_trailer_read(int fd, off_t size, size_t *len);
 
 /**
- * @brief Destroy an lpxpak_index_t object.
+ * @brief parses a xpak blob into a lpxpak_t handle.
+ *
+ * Does the work of lpxpak_parse_data() and lpxpak_parse_view(). Names and
+ * values that are not copied point into the blob, which then has to stay
+ * valid as long as the handle is used.
  *
- * frees up the struct and all of the underlying structures plus the pointers
- * they have using free(3). If @c NULL was given, this function will just
- * return.
+ * @param handle a pointer to an lpxpak_t data structure.
  *
- * @param index a pointer to an lpxpak_index_t object.
+ * @param blob the xpak blob.
  *
- * @warning Do not try to access the data structure after destroying it or
- * anything can happen.
+ * @param copy_names whether the names are copied.
+ *
+ * @param copy_values whether the data block is copied.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
  */
-static void
-lpxpak_index_destroy(lpxpak_index_t *index);
+static int
+lpxpak_parse_blob(lpxpak_t *handle, const lpxpak_blob_t *blob,
+                  bool copy_names, bool copy_values);
+
+/**
+ * @brief writes an integer into a xpak in network byte order.
+ *
+ * @param p the integer is written here, does not need to be aligned.
+ *
+ * @param i the integer in host byte order.
+ */
+static inline void
+lpxpak_int_write(uint8_t *p, lpxpak_int_t i);
 
 /**
- * @brief Allocates a new lpxpak_index_entry_t object and returns a pointer to
- * it.
+ * @brief describes the compiled form of a lpxpak_t handle as iovecs.
  *
- * If an error occurs, \c NULL is returned and errno is set.
+ * The iovecs point to the names and values of the handle and to the
+ * integers and strings of the xpak format, which are stored behind the
+ * iovecs in the same memory block. Nothing else is copied. The block has to
+ * be freed with free(3).
  *
- * The returned data structure should be initialized before using it by using
- * lpxpak_index_entry_init().
- * 
- * The Memory for the returned array including all its members can be freed
- * with lpxpak_index_entry_destroy().
+ * If an error occurs, @c NULL is returned and errno is set to indicate the
+ * error.
  *
- * @return a pointer to an lpxpak_index_t object or @c NULL if an error
- * occured.
+ * @param handle a lpxpak_t handle with parsed data.
+ *
+ * @param trailer whether the offset and the STOP string that end a binary
+ * package follow the xpak.
+ *
+ * @param n the number of iovecs is stored here.
+ *
+ * @param len the number of bytes they describe is stored here.
+ *
+ * @return the iovecs or @c NULL if an error occured.
  *
- * @sa lpxpak_index_entry_init(), lpxpak_index_entry_destroy().
- * 
  * @b Errors:
  *
+ * - @c EINVAL the xpak does not fit into the 32 bit lengths of the format.
  * - This function may fail and set errno for any of the errors specified for
  *   the routine malloc(3).
  */
-static lpxpak_index_entry_t *
-lpxpak_index_entry_create(size_t len);
+static struct iovec *
+lpxpak_iov_build(lpxpak_t *handle, bool trailer, size_t *n, size_t *len);
 
 /**
- * @brief Initialises a array of lpxpak_index_entry_t objects.
+ * @brief writes iovecs completely to a file descriptor.
  *
- * This function sets all values of the included structures to @c 0 and all
- * pointers to @c NULL.
+ * Passes at most LPXPAK_IOV_MAX iovecs to each writev(2) and continues after
+ * short writes and interrupts. The iovecs are modified. If an error occurs,
+ * @c -1 is returned and errno is set to indicate the error.
  *
- * @param index a pointer to an array of lpxpak_index_entry_t objects.
+ * @param fd the file descriptor.
  *
- * @param len the length of the given array.
- * 
- * @sa lpxpak_index_entry_create(), lpxpak_index_entry_destroy().
+ * @param iov the iovecs.
+ *
+ * @param n the number of iovecs.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine writev(2).
  */
-static void
-lpxpak_index_entry_init(lpxpak_index_entry_t *entries, size_t len);
+static int
+lpxpak_writev_all(int fd, struct iovec *iov, size_t n);
 
 /**
- * @brief Destroy an lpxpak_index_entry_t object.
+ * @brief writes a 64 bit integer of a journal in network byte order.
+ *
+ * @param p the integer is written here, does not need to be aligned.
  *
- * Frees up the array and all of the underlying structures plus the pointers
- * they have using free(3). If a @c NULL pointer was given, this function will
- * just return.
+ * @param i the integer in host byte order.
+ */
+static inline void
+lpxpak_u64_write(uint8_t *p, uint64_t i);
+
+/**
+ * @brief reads a 64 bit integer of a journal in network byte order.
  *
- * @param index a pointer to an lpxpak_index_t object.
+ * @param p the integer, does not need to be aligned.
  *
- * @warning Do not try to access the array after destroying it or anything can
- * happen.
+ * @return the integer in host byte order.
  */
-static void
-lpxpak_index_entry_destroy(lpxpak_index_entry_t *entries, size_t len);
+static inline uint64_t
+lpxpak_u64_read(const uint8_t *p);
 
-static lpxpak_entry_t *
-lpxpak_entry_create(size_t size);
+/**
+ * @brief reads exactly @c len bytes at an offset.
+ *
+ * If an error occurs, @c -1 is returned and errno is set to indicate the
+ * error.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ *
+ * @b Errors:
+ *
+ * - @c EBUSY the file ended before @c len bytes were read.
+ * - This function may fail and set errno for any of the errors specified for
+ *   the routine pread(2).
+ */
+static int
+lpxpak_pread_all(int fd, void *buf, size_t len, off_t offset);
 
-static void
-lpxpak_entry_init(lpxpak_entry_t *entry, size_t size);
+/**
+ * @brief takes an exclusive lock on a whole file, waiting for other holders.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ */
+static int
+lpxpak_lock(int fd);
 
 /**
- * @brief Parses an data block according to the provided index
+ * @brief flushes the directory entry of a file to the disk.
  *
- * Gets a pointer to the data block of an xpak and a @c NULL terminated array
- * of pointers to lpxpak_index_t structures which hold the corresponding
- * index data and returns and returns a @c NULL terminated array of pointers
- * to lpxpak_t structures with the xpak data. If an error occurred, \c NULL is
- * returned and errno is set to indicate the error.
+ * File systems that cannot sync directories are ignored.
  *
- * The provided lpxpak_index_t may be modified by this function.
+ * @param path the path of the file.
  *
- * @param data a pointer to the memory segment which holds the data block of
- * the xpak.
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ */
+static int
+lpxpak_sync_dir(const char *path);
+
+/**
+ * @brief computes the checksum of a journal.
  *
- * @param index a @c NULL terminated array of lpxpak_index_t structures
- * which hold the corresponding index data.
+ * A 64 bit FNV-1a hash over the header and the saved bytes, so that a
+ * journal whose blocks did not all reach the disk is recognised.
  *
- * @return a @c NULL terminated array of lpxpak_index_t structures which
- * hold the parsed xpak data or @c NULL if an error occured.
+ * @param head the header of the journal.
  *
- * @sa lpxpak_destroy()
+ * @param old the saved bytes.
  *
- * @b Errors:
+ * @param len the number of saved bytes.
  *
- * - This function may fail and set errno for any of the errors specified for
- *   the routine malloc(3).
+ * @return the checksum.
+ */
+static uint64_t
+lpxpak_journal_sum(const uint8_t *head, const void *old, size_t len);
+
+/**
+ * @brief returns the template of the temporary file next to a binary
+ * package, for mkstemp(3).
  *
- * - This function may fail and set errno for any of the errors specified for
- *   the routine strdup(3).
+ * @param path the path of the binary package.
+ *
+ * @return the template, to be freed with free(3), or @c NULL if an error
+ * occured.
  */
+static char *
+lpxpak_temp_path(const char *path);
 
+/**
+ * @brief copies the first @c len bytes of a file to another one.
+ *
+ * @param in the file to read from.
+ *
+ * @param out the file to write to, at its current offset.
+ *
+ * @param len the number of bytes.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
+ */
 static int
-lpxpak_data_parse(lpxpak_t *handle, const void *data, lpxpak_index_t *index);
+lpxpak_copy_fd(int in, int out, off_t len);
 
 /**
- * @brief compiles the index data of a @c NULL terminated array of lpxpak_t
- * structs into a xpak index binary blob.
- *
- * If an error occurs, @c NULL is returned and @c errno is set to indicate the
- * error.
+ * @brief frees the entries, names, values and hash table of a handle.
  *
- * @param xpak a @c NULL terminated array of lpxpak_t data structures.
+ * The mapping of lpxpak_parse_fd() is removed as well, the handle itself is
+ * left alone and has to be initialised again before it is used.
  *
- * @return a pointer to a lpxpak_blob_t data structure or @c NULL if an error
- * occured.
- * 
- * @b Errors:
- * 
- * - This function may fail and set errno for any of the errors specified for
- *   the routine malloc(3).
+ * @param handle a lpxpak_t handle.
  */
-static lpxpak_blob_t *
-lpxpak_indexblob_compile(lpxpak_t *xpak);
+static void
+lpxpak_members_free(lpxpak_t *handle);
 
 /**
- * @brief compiles the data data of a @c NULL terminated array of lpxpak_t
- * structs into a xpak data binary blob.
+ * @brief makes a handle own all of its names and values.
  *
- * If an error occurs, @c NULL is returned and @c errno is set to indicate the
- * error.
+ * Parses the compiled handle again as a copy and swaps it in, so that
+ * nothing points into a mapped file or a blob of the caller any more.
  *
- * @param xpak a @c NULL terminated array of lpxpak_t data structures.
+ * @param handle a lpxpak_t handle.
  *
- * @return a pointer to a lpxpak_blob_t data structure or @c NULL if an error
- * occured.
- * 
- * @b Errors:
- * 
- * - This function may fail and set errno for any of the errors specified for
- *   the routine malloc(3).
+ * @param blob the result of lpxpak_blob_compile() on @c handle.
+ *
+ * @return @c 0 if successfull or @c -1 if an error occured.
  */
-static lpxpak_blob_t *
-lpxpak_datablob_compile(lpxpak_t *xpak);
+static int
+lpxpak_own(lpxpak_t *handle, const lpxpak_blob_t *blob);
 
 extern int
 lpxpak_parse_data(lpxpak_t *handle, const lpxpak_blob_t *blob)
 {
-     lpxpak_int_t count = 0;
-     lpxpak_int_t index_len, data_len;
-     const void *index_data = NULL;
-     const void *data_data = NULL;
-     lpxpak_index_t *index = NULL;
-     size_t tl = 0;
-     unsigned int i;
-
-     /* check if the first __LPXPAK_INTRO_LEN bytes of the xpak data read
-      * __LPXPAK_INTRO and the last __LPXPAK_OUTRO_LEN bytes of the xpak read
-      * __LPXPAK_OUTRO to make sure we have a valid xpak, if not, set errno
-      * and return. Otherwise increase count which we will be using as an seek
-      * counter */
-     if ( (memcmp(blob->data, LPXPAK_INTRO, LPXPAK_INTRO_LEN) != 0) ||
+     return lpxpak_parse_blob(handle, blob, true, true);
+}
+
+extern int
+lpxpak_parse_view(lpxpak_t *handle, const lpxpak_blob_t *blob)
+{
+     return lpxpak_parse_blob(handle, blob, false, false);
+}
+
+static int
+lpxpak_parse_blob(lpxpak_t *handle, const lpxpak_blob_t *blob,
+                  bool copy_names, bool copy_values)
+{
+     const uint8_t *index_data, *data_data;
+     lpxpak_entry_t *entries = NULL;
+     void *tdata = NULL;
+     size_t index_len, data_len, max;
+     ssize_t n = 0, i = 0;
+     char *name;
+
+     /* check if the first LPXPAK_INTRO_LEN bytes of the xpak data read
+      * LPXPAK_INTRO and the last LPXPAK_OUTRO_LEN bytes of the xpak read
+      * LPXPAK_OUTRO to make sure we have a valid xpak, if not, set errno
+      * and return. */
+     if ( blob->len < LPXPAK_INTRO_LEN+LPXPAK_INT_SIZE*2+LPXPAK_OUTRO_LEN ||
+          (memcmp(blob->data, LPXPAK_INTRO, LPXPAK_INTRO_LEN) != 0) ||
          (memcmp((uint8_t *)blob->data+blob->len-LPXPAK_OUTRO_LEN,
          LPXPAK_OUTRO, LPXPAK_OUTRO_LEN) != 0) ) {
           errno = EINVAL;
-          goto lpxpak_parse_data_bailout;
+          return -1;
      }
-     count += LPXPAK_INTRO_LEN;
-     
-     memcpy(&index_len, (uint8_t *)blob->data+count, LPXPAK_INT_SIZE);
-     count+=LPXPAK_INT_SIZE;
-     index_len = ntohl(index_len);
-     memcpy(&data_len, (uint8_t *)blob->data+count, LPXPAK_INT_SIZE);
-     count += LPXPAK_INT_SIZE;
-     data_len = ntohl(data_len);
-
-     /* check if the sum of count, index_len, data_len and __LPXPAK_OUTRO_LEN
-      * is equal to len to make sure the len values are correct */
-     if ( count+index_len+data_len+LPXPAK_OUTRO_LEN != blob->len ) {
+     index_data = (uint8_t *)blob->data+LPXPAK_INTRO_LEN;
+     index_len = lpxpak_int_read(index_data);
+     data_len = lpxpak_int_read(index_data+LPXPAK_INT_SIZE);
+     index_data += LPXPAK_INT_SIZE*2;
+     data_data = index_data+index_len;
+
+     /* check if the sum of the header, index_len, data_len and
+      * LPXPAK_OUTRO_LEN is equal to len to make sure the len values are
+      * correct */
+     if ( LPXPAK_INTRO_LEN+LPXPAK_INT_SIZE*2+index_len+data_len+
+          LPXPAK_OUTRO_LEN != blob->len ) {
           errno = EINVAL;
-          goto lpxpak_parse_data_bailout;
+          return -1;
      }
 
-     index_data = (uint8_t *)blob->data+count;
-     data_data = (uint8_t *)blob->data+count+index_len;
-
-     /* create and initialize an index object */
-     if ( (index = lpxpak_index_create()) == NULL )
-          goto lpxpak_parse_data_bailout;
-     lpxpak_index_init(index);
-     /* get index */
-     if ( lpxpak_index_parse(index, index_data, (size_t)index_len) == -1 )
-          goto lpxpak_parse_data_bailout;
-     /* check if the sum of all len entries of all data elements is equal to
-      * data_len to make sure the len values are correct, if not, clean up the
-      * heap, set errno and return.  */
-     for ( i=0; (size_t)i < index->len; ++i )
-          tl += index->entries[i].len;
-     if ( tl != data_len ) {
-          errno = EINVAL;
-          goto lpxpak_parse_data_bailout;
+     /* every element takes at least three integers, so this single array is
+      * always large enough */
+     if ( (max = index_len/(LPXPAK_INT_SIZE*3)) > 0 &&
+          (entries = lpxpak_alloc(handle, sizeof(lpxpak_entry_t)*max))
+          == NULL )
+          return -1;
+     if ( (n = lpxpak_index_scan(entries, index_data, index_len, data_data,
+                                 data_len)) == -1 )
+          goto lpxpak_parse_blob_bailout;
+
+     /* copy the data block and move the values into the copy */
+     if ( copy_values && data_len > 0 ) {
+          if ( (tdata = lpxpak_alloc(handle, data_len)) == NULL )
+               goto lpxpak_parse_blob_bailout;
+          memcpy(tdata, data_data, data_len);
+          for ( i=0; i < n; ++i )
+               entries[i].value = (uint8_t *)tdata +
+                    ((uint8_t *)entries[i].value - data_data);
+     }
+     /* copy the names into nul terminated strings */
+     if ( copy_names ) {
+          for ( i=0; i < n; ++i ) {
+               if ( (name = lpxpak_alloc(handle, entries[i].name_len+1))
+                    == NULL )
+                    goto lpxpak_parse_blob_bailout;
+               memcpy(name, entries[i].name, entries[i].name_len);
+               name[entries[i].name_len] = '\0';
+               entries[i].name = name;
+          }
      }
 
-     /* get xpak-data  */
-     if ( (lpxpak_data_parse(handle, data_data, index)) == -1 )
-          goto lpxpak_parse_data_bailout;
-
-     handle->size = index->len;
-     /* free up index */
-     lpxpak_index_destroy(index);
-
+     handle->entries = entries;
+     handle->size = (size_t)n;
+     handle->data = tdata;
+     handle->borrowed = ! copy_names;
+     lpxpak_reindex(handle);
      return 0;
 
-lpxpak_parse_data_bailout:
-     lpxpak_index_destroy(index);
+lpxpak_parse_blob_bailout:
+     if ( copy_names )
+          while ( i-- > 0 )
+               lpxpak_release(handle, entries[i].name);
+     lpxpak_release(handle, tdata);
+     lpxpak_release(handle, entries);
      return -1;
 }
 
@@ -484,94 +646,135 @@ lpxpak_parse_fd(lpxpak_t *handle, int fd)
           return -1;
      }
 
-     /* get the xpakblob from lpxpak_get_blob_fd */
-     if ( (xpakblob = lpxpak_blob_get_fd(fd)) == NULL )
+     /* map the xpakblob, the values will point into the mapping */
+     if ( (xpakblob = lpxpak_blob_map_fd(fd)) == NULL )
           return -1;
 
-     /* parse the xpakblob */
-     if ( lpxpak_parse_data(handle, xpakblob) == -1 ) {
+     /* parse the xpakblob, the handle owns the mapping from now on */
+     if ( lpxpak_parse_blob(handle, xpakblob, true, false) == -1 ) {
           lpxpak_blob_destroy(xpakblob);
           return -1;
      }
-     /* free up xpakblob */
-     lpxpak_blob_destroy(xpakblob);
-     /* return whatever lpxpak_parse has returned (could be NULL or a pointer,
-      * does not matter to us here */
+     handle->blob = xpakblob;
+     return 0;
+}
+
+static int
+lpxpak_trailer_read(int fd, off_t size, size_t *len)
+{
+     uint8_t trailer[LPXPAK_OFFSET_LEN];
+     lpxpak_int_t xpakoffset;
+     ssize_t rs;
+
+     if ( size < LPXPAK_OFFSET_LEN ) {
+          errno = EINVAL;
+          return -1;
+     }
+     /* read in the xpak offset plus the STOP string */
+     if ( (rs = pread(fd, trailer, LPXPAK_OFFSET_LEN,
+                      size-LPXPAK_OFFSET_LEN)) == -1 )
+          return -1;
+     if ( rs != LPXPAK_OFFSET_LEN ) {
+          errno = EBUSY;
+          return -1;
+     }
+     /* check if the read in STOP string equals LPXPAK_STOP, if not this is
+      * an invalid xpak. */
+     if ( memcmp(trailer+LPXPAK_INT_SIZE, LPXPAK_STOP, LPXPAK_STOP_LEN)
+          != 0 ) {
+          errno = EINVAL;
+          return -1;
+     }
+     memcpy(&xpakoffset, trailer, LPXPAK_INT_SIZE);
+     xpakoffset = ntohl(xpakoffset);
+     if ( (off_t)xpakoffset > size-LPXPAK_OFFSET_LEN ) {
+          errno = EINVAL;
+          return -1;
+     }
+     *len = (size_t)xpakoffset;
+
      return 0;
 }
 
 extern lpxpak_blob_t *
 lpxpak_blob_get_fd(int fd)
 {
+     struct stat st;
      void *xpakdata = NULL;
-     void *tmp = NULL;
-     lpxpak_int_t *xpakoffset;
+     size_t xpaklen;
      ssize_t rs;
      lpxpak_blob_t *xpakblob;
 
-     /* seek to the start of the xpak offset */
-     if ( lseek(fd, (LPXPAK_STOP_OFFSET+LPXPAK_INT_SIZE)*-1, SEEK_END)
-         == -1 )
+     if ( fstat(fd, &st) == -1 )
+          return NULL;
+     if ( lpxpak_trailer_read(fd, st.st_size, &xpaklen) == -1 )
           return NULL;
 
-     /* allocate __LPXPAK_STOP_LEN+LPXPAK_INT_T_SIZE bytes from the heap,
-      * assign it to tmp, read in the xpak offset plus the__LPXPAK_STOP
-      * string. */
-     if ( (tmp = malloc(LPXPAK_STOP_LEN+LPXPAK_INT_SIZE)) == NULL )
+     /* allocate <xpaklen> bytes on the heap and read in the xpak data which
+      * ends right before the xpak offset. */
+     if ( (xpakdata = malloc(xpaklen)) == NULL )
           return NULL;
-     if ( (rs = read(fd, tmp, LPXPAK_STOP_LEN+LPXPAK_INT_SIZE))
-         == -1 )
-          goto lpxpak_blob_get_fd_bailout;
-     if ( rs != LPXPAK_STOP_LEN+LPXPAK_INT_SIZE ) {
-          errno = EBUSY;
-          goto lpxpak_blob_get_fd_bailout;
-     }
-     
-     /* check if the read in __LPXPAK_STOP string equals __LPXPAK_STOP.  If
-      * not, free the allocated memory, set errno and return NULL as this is
-      * an invalid xpak. */
-     if ( memcmp((uint8_t *)tmp+LPXPAK_INT_SIZE, LPXPAK_STOP,
-                 LPXPAK_STOP_LEN) != 0 ) {
-          errno = EINVAL;
-          goto lpxpak_blob_get_fd_bailout;
-     }
-     /* assign a pointer to the xpak offset data to xpakoffset and convert it
-      * to local byte order */
-     xpakoffset = (lpxpak_int_t *)tmp;
-     *xpakoffset = ntohl(*xpakoffset);
-
-     /* allocate <xpakoffset> bytes on the heap, assign it to xpakdata, seek
-      * to the start of the xpak data, read in the xpak data and store it in
-      * xpakdata. */
-     if ( lseek(fd, (off_t)((off_t)*xpakoffset+LPXPAK_OFFSET_LEN)*-1,
-         SEEK_END) == -1 )
-          goto lpxpak_blob_get_fd_bailout;
-     if ( (xpakdata = malloc((size_t)*xpakoffset)) == NULL )
-          goto lpxpak_blob_get_fd_bailout;
-     /* check if a error occured while data was read in */
-     if ( (rs = read(fd, xpakdata, (size_t)*xpakoffset)) == -1 )
+     if ( (rs = pread(fd, xpakdata, xpaklen,
+                      st.st_size-LPXPAK_OFFSET_LEN-(off_t)xpaklen)) == -1 )
           goto lpxpak_blob_get_fd_bailout;
      /* check if all of the data was read, if not, set errno and return with
       * failure  */
-     if ( rs != (ssize_t)*xpakoffset )
+     if ( rs != (ssize_t)xpaklen ) {
+          errno = EBUSY;
           goto lpxpak_blob_get_fd_bailout;
+     }
      /* initialize data structure for xpakblob */
      if ( (xpakblob = lpxpak_blob_create()) == NULL )
           goto lpxpak_blob_get_fd_bailout;
      lpxpak_blob_init(xpakblob);
      xpakblob->data = xpakdata;
-     xpakblob->len = *xpakoffset;
-     
-     /* clear up allocated memory*/
-     free(tmp);
+     xpakblob->len = xpaklen;
+
      return xpakblob;
 
 lpxpak_blob_get_fd_bailout:
-     free(tmp);
      free(xpakdata);
      return NULL;
 }
 
+extern lpxpak_blob_t *
+lpxpak_blob_map_fd(int fd)
+{
+     struct stat st;
+     lpxpak_blob_t *xpakblob;
+     size_t xpaklen;
+     off_t start, mstart;
+     long pagesize;
+     void *map;
+
+     if ( fstat(fd, &st) == -1 )
+          return NULL;
+     if ( lpxpak_trailer_read(fd, st.st_size, &xpaklen) == -1 )
+          return NULL;
+
+     /* the mapping has to start at a page boundary, only map the pages from
+      * the start of the xpak to the end of the file */
+     start = st.st_size-LPXPAK_OFFSET_LEN-(off_t)xpaklen;
+     if ( (pagesize = sysconf(_SC_PAGESIZE)) <= 0 )
+          pagesize = 4096;
+     mstart = start - start % pagesize;
+
+     if ( (xpakblob = lpxpak_blob_create()) == NULL )
+          return NULL;
+     lpxpak_blob_init(xpakblob);
+     if ( (map = mmap(NULL, (size_t)(st.st_size-mstart), PROT_READ,
+                      MAP_PRIVATE, fd, mstart)) == MAP_FAILED ) {
+          free(xpakblob);
+          return NULL;
+     }
+     xpakblob->map = map;
+     xpakblob->map_len = (size_t)(st.st_size-mstart);
+     xpakblob->data = (uint8_t *)map + (start-mstart);
+     xpakblob->len = xpaklen;
+
+     return xpakblob;
+}
+
 extern int
 lpxpak_parse_path(lpxpak_t *handle, const char *path)
 {
@@ -591,286 +794,277 @@ lpxpak_parse_path(lpxpak_t *handle, const char *path)
      return 0;
 }
 
-static int
-lpxpak_index_parse(lpxpak_index_t *handle, const void *data, size_t len)
+static inline size_t
+lpxpak_entry_name_len(const lpxpak_t *handle, const lpxpak_entry_t *entry)
 {
-     lpxpak_index_t *t = NULL;
-     lpxpak_int_t count = 0;
-     lpxpak_int_t name_len = 0;
-     size_t indexlen = 100;
-     lpxpak_int_t intt;
-     unsigned int i;
-
-     if ( handle == NULL )
-          return -1;
-     
-     if ( (handle->entries = lpxpak_index_entry_create(indexlen)) == NULL )
-          return -1;
+     return handle->borrowed ? entry->name_len : strlen(entry->name);
+}
 
-     handle->len = indexlen;
-     lpxpak_index_entry_init(handle->entries, handle->len);
-
-     /* iterate over the index block  */
-     for ( i=0; count < len; ++i ) {
-          if ( (size_t)i == indexlen-1 ) {
-               indexlen += 50;
-               /* check if we got enough free entries in index, if not resize
-                * it */
-               if ( lpxpak_index_resize(handle, indexlen) == -1 )
-                    return -1;
-               t = NULL;
-          }
-          /* read name_len from data and increase the counter */
-          name_len = *((lpxpak_int_t *)((uint8_t *)data+count));
-          name_len = ntohl(name_len);
-          count += LPXPAK_INT_SIZE;
+static inline lpxpak_int_t
+lpxpak_int_read(const uint8_t *p)
+{
+     lpxpak_int_t i;
 
-          /* allocate name_len+1 bytes on the heap, assign it to t->name, read
-           * name_len bytes from data into t->name, apply name_len+1 to
-           * t->name_len, and increase the counter by name_len bytes */
-          if ( (handle->entries[i].name = malloc(name_len+1)) == NULL )
-               return -1;
-          memcpy(handle->entries[i].name, (char *)data+count, name_len);
-          handle->entries[i].name[name_len] = '\0';
+     memcpy(&i, p, LPXPAK_INT_SIZE);
+     return ntohl(i);
+}
 
-          count += name_len;
-          
-          /* read t->offset from data in local byte order and increase
-           * counter */
-          intt = *((lpxpak_int_t *)((uint8_t *)data+count));
-          handle->entries[i].offset = ntohl(intt);
+static ssize_t
+lpxpak_index_scan(lpxpak_entry_t *entries, const uint8_t *index,
+                  size_t index_len, const uint8_t *data, size_t data_len)
+{
+     size_t count = 0;
+     size_t name_len, offset, len, total = 0;
+     ssize_t n;
+
+     /* iterate over the index block, every element is the length of the
+      * name, the name, the offset and the length of the value */
+     for ( n=0; count < index_len; ++n ) {
+          if ( index_len-count < LPXPAK_INT_SIZE )
+               goto lpxpak_index_scan_invalid;
+          name_len = lpxpak_int_read(index+count);
           count += LPXPAK_INT_SIZE;
+          if ( index_len-count < LPXPAK_INT_SIZE*2 ||
+               name_len > index_len-count-LPXPAK_INT_SIZE*2 )
+               goto lpxpak_index_scan_invalid;
+          entries[n].name = (char *)index+count;
+          entries[n].name_len = name_len;
+          count += name_len;
 
-          /* read t->len from data in local byte order and increase counter */
-          intt = *((lpxpak_int_t *)((uint8_t *)data+count));
-          handle->entries[i].len = htonl(intt);
+          offset = lpxpak_int_read(index+count);
           count += LPXPAK_INT_SIZE;
+          len = lpxpak_int_read(index+count);
+          count += LPXPAK_INT_SIZE;
+          if ( offset > data_len || len > data_len-offset )
+               goto lpxpak_index_scan_invalid;
+          entries[n].value = (void *)(data+offset);
+          entries[n].value_len = len;
+          total += len;
      }
-     if ( lpxpak_index_resize(handle, (size_t)i) == -1 )
-          return -1;
+     /* check if the sum of all values is equal to data_len to make sure the
+      * len values are correct */
+     if ( total != data_len )
+          goto lpxpak_index_scan_invalid;
 
-     return 0;
+     return n;
+
+lpxpak_index_scan_invalid:
+     errno = EINVAL;
+     return -1;
 }
 
-static lpxpak_index_t *
-lpxpak_index_create(void)
+extern lpxpak_t *
+lpxpak_create(void)
 {
-     lpxpak_index_t *index;
-
-     /* allocate memory */
-     if ( (index = malloc(sizeof(lpxpak_index_t))) == NULL )
-          return NULL;
-
-     return index;
+     return malloc(sizeof(lpxpak_t));
 }
 
-static void
-lpxpak_index_init(lpxpak_index_t *index)
+extern lpxpak_t *
+lpxpak_create_alloc(const lputil_alloc_t *alloc)
 {
-     index->len = 0;
-     index->entries = NULL;
-     
-     return;
+     /* without an allocator the handle is counted for this module, just
+      * like with lpxpak_create() */
+     if ( alloc == NULL )
+          return malloc(sizeof(lpxpak_t));
+     return lputil_alloc(alloc, sizeof(lpxpak_t));
 }
 
-static int
-lpxpak_index_resize(lpxpak_index_t *index, size_t size)
+extern void
+lpxpak_init(lpxpak_t *xpak)
 {
-     lpxpak_index_entry_t *t;
+     if ( xpak == NULL )
+          return;
 
-     if ( index == NULL ) {
-          errno = EINVAL;
-          return -1;
-     }
-
-     if ( (t = realloc(index->entries, sizeof(lpxpak_index_entry_t)*(size+1)))
-         == NULL ) {
-          return -1;
-     }
-     index->entries = t;
-
-     if (size > index->len)
-          lpxpak_index_entry_init(index->entries+index->len, size-index->len);
-     index->len = size;
-     return 0;
+     xpak->entries = NULL;
+     xpak->size = 0;
+     xpak->data = NULL;
+     xpak->blob = NULL;
+     xpak->borrowed = 0;
+     xpak->lookup = NULL;
+     xpak->lookup_mask = 0;
+     xpak->arena = NULL;
+     return;
 }
 
-static void
-lpxpak_index_destroy(lpxpak_index_t *index)
+extern void
+lpxpak_init_arena(lpxpak_t *xpak, lputil_arena_t *arena)
 {
-     if ( index == NULL )
+     if ( xpak == NULL )
           return;
-     if ( index->entries != NULL )
-          lpxpak_index_entry_destroy(index->entries, index->len);
 
-     free(index);
+     lpxpak_init(xpak);
+     xpak->arena = arena;
      return;
 }
 
-static lpxpak_index_entry_t *
-lpxpak_index_entry_create(size_t len)
+static void *
+lpxpak_alloc(const lpxpak_t *handle, size_t len)
 {
-     return malloc(sizeof(lpxpak_index_entry_t)*len);
+     if ( handle->arena != NULL )
+          return lputil_arena_alloc(handle->arena, len);
+     return malloc(len);
 }
 
 static void
-lpxpak_index_entry_init(lpxpak_index_entry_t *entries, size_t len)
+lpxpak_release(const lpxpak_t *handle, void *p)
 {
-     size_t i;
-
-     for ( i=0; i<len; ++i ) {
-          entries[i].name = NULL;
-          entries[i].offset = 0;
-          entries[i].len = 0;
-     }
-     
+     if ( handle->arena == NULL )
+          free(p);
      return;
 }
 
-static void
-lpxpak_index_entry_destroy(lpxpak_index_entry_t *entries, size_t len)
+extern void
+lpxpak_destroy(lpxpak_t *xpak)
 {
-     size_t i;
-     
-     for ( i=0; i<len; ++i )
-          free(entries[i].name);
-     free(entries);
+     lpxpak_destroy_alloc(xpak, NULL);
      return;
 }
 
-static int
-lpxpak_data_parse(lpxpak_t *handle, const void *data, lpxpak_index_t *index)
+extern void
+lpxpak_destroy_alloc(lpxpak_t *xpak, const lputil_alloc_t *alloc)
 {
-     unsigned int i, isize, dlen = 0;
-     void *tdata;
-
-     /* count the total length */
-     for ( i=0; (size_t)i < index->len; ++i )
-          dlen += index->entries[i].len;
-     isize = (unsigned int)index->len;
-
-     /* initialize a new empty NULL terminated array of lpxpak_t structures
-      * with the size len */
-     if ( (handle->entries = lpxpak_entry_create((size_t)isize)) == NULL )
-          return -1;
-     lpxpak_entry_init(handle->entries, handle->size);
-
-     /* copy the data block */
-     if ( (tdata = lputil_memdup(data, (size_t)dlen)) == NULL ) {
-          return -1;
-     }
-
-     /* operate over all index elements */
-     for ( i=0; i < isize; ++i ) {
-          /* assign ti->name to tx->name and set ti->name to NULL */
-          handle->entries[i].name = index->entries[i].name;
-          index->entries[i].name = NULL;
+     if ( xpak == NULL )
+          return;
 
-          /* assign the index[i]->offset'th byte of tdata to xpak[i]->value */
-          handle->entries[i].value = (char *)tdata + index->entries[i].offset;
-          handle->entries[i].value_len = index->entries[i].len;
-     }
-     return 0;
+     lpxpak_members_free(xpak);
+     if ( alloc == NULL )
+          free(xpak);
+     else
+          lputil_free(alloc, xpak);
+     return;
 }
 
-extern lpxpak_t *
-lpxpak_create(void)
+extern lpxpak_blob_t *
+lpxpak_blob_create(void)
 {
-     return malloc(sizeof(lpxpak_t));
+     return malloc(sizeof(lpxpak_blob_t));
 }
 
 extern void
-lpxpak_init(lpxpak_t *xpak)
+lpxpak_blob_init(lpxpak_blob_t *blob)
 {
-     if ( xpak == NULL )
-          return;
-
-     xpak->entries = NULL;
-     xpak->size = 0;
+     /* initialize data */
+     blob->data = NULL;
+     blob->len = 0;
+     blob->map = NULL;
+     blob->map_len = 0;
      return;
 }
 
 extern void
-lpxpak_destroy(lpxpak_t *xpak)
+lpxpak_blob_destroy(lpxpak_blob_t *blob)
 {
-     int i;
-
-     if ( xpak == NULL )
+     if ( blob == NULL )
           return;
+     if ( blob->map != NULL )
+          (void)munmap(blob->map, blob->map_len);
+     else
+          free(blob->data);
+     free(blob);
+}
 
-     /* check if the xpak has an entry array */
-     if ( xpak->size > 0 ) {
-          free(xpak->entries->value);
-          for ( i=0; (size_t)i<xpak->size; ++i ) {
-               free(xpak->entries[i].name);
-          }
-          free(xpak->entries);
+static inline uint32_t
+lpxpak_hash(const char *s, size_t len)
+{
+     uint32_t h = 2166136261U;
+     size_t i;
+
+     for ( i=0; i < len; ++i ) {
+          h ^= (unsigned char)s[i];
+          h *= 16777619U;
      }
-     free(xpak);
-     return;
+
+     return h;
 }
 
-static lpxpak_entry_t *
-lpxpak_entry_create(size_t size)
+static int
+lpxpak_lookup_build(lpxpak_t *handle)
 {
-     return malloc(sizeof(lpxpak_entry_t)*size);
+     lpxpak_entry_t *e;
+     size_t slots, i, j;
+
+     for ( slots = 2; slots < handle->size*2; slots <<= 1 )
+          ;
+     if ( (handle->lookup = lpxpak_alloc(handle, sizeof(uint32_t)*slots))
+          == NULL )
+          return -1;
+     memset(handle->lookup, 0, sizeof(uint32_t)*slots);
+     handle->lookup_mask = slots-1;
+
+     for ( i=0; i < handle->size; ++i ) {
+          e = &handle->entries[i];
+          for ( j = lpxpak_hash(e->name, lpxpak_entry_name_len(handle, e)) &
+                     handle->lookup_mask; handle->lookup[j] != 0;
+                j = (j+1) & handle->lookup_mask )
+               ;
+          handle->lookup[j] = (uint32_t)i+1;
+     }
+
+     return 0;
 }
 
-static void
-lpxpak_entry_init(lpxpak_entry_t *entry, size_t size)
+static lpxpak_entry_t *
+lpxpak_lookup(lpxpak_t *handle, const char *key, size_t len)
 {
+     lpxpak_entry_t *e;
+     uint32_t id;
      size_t i;
 
-     if ( entry == NULL )
-          return;
+     if ( handle->size == 0 )
+          return NULL;
+     /* iterate over xpak until the end or the searched entry was found if
+      * there is no memory for the table */
+     if ( handle->lookup == NULL && lpxpak_lookup_build(handle) == -1 ) {
+          for ( i=0; i < handle->size; ++i ) {
+               e = &handle->entries[i];
+               if ( lpxpak_entry_name_len(handle, e) == len &&
+                    memcmp(e->name, key, len) == 0 )
+                    return e;
+          }
+          return NULL;
+     }
 
-     for ( i=0; i<size; ++i ) {
-          entry[i].name = NULL;
-          entry[i].value = NULL;
-          entry[i].value_len = 0;
+     /* names that were inserted earlier come first in the probe sequence, so
+      * the first of equal names is found like in the linear search */
+     for ( i = lpxpak_hash(key, len) & handle->lookup_mask;
+           (id = handle->lookup[i]) != 0; i = (i+1) & handle->lookup_mask ) {
+          e = &handle->entries[id-1];
+          if ( lpxpak_entry_name_len(handle, e) == len &&
+               memcmp(e->name, key, len) == 0 )
+               return e;
      }
-     return;
-}
 
-extern lpxpak_blob_t *
-lpxpak_blob_create(void)
-{
-     return malloc(sizeof(lpxpak_blob_t));
+     return NULL;
 }
 
-extern void
-lpxpak_blob_init(lpxpak_blob_t *blob)
+extern lpxpak_entry_t *
+lpxpak_get(lpxpak_t *handle, char *key)
 {
-     /* initialize data */
-     blob->data = NULL;
-     blob->len = 0;
-     return;
+     return lpxpak_lookup(handle, key, strlen(key));
 }
 
-extern void
-lpxpak_blob_destroy(lpxpak_blob_t *blob)
+extern size_t
+lpxpak_get_n(lpxpak_t *handle, const char *const *keys, size_t n,
+             lpxpak_entry_t **entries)
 {
-     if ( blob == NULL )
-          return;
-     free(blob->data);
-     free(blob);
+     size_t i, found = 0;
+
+     for ( i=0; i < n; ++i )
+          if ( (entries[i] = lpxpak_lookup(handle, keys[i],
+                                           strlen(keys[i]))) != NULL )
+               ++found;
+
+     return found;
 }
 
-extern lpxpak_entry_t *
-lpxpak_get(lpxpak_t *handle, char *key)
+extern void
+lpxpak_reindex(lpxpak_t *handle)
 {
-     size_t i;
+     lpxpak_release(handle, handle->lookup);
+     handle->lookup = NULL;
+     handle->lookup_mask = 0;
 
-     /* iterate over xpak until the end (NULL) or the searched entry was found
-      * and return the last processed entry which should be either NULL or the
-      * one we searched for */
-     for ( i=0; i < handle->size || strcmp(handle->entries[i].name, key) != 0;
-          ++i )
-          ;
-     if ( i == handle->size )
-          return NULL;
-     
-     return &handle->entries[i];
+     return;
 }
 
 lpxpak_blob_t *
@@ -889,136 +1083,551 @@ lpxpak_blob_get_path(const char *path)
      return xpakblob;
 }
 
-extern lpxpak_blob_t *
-lpxpak_blob_compile(lpxpak_t *handle)
+static inline void
+lpxpak_int_write(uint8_t *p, lpxpak_int_t i)
 {
-     size_t bloblen;
-     size_t count = 0;
-     lpxpak_blob_t *index=NULL;
-     lpxpak_blob_t *data=NULL;
-     lpxpak_blob_t *blob=NULL;
-     lpxpak_int_t bil, bdl;
-    
-
-     /* build index blob */
-     if ( (index = lpxpak_indexblob_compile(handle)) == NULL )
-          goto lpxpak_blob_compile_bailout;
+     i = htonl(i);
+     memcpy(p, &i, LPXPAK_INT_SIZE);
 
-     if ( (data = lpxpak_datablob_compile(handle)) == NULL )
-          goto lpxpak_blob_compile_bailout;
+     return;
+}
+
+static struct iovec *
+lpxpak_iov_build(lpxpak_t *handle, bool trailer, size_t *n, size_t *len)
+{
+     struct iovec *iov;
+     lpxpak_entry_t *e;
+     uint8_t *head, *ints, *tail;
+     size_t niov, index_len = 0, data_len = 0, name_len, xpak_len;
+     size_t i, j;
+
+     /* compute the lengths up front */
+     for ( i=0; i < handle->size; ++i ) {
+          name_len = lpxpak_entry_name_len(handle, &handle->entries[i]);
+          if ( name_len > UINT32_MAX ||
+               handle->entries[i].value_len > UINT32_MAX-data_len ) {
+               errno = EINVAL;
+               return NULL;
+          }
+          index_len += LPXPAK_INT_SIZE*3 + name_len;
+          data_len += handle->entries[i].value_len;
+     }
+     xpak_len = LPXPAK_HEAD_LEN+index_len+data_len+LPXPAK_OUTRO_LEN;
+     if ( index_len > UINT32_MAX || xpak_len > UINT32_MAX ) {
+          errno = EINVAL;
+          return NULL;
+     }
+
+     /* the header, three iovecs for each element of the index, one for each
+      * value, the OUTRO and the trailer */
+     niov = 1 + handle->size*4 + 1 + (trailer ? 1 : 0);
+     if ( (iov = malloc(sizeof(struct iovec)*niov + LPXPAK_HEAD_LEN +
+                        LPXPAK_INT_SIZE*3*handle->size + LPXPAK_OFFSET_LEN))
+          == NULL )
+          return NULL;
+     head = (uint8_t *)(iov+niov);
+     ints = head+LPXPAK_HEAD_LEN;
+     tail = ints+LPXPAK_INT_SIZE*3*handle->size;
+
+     memcpy(head, LPXPAK_INTRO, LPXPAK_INTRO_LEN);
+     lpxpak_int_write(head+LPXPAK_INTRO_LEN, (lpxpak_int_t)index_len);
+     lpxpak_int_write(head+LPXPAK_INTRO_LEN+LPXPAK_INT_SIZE,
+                      (lpxpak_int_t)data_len);
+     iov[0].iov_base = head;
+     iov[0].iov_len = LPXPAK_HEAD_LEN;
+
+     /* the index, every element is the length of the name, the name and the
+      * offset and length of the value, which follow each other in ints */
+     data_len = 0;
+     for ( i=0, j=1; i < handle->size; ++i, j += 3 ) {
+          e = &handle->entries[i];
+          name_len = lpxpak_entry_name_len(handle, e);
+          lpxpak_int_write(ints, (lpxpak_int_t)name_len);
+          lpxpak_int_write(ints+LPXPAK_INT_SIZE, (lpxpak_int_t)data_len);
+          lpxpak_int_write(ints+LPXPAK_INT_SIZE*2, (lpxpak_int_t)e->value_len);
+          iov[j].iov_base = ints;
+          iov[j].iov_len = LPXPAK_INT_SIZE;
+          iov[j+1].iov_base = e->name;
+          iov[j+1].iov_len = name_len;
+          iov[j+2].iov_base = ints+LPXPAK_INT_SIZE;
+          iov[j+2].iov_len = LPXPAK_INT_SIZE*2;
+          ints += LPXPAK_INT_SIZE*3;
+          data_len += e->value_len;
+     }
+     /* the values */
+     for ( i=0; i < handle->size; ++i, ++j ) {
+          iov[j].iov_base = handle->entries[i].value;
+          iov[j].iov_len = handle->entries[i].value_len;
+     }
+     iov[j].iov_base = (void *)LPXPAK_OUTRO;
+     iov[j].iov_len = LPXPAK_OUTRO_LEN;
+     ++j;
+     if ( trailer ) {
+          lpxpak_int_write(tail, (lpxpak_int_t)xpak_len);
+          memcpy(tail+LPXPAK_INT_SIZE, LPXPAK_STOP, LPXPAK_STOP_LEN);
+          iov[j].iov_base = tail;
+          iov[j].iov_len = LPXPAK_OFFSET_LEN;
+          xpak_len += LPXPAK_OFFSET_LEN;
+     }
+
+     *n = niov;
+     *len = xpak_len;
+     return iov;
+}
 
-     bloblen = LPXPAK_INTRO_LEN + (LPXPAK_INT_SIZE*2) + data->len +
-          index->len + LPXPAK_OUTRO_LEN;
+static int
+lpxpak_writev_all(int fd, struct iovec *iov, size_t n)
+{
+     ssize_t rs;
 
+     while ( n > 0 ) {
+          if ( (rs = writev(fd, iov, (int)(n < LPXPAK_IOV_MAX ? n :
+                                           LPXPAK_IOV_MAX))) == -1 ) {
+               if ( errno == EINTR )
+                    continue;
+               return -1;
+          }
+          /* skip what was written, a short write leaves the rest of an
+           * iovec for the next call */
+          for ( ; n > 0 && (size_t)rs >= iov->iov_len; ++iov, --n )
+               rs -= (ssize_t)iov->iov_len;
+          if ( n > 0 ) {
+               iov->iov_base = (uint8_t *)iov->iov_base + rs;
+               iov->iov_len -= (size_t)rs;
+          }
+     }
+
+     return 0;
+}
+
+extern lpxpak_blob_t *
+lpxpak_blob_compile(lpxpak_t *handle)
+{
+     struct iovec *iov;
+     lpxpak_blob_t *blob = NULL;
+     size_t n, len, i, count = 0;
+
+     if ( (iov = lpxpak_iov_build(handle, false, &n, &len)) == NULL )
+          return NULL;
      if ( (blob = lpxpak_blob_create()) == NULL )
           goto lpxpak_blob_compile_bailout;
      lpxpak_blob_init(blob);
-     if ( (blob->data = malloc(bloblen)) == NULL )
+     if ( (blob->data = malloc(len)) == NULL )
           goto lpxpak_blob_compile_bailout;
-     bil = htonl(index->len);
-     bdl = htonl(data->len);
-     
-     memcpy(blob->data, LPXPAK_INTRO, LPXPAK_INTRO_LEN);
-     count += LPXPAK_INTRO_LEN;
-     memcpy((uint8_t *)blob->data+count, &bil, LPXPAK_INT_SIZE);
-     count += LPXPAK_INT_SIZE;
-     memcpy((uint8_t *)blob->data+count, &bdl, LPXPAK_INT_SIZE);
-     count += LPXPAK_INT_SIZE;
-     memcpy((uint8_t *)blob->data+count, index->data, index->len);
-     count += index->len;
-     lpxpak_blob_destroy(index);
-     memcpy((uint8_t *)blob->data+count, data->data, data->len);
-     count += data->len;
-     lpxpak_blob_destroy(data);
-     memcpy((uint8_t *)blob->data+count, LPXPAK_OUTRO, LPXPAK_OUTRO_LEN);
-     count += LPXPAK_OUTRO_LEN;
+
+     /* gather everything into the blob */
+     for ( i=0; i < n; ++i ) {
+          if ( iov[i].iov_len == 0 )
+               continue;
+          memcpy((uint8_t *)blob->data+count, iov[i].iov_base, iov[i].iov_len);
+          count += iov[i].iov_len;
+     }
      blob->len = count;
 
+     free(iov);
      return blob;
 
 lpxpak_blob_compile_bailout:
-     lpxpak_blob_destroy(index);
+     free(iov);
      lpxpak_blob_destroy(blob);
      return NULL;
 }
 
-static lpxpak_blob_t *
-lpxpak_datablob_compile(lpxpak_t *xpak)
+extern int
+lpxpak_write_fd(lpxpak_t *handle, int fd, int trailer)
 {
-     size_t i;
-     lpxpak_blob_t *datablob;
-     size_t count = 0;
-     size_t datalen = 0;
+     struct iovec *iov;
+     size_t n, len;
+     int rv;
 
-     /* initialise the datablob data structure */
-     if ( (datablob = lpxpak_blob_create()) == NULL )
-          return NULL;
-     lpxpak_blob_init(datablob);
-     
-     /* get len of the data blob */
-     for ( i=0; i < xpak->size; ++i )
-          datalen += xpak->entries[i].value_len;
-
-     /* allocate enough memory for the datablob */
-     if ( (datablob->data = malloc(datalen)) == NULL ) {
-          lpxpak_blob_destroy(datablob);
+     if ( (iov = lpxpak_iov_build(handle, trailer != 0, &n, &len)) == NULL )
+          return -1;
+     rv = lpxpak_writev_all(fd, iov, n);
+     free(iov);
+
+     return rv;
+}
+
+static inline void
+lpxpak_u64_write(uint8_t *p, uint64_t i)
+{
+     lpxpak_int_write(p, (lpxpak_int_t)(i >> 32));
+     lpxpak_int_write(p+LPXPAK_INT_SIZE, (lpxpak_int_t)i);
+
+     return;
+}
+
+static inline uint64_t
+lpxpak_u64_read(const uint8_t *p)
+{
+     return (uint64_t)lpxpak_int_read(p) << 32 |
+          lpxpak_int_read(p+LPXPAK_INT_SIZE);
+}
+
+static int
+lpxpak_pread_all(int fd, void *buf, size_t len, off_t offset)
+{
+     ssize_t rs;
+
+     while ( len > 0 ) {
+          if ( (rs = pread(fd, buf, len, offset)) == -1 ) {
+               if ( errno == EINTR )
+                    continue;
+               return -1;
+          }
+          if ( rs == 0 ) {
+               errno = EBUSY;
+               return -1;
+          }
+          buf = (uint8_t *)buf + rs;
+          len -= (size_t)rs;
+          offset += rs;
+     }
+
+     return 0;
+}
+
+static int
+lpxpak_lock(int fd)
+{
+     struct flock fl;
+
+     memset(&fl, 0, sizeof(fl));
+     fl.l_type = F_WRLCK;
+     fl.l_whence = SEEK_SET;
+     while ( fcntl(fd, F_SETLKW, &fl) == -1 )
+          if ( errno != EINTR )
+               return -1;
+
+     return 0;
+}
+
+static int
+lpxpak_sync_dir(const char *path)
+{
+     const char *slash;
+     char *dir;
+     int fd, rv = 0;
+
+     if ( (slash = strrchr(path, '/')) == NULL )
+          dir = strdup(".");
+     else if ( slash == path )
+          dir = strdup("/");
+     else if ( (dir = malloc((size_t)(slash-path)+1)) != NULL ) {
+          memcpy(dir, path, (size_t)(slash-path));
+          dir[slash-path] = '\0';
+     }
+     if ( dir == NULL )
+          return -1;
+
+     if ( (fd = open(dir, O_RDONLY)) == -1 ) {
+          free(dir);
+          return -1;
+     }
+     if ( fsync(fd) == -1 && errno != EINVAL )
+          rv = -1;
+     (void)close(fd);
+     free(dir);
+
+     return rv;
+}
+
+static char *
+lpxpak_temp_path(const char *path)
+{
+     size_t len = strlen(path);
+     char *tpath;
+
+     if ( (tpath = malloc(len+sizeof(LPXPAK_TEMP_SUFFIX))) == NULL )
           return NULL;
+     memcpy(tpath, path, len);
+     memcpy(tpath+len, LPXPAK_TEMP_SUFFIX, sizeof(LPXPAK_TEMP_SUFFIX));
+
+     return tpath;
+}
+
+static int
+lpxpak_copy_fd(int in, int out, off_t len)
+{
+     struct iovec iov;
+     void *buf;
+     off_t off = 0;
+     size_t n;
+
+     if ( (buf = malloc(LPXPAK_COPY_LEN)) == NULL )
+          return -1;
+     while ( off < len ) {
+          n = len-off < LPXPAK_COPY_LEN ? (size_t)(len-off) : LPXPAK_COPY_LEN;
+          if ( lpxpak_pread_all(in, buf, n, off) == -1 )
+               goto lpxpak_copy_fd_bailout;
+          iov.iov_base = buf;
+          iov.iov_len = n;
+          if ( lpxpak_writev_all(out, &iov, 1) == -1 )
+               goto lpxpak_copy_fd_bailout;
+          off += (off_t)n;
      }
-     datablob->len = datalen;
-     
-     /* copy data to datablob */
-     for ( i=0; i < xpak->size; ++i ) {
-          memcpy((uint8_t *)datablob->data+count, xpak->entries[i].value,
-                 xpak->entries[i].value_len);
-          count += xpak->entries[i].value_len;
+
+     free(buf);
+     return 0;
+
+lpxpak_copy_fd_bailout:
+     free(buf);
+     return -1;
+}
+
+static void
+lpxpak_members_free(lpxpak_t *handle)
+{
+     size_t i;
+
+     /* check if the xpak has an entry array, borrowed names belong to the
+      * blob of the caller */
+     if ( handle->size > 0 ) {
+          for ( i=0; ! handle->borrowed && i < handle->size; ++i )
+               lpxpak_release(handle, handle->entries[i].name);
+          lpxpak_release(handle, handle->entries);
      }
+     lpxpak_release(handle, handle->data);
+     lpxpak_release(handle, handle->lookup);
+     lpxpak_blob_destroy(handle->blob);
 
-     return datablob;
+     return;
 }
 
-static lpxpak_blob_t *
-lpxpak_indexblob_compile(lpxpak_t *xpak)
+static int
+lpxpak_own(lpxpak_t *handle, const lpxpak_blob_t *blob)
 {
+     lpxpak_t copy;
+
+     lpxpak_init_arena(&copy, handle->arena);
+     if ( lpxpak_parse_blob(&copy, blob, true, true) == -1 )
+          return -1;
+     lpxpak_members_free(handle);
+     *handle = copy;
+
+     return 0;
+}
+
+static uint64_t
+lpxpak_journal_sum(const uint8_t *head, const void *old, size_t len)
+{
+     uint64_t h = 14695981039346656037ULL;
      size_t i;
-     size_t count = 0;
-     lpxpak_int_t indexslen;
-     lpxpak_int_t offset = 0;
-     lpxpak_int_t bil, bol, bsl;
-     size_t index_len = 0;
-     lpxpak_blob_t *index;
-
-     for ( i=0; i < xpak->size; ++i ) {
-          index_len += strlen(xpak->entries[i].name);
-          index_len += LPXPAK_INT_SIZE*3;
+
+     for ( i=0; i < LPXPAK_JOURNAL_HEAD_LEN; ++i ) {
+          h ^= head[i];
+          h *= 1099511628211ULL;
+     }
+     for ( i=0; i < len; ++i ) {
+          h ^= ((const uint8_t *)old)[i];
+          h *= 1099511628211ULL;
      }
 
-     if ( (index = lpxpak_blob_create()) == NULL )
-          return NULL;
-     lpxpak_blob_init(index);
-     if ( (index->data = malloc(index_len)) == NULL ) {
-          lpxpak_blob_destroy(index);
-          return NULL;
+     return h;
+}
+
+extern int
+lpxpak_update_fd(lpxpak_t *handle, int fd, int journal)
+{
+     struct stat st;
+     struct iovec iov[3];
+     lpxpak_blob_t *blob = NULL;
+     uint8_t head[LPXPAK_JOURNAL_HEAD_LEN];
+     uint8_t sum[LPXPAK_JOURNAL_SUM_LEN];
+     uint8_t trailer[LPXPAK_OFFSET_LEN];
+     void *old = NULL;
+     size_t xpaklen, oldlen;
+     off_t start;
+
+     if ( fstat(fd, &st) == -1 )
+          return -1;
+     if ( lpxpak_trailer_read(fd, st.st_size, &xpaklen) == -1 )
+          return -1;
+     start = st.st_size-LPXPAK_OFFSET_LEN-(off_t)xpaklen;
+     oldlen = xpaklen+LPXPAK_OFFSET_LEN;
+
+     /* compile the new xpak before the file is touched and move the handle
+      * out of a mapping that may belong to this file, it would raise SIGBUS
+      * once the file is truncated */
+     if ( (blob = lpxpak_blob_compile(handle)) == NULL )
+          return -1;
+     if ( (handle->blob != NULL || handle->borrowed) &&
+          lpxpak_own(handle, blob) == -1 )
+          goto lpxpak_update_fd_bailout;
+
+     /* save the old xpak and its trailer with a checksum, the file is only
+      * changed once the journal is on the disk */
+     if ( journal != -1 ) {
+          if ( (old = malloc(oldlen)) == NULL )
+               goto lpxpak_update_fd_bailout;
+          if ( lpxpak_pread_all(fd, old, oldlen, start) == -1 )
+               goto lpxpak_update_fd_bailout;
+          memcpy(head, LPXPAK_JOURNAL_MAGIC, LPXPAK_JOURNAL_MAGIC_LEN);
+          lpxpak_u64_write(head+LPXPAK_JOURNAL_MAGIC_LEN, (uint64_t)start);
+          lpxpak_u64_write(head+LPXPAK_JOURNAL_MAGIC_LEN+8, (uint64_t)oldlen);
+          iov[0].iov_base = head;
+          iov[0].iov_len = LPXPAK_JOURNAL_HEAD_LEN;
+          iov[1].iov_base = old;
+          iov[1].iov_len = oldlen;
+          lpxpak_u64_write(sum, lpxpak_journal_sum(head, old, oldlen));
+          iov[2].iov_base = sum;
+          iov[2].iov_len = LPXPAK_JOURNAL_SUM_LEN;
+          if ( lpxpak_writev_all(journal, iov, 3) == -1 ||
+               fsync(journal) == -1 )
+               goto lpxpak_update_fd_bailout;
      }
-     index->len = index_len;
 
-     for ( i=0; i < xpak->size; ++i ) {
-          indexslen = (lpxpak_int_t)strlen(xpak->entries[i].name);
-          bil = htonl(indexslen);
-          memcpy((uint8_t *)index->data+count, &bil, LPXPAK_INT_SIZE);
-          count += LPXPAK_INT_SIZE;
-          memcpy((uint8_t *)index->data+count, xpak->entries[i].name,
-             indexslen);
-          count += indexslen;
-          bsl = htonl(offset);
-          memcpy((uint8_t *)index->data+count, &bsl, LPXPAK_INT_SIZE);
-          count += LPXPAK_INT_SIZE;
-          bol = htonl(xpak->entries[i].value_len);
-          memcpy((uint8_t *)index->data+count, &bol, LPXPAK_INT_SIZE);
-          offset += xpak->entries[i].value_len;
-          count += LPXPAK_INT_SIZE;
+     /* replace everything behind the tarball and cut off what is left of a
+      * longer old xpak */
+     lpxpak_int_write(trailer, (lpxpak_int_t)blob->len);
+     memcpy(trailer+LPXPAK_INT_SIZE, LPXPAK_STOP, LPXPAK_STOP_LEN);
+     iov[0].iov_base = blob->data;
+     iov[0].iov_len = blob->len;
+     iov[1].iov_base = trailer;
+     iov[1].iov_len = LPXPAK_OFFSET_LEN;
+     if ( lseek(fd, start, SEEK_SET) == -1 ||
+          lpxpak_writev_all(fd, iov, 2) == -1 )
+          goto lpxpak_update_fd_bailout;
+     if ( ftruncate(fd, start+(off_t)blob->len+LPXPAK_OFFSET_LEN) == -1 ||
+          fsync(fd) == -1 )
+          goto lpxpak_update_fd_bailout;
+
+     /* the update is on the disk, empty the journal so that it does not undo
+      * a finished update */
+     if ( journal != -1 &&
+          (ftruncate(journal, 0) == -1 || fsync(journal) == -1) )
+          goto lpxpak_update_fd_bailout;
+
+     free(old);
+     lpxpak_blob_destroy(blob);
+     return 0;
+
+lpxpak_update_fd_bailout:
+     free(old);
+     lpxpak_blob_destroy(blob);
+     return -1;
+}
+
+extern int
+lpxpak_recover_fd(int fd, int journal)
+{
+     struct stat st;
+     struct iovec iov;
+     uint8_t head[LPXPAK_JOURNAL_HEAD_LEN];
+     uint8_t *old = NULL;
+     uint64_t start, len;
+     size_t oldlen;
+
+     /* a journal that was not completely written was never synced, so the
+      * package was not touched yet, and an empty one belongs to a finished
+      * update */
+     if ( fstat(journal, &st) == -1 )
+          return -1;
+     if ( st.st_size < LPXPAK_JOURNAL_HEAD_LEN+LPXPAK_JOURNAL_SUM_LEN )
+          return 0;
+     if ( lpxpak_pread_all(journal, head, LPXPAK_JOURNAL_HEAD_LEN, 0) == -1 )
+          return -1;
+     if ( memcmp(head, LPXPAK_JOURNAL_MAGIC, LPXPAK_JOURNAL_MAGIC_LEN) != 0 )
+          return 0;
+     start = lpxpak_u64_read(head+LPXPAK_JOURNAL_MAGIC_LEN);
+     len = lpxpak_u64_read(head+LPXPAK_JOURNAL_MAGIC_LEN+8);
+     if ( (uint64_t)st.st_size-LPXPAK_JOURNAL_HEAD_LEN-LPXPAK_JOURNAL_SUM_LEN
+          != len )
+          return 0;
+     oldlen = (size_t)len;
+
+     /* a journal of the right size may still hold blocks that never reached
+      * the disk, only put the old xpak back if the checksum matches */
+     if ( (old = malloc(oldlen+LPXPAK_JOURNAL_SUM_LEN)) == NULL )
+          return -1;
+     if ( lpxpak_pread_all(journal, old, oldlen+LPXPAK_JOURNAL_SUM_LEN,
+                           LPXPAK_JOURNAL_HEAD_LEN) == -1 )
+          goto lpxpak_recover_fd_bailout;
+     if ( lpxpak_u64_read(old+oldlen) !=
+          lpxpak_journal_sum(head, old, oldlen) ) {
+          free(old);
+          return 0;
+     }
+     iov.iov_base = old;
+     iov.iov_len = oldlen;
+     if ( lseek(fd, (off_t)start, SEEK_SET) == -1 ||
+          lpxpak_writev_all(fd, &iov, 1) == -1 ||
+          ftruncate(fd, (off_t)start+(off_t)oldlen) == -1 ||
+          fsync(fd) == -1 )
+          goto lpxpak_recover_fd_bailout;
+
+     free(old);
+     return 1;
+
+lpxpak_recover_fd_bailout:
+     free(old);
+     return -1;
+}
+
+extern int
+lpxpak_update_path(lpxpak_t *handle, const char *path)
+{
+     struct stat st, pst;
+     char *tpath = NULL;
+     size_t xpaklen;
+     off_t start;
+     int fd, tfd = -1;
+     int saved;
+
+     /* lock the package against other updates, if it was replaced while
+      * waiting for the lock, lock the new one */
+     for ( ;; ) {
+          if ( (fd = open(path, O_RDWR)) == -1 )
+               return -1;
+          if ( lpxpak_lock(fd) == -1 || fstat(fd, &st) == -1 ||
+               stat(path, &pst) == -1 )
+               goto lpxpak_update_path_bailout;
+          if ( st.st_dev == pst.st_dev && st.st_ino == pst.st_ino )
+               break;
+          (void)close(fd);
      }
-     index->len = count;
-     return index;
+     if ( lpxpak_trailer_read(fd, st.st_size, &xpaklen) == -1 )
+          goto lpxpak_update_path_bailout;
+     start = st.st_size-LPXPAK_OFFSET_LEN-(off_t)xpaklen;
+
+     /* write the tarball and the new xpak to a new file and move it over the
+      * package, mappings of the old file stay valid */
+     if ( (tpath = lpxpak_temp_path(path)) == NULL ||
+          (tfd = mkstemp(tpath)) == -1 )
+          goto lpxpak_update_path_bailout;
+     if ( lpxpak_copy_fd(fd, tfd, start) == -1 ||
+          lpxpak_write_fd(handle, tfd, 1) == -1 ||
+          fchmod(tfd, st.st_mode & 07777) == -1 ||
+          fsync(tfd) == -1 )
+          goto lpxpak_update_path_unlink;
+     if ( close(tfd) == -1 ) {
+          tfd = -1;
+          goto lpxpak_update_path_unlink;
+     }
+     tfd = -1;
+     if ( rename(tpath, path) == -1 )
+          goto lpxpak_update_path_unlink;
+     /* the package is replaced now, failing here would make the caller act
+      * on an update that did happen, so syncing the directory is only a best
+      * effort */
+     (void)lpxpak_sync_dir(path);
+
+     free(tpath);
+     (void)close(fd);
+     return 0;
+
+lpxpak_update_path_unlink:
+     saved = errno;
+     (void)unlink(tpath);
+     errno = saved;
+lpxpak_update_path_bailout:
+     saved = errno;
+     if ( tfd != -1 )
+          (void)close(tfd);
+     free(tpath);
+     (void)close(fd);
+     errno = saved;
+     return -1;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2008-2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file lpmem.h
+ * @brief Routes the allocations of a source file through lputil_mem_*().
+ *
+ * Define @c LPMEM_SUBSYS to the lputil_mem_subsys_t of the file and include
+ * this header after all system headers. Every call of malloc(), calloc(),
+ * realloc(), free() and strdup() in the rest of the file then goes to the
+ * hooks set with lputil_mem_set_hooks() and is counted for that part of the
+ * library.
+ */
+#ifndef LPMEM_H
+/** @cond */
+#define LPMEM_H 1
+/** @endcond */
+
+#  include <util.h>
+
+#  ifndef LPMEM_SUBSYS
+#    error "LPMEM_SUBSYS has to be defined before lpmem.h is included"
+#  endif
+
+/** @cond */
+#  undef malloc
+#  undef calloc
+#  undef realloc
+#  undef free
+#  undef strdup
+#  define malloc(len)           lputil_mem_malloc(LPMEM_SUBSYS, len)
+#  define calloc(n, size)       lputil_mem_calloc(LPMEM_SUBSYS, n, size)
+#  define realloc(p, len)       lputil_mem_realloc(LPMEM_SUBSYS, p, len)
+#  define free(p)               lputil_mem_free(LPMEM_SUBSYS, p)
+#  define strdup(s)             lputil_mem_strdup(LPMEM_SUBSYS, s)
+/** @endcond */
+
+#endif /* LPMEM_H */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+
+/* characters right next to the digits and outside of ASCII */
+static const char stops[] = { '/', ':', '.', '\x80', '\xb0', '\0' };
+
+int main(void)
+{
+     char s[128];
+     bool has_failed = false;
+     size_t len, k, i;
+     uint64_t v, w;
+
+     /* every run length at every string length, to hit the vector loops and
+      * the scalar tail alike */
+     for ( len=0; len < 100; ++len ) {
+          for ( k=0; k <= len; ++k ) {
+               memset(s, 'x', sizeof(s));
+               for ( i=0; i < k; ++i )
+                    s[i] = (char)('0'+i%10);
+               if ( k < len )
+                    s[k] = stops[(len+k)%sizeof(stops)];
+               /* digits behind the end must not be counted */
+               else
+                    s[k] = '7';
+               if ( lputil_digitspan(s, len) != k ) {
+                    printf("digitspan: len %zu, run %zu\n", len, k);
+                    has_failed = true;
+               }
+          }
+     }
+
+     /* conversion, with and without leading zeros */
+     for ( i=0, v=1; i < 64; ++i, v = v*3+i ) {
+          len = (size_t)sprintf(s, "%0*" PRIu64, (int)(i%30), v);
+          if ( lputil_digits_u64(s, len, UINT64_MAX, &w) == -1 || w != v ) {
+               printf("digits_u64: %s\n", s);
+               has_failed = true;
+          }
+     }
+     if ( lputil_digits_u64("18446744073709551615", 20, UINT64_MAX, &w)
+          == -1 || w != UINT64_MAX )
+          has_failed = true;
+     if ( lputil_digits_u64("18446744073709551616", 20, UINT64_MAX, &w)
+          != -1 || errno != ERANGE )
+          has_failed = true;
+     if ( lputil_digits_u64("00000000004294967296", 20, UINT_MAX, &w)
+          != -1 || errno != ERANGE )
+          has_failed = true;
+     if ( lputil_digits_u64("0000000004294967295", 19, UINT_MAX, &w)
+          == -1 || w != UINT_MAX )
+          has_failed = true;
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
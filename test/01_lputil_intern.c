@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define WORDS           5000
+#define THREADS         4
+
+static lputil_symtab_t *tab;
+static uint32_t ids[THREADS][WORDS];
+
+/* every thread interns all words, starting at a different offset */
+static void *
+intern_words(void *arg)
+{
+     size_t t = (size_t)arg, i, w;
+     char s[32];
+
+     for ( i=0; i < WORDS; ++i ) {
+          w = (i+t*WORDS/THREADS) % WORDS;
+          snprintf(s, sizeof(s), "dev-libs/pkg%zu", w);
+          ids[t][w] = lputil_symtab_intern(tab, s, strlen(s), NULL);
+     }
+     return NULL;
+}
+
+int main(void)
+{
+     pthread_t threads[THREADS];
+     bool has_failed = false;
+     const char *str, *str2;
+     char s[32];
+     size_t t, i;
+     uint32_t id;
+
+     if ( (tab = lputil_symtab_create()) == NULL )
+          return EXIT_FAILURE;
+
+     for ( t=0; t < THREADS; ++t )
+          if ( pthread_create(&threads[t], NULL, intern_words, (void *)t)
+               != 0 )
+               return EXIT_FAILURE;
+     for ( t=0; t < THREADS; ++t )
+          pthread_join(threads[t], NULL);
+
+     /* all threads must have got the same ID for the same string */
+     for ( i=0; i < WORDS; ++i ) {
+          snprintf(s, sizeof(s), "dev-libs/pkg%zu", i);
+          for ( t=0; t < THREADS; ++t )
+               if ( ids[t][i] == 0 || ids[t][i] != ids[0][i] )
+                    has_failed = true;
+          if ( (str = lputil_symtab_str(tab, ids[0][i])) == NULL ||
+               strcmp(str, s) != 0 ||
+               lputil_symtab_lookup(tab, s, strlen(s)) != ids[0][i] ) {
+               printf("wrong string for %s\n", s);
+               has_failed = true;
+          }
+     }
+     if ( lputil_symtab_lookup(tab, "dev-libs/none", 13) != 0 ||
+          lputil_symtab_str(tab, WORDS+1) != NULL )
+          has_failed = true;
+     lputil_symtab_destroy(tab);
+
+     /* the process wide table hands out the same copy for equal strings */
+     if ( (id = lputil_intern("dev-lang/python", 15, &str)) == 0 ||
+          lputil_intern("dev-lang/python-extra", 15, &str2) != id ||
+          str != str2 || lputil_intern_str(id) != str ||
+          lputil_intern_lookup("dev-lang/python", 15) != id )
+          has_failed = true;
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
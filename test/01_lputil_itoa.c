@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define MAXLEN          64
+
+/* compares the formatting of a number with sprintf(3) */
+static bool
+check(int64_t v, bool sign)
+{
+     char s[MAXLEN], t[MAXLEN];
+     size_t len;
+
+     if ( sign ) {
+          sprintf(s, "%"PRIi64, v);
+          len = lputil_i64toa(t, v);
+          if ( lputil_int64len(v) != strlen(s) )
+               return false;
+     } else {
+          sprintf(s, "%"PRIu64, (uint64_t)v);
+          len = lputil_u64toa(t, (uint64_t)v);
+          if ( lputil_u64len((uint64_t)v) != strlen(s) )
+               return false;
+     }
+     return len == strlen(s) && memcmp(s, t, len) == 0;
+}
+
+int main(void)
+{
+     bool has_failed = false;
+     uint64_t p;
+     int64_t i;
+
+     for ( i=-1000; i <= 1000; ++i )
+          if ( ! check(i, true) || ! check(i, false) )
+               has_failed = true;
+     /* the numbers around every power of ten */
+     for ( p=10; p <= UINT64_MAX/10; p *= 10 )
+          for ( i=-1; i <= 1; ++i )
+               if ( ! check((int64_t)(p+(uint64_t)i), true) ||
+                    ! check((int64_t)(p+(uint64_t)i), false) ||
+                    ! check(-(int64_t)(p+(uint64_t)i), true) )
+                    has_failed = true;
+     if ( ! check(INT64_MIN, true) || ! check(INT64_MAX, true) ||
+          ! check((int64_t)UINT64_MAX, false) ||
+          ! check((int64_t)(UINT64_MAX-1), false) )
+          has_failed = true;
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+#include <atom.h>
+#include <version.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+static size_t hook_calls = 0;
+
+static void *
+test_alloc(size_t len)
+{
+     ++hook_calls;
+     return malloc(len);
+}
+
+static void *
+test_resize(void *p, size_t len)
+{
+     ++hook_calls;
+     return realloc(p, len);
+}
+
+static void
+test_release(void *p)
+{
+     ++hook_calls;
+     free(p);
+}
+
+int main(void)
+{
+     lputil_memhooks_t hooks = { test_alloc, test_resize, test_release };
+     lputil_memstat_t st[LPUTIL_MEM_MAX], now;
+     lpatom_t *atom;
+     lpversion_t *version;
+     bool has_failed = false;
+     char *s;
+     int i;
+
+     lputil_mem_set_hooks(&hooks);
+
+     /* nothing is counted before counting is turned on */
+     if ( (s = lputil_mem_strdup(LPUTIL_MEM_UTIL, "foo")) == NULL )
+          return EXIT_FAILURE;
+     lputil_mem_free(LPUTIL_MEM_UTIL, s);
+     if ( hook_calls != 2 )
+          has_failed = true;
+     if ( lputil_mem_stat(LPUTIL_MEM_UTIL, &now) == -1 || now.allocs != 0 ||
+          now.frees != 0 )
+          has_failed = true;
+
+     /* the process wide symbol table lives until the end, create it first */
+     if ( (atom = lpatom_create()) == NULL )
+          return EXIT_FAILURE;
+     lpatom_init(atom);
+     if ( lpatom_parse(atom, "dev-lang/perl") == -1 )
+          has_failed = true;
+     lpatom_destroy(atom);
+
+     lputil_mem_set_counting(1);
+     for ( i=0; i < 1000; ++i ) {
+          if ( (atom = i % 2 ? lpatom_create() : lpatom_create_alloc(NULL))
+               == NULL ||
+               (version = i % 2 ? lpversion_create() :
+                lpversion_create_alloc(NULL)) == NULL )
+               return EXIT_FAILURE;
+          lpatom_init(atom);
+          lpversion_init(version);
+          if ( lpatom_parse(atom, ">=dev-lang/perl-5.10.1-r1:0[ithreads]")
+               == -1 || lpversion_parse(version, "1.2.3_alpha4-r6") == -1 )
+               has_failed = true;
+          if ( i % 2 ) {
+               lpatom_destroy(atom);
+               lpversion_destroy(version);
+          } else {
+               lpatom_destroy_alloc(atom, NULL);
+               lpversion_destroy_alloc(version, NULL);
+          }
+     }
+
+     for ( i=0; i < LPUTIL_MEM_MAX; ++i )
+          if ( lputil_mem_stat(i, &st[i]) == -1 )
+               has_failed = true;
+     if ( st[LPUTIL_MEM_ATOM].allocs == 0 ||
+          st[LPUTIL_MEM_VERSION].allocs == 0 )
+          has_failed = true;
+     if ( st[LPUTIL_MEM_XPAK].allocs != 0 ||
+          st[LPUTIL_MEM_ARCHIVE].allocs != 0 )
+          has_failed = true;
+     for ( i=0; i < LPUTIL_MEM_MAX; ++i )
+          if ( st[i].allocs != 0 && st[i].bytes == 0 )
+               has_failed = true;
+     /* everything was freed again by the part that allocated it */
+     for ( i=0; i < LPUTIL_MEM_MAX; ++i )
+          if ( st[i].allocs != st[i].frees )
+               has_failed = true;
+     if ( hook_calls < 2 + st[LPUTIL_MEM_ATOM].allocs )
+          has_failed = true;
+
+     lputil_mem_stat_reset();
+     if ( lputil_mem_stat(LPUTIL_MEM_ATOM, &now) == -1 || now.allocs != 0 ||
+          now.bytes != 0 )
+          has_failed = true;
+
+     errno = 0;
+     if ( lputil_mem_stat(LPUTIL_MEM_MAX, &now) != -1 || errno != EINVAL )
+          has_failed = true;
+
+     lputil_mem_set_counting(0);
+     lputil_mem_set_hooks(NULL);
+     if ( (s = lputil_mem_strdup(LPUTIL_MEM_UTIL, "bar")) == NULL )
+          return EXIT_FAILURE;
+     i = (int)hook_calls;
+     lputil_mem_free(LPUTIL_MEM_UTIL, s);
+     if ( hook_calls != (size_t)i )
+          has_failed = true;
+
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+#include <atom.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#define NOBJ 10000
+
+int main(void)
+{
+     lputil_pool_t *pool;
+     lputil_arena_t *arena;
+     lputil_alloc_t alloc;
+     lpatom_t *atom, *again;
+     void **objs, *p;
+     bool has_failed = false;
+     size_t i;
+
+     if ( (pool = lputil_pool_create(24)) == NULL ||
+          (objs = malloc(NOBJ*sizeof(void *))) == NULL )
+          return EXIT_FAILURE;
+
+     /* objects must not overlap and be aligned */
+     for ( i=0; i < NOBJ; ++i ) {
+          if ( (objs[i] = lputil_pool_alloc(pool)) == NULL )
+               return EXIT_FAILURE;
+          if ( (uintptr_t)objs[i] % sizeof(void *) != 0 )
+               has_failed = true;
+          memset(objs[i], (int)(i & 0xff), 24);
+     }
+     for ( i=0; i < NOBJ; ++i )
+          if ( ((unsigned char *)objs[i])[23] != (i & 0xff) )
+               has_failed = true;
+
+     /* freed objects are handed out again */
+     p = objs[42];
+     lputil_pool_free(pool, p);
+     if ( lputil_pool_alloc(pool) != p )
+          has_failed = true;
+     lputil_pool_reset(pool);
+
+     lputil_alloc_init_pool(&alloc, pool);
+     errno = 0;
+     if ( lputil_alloc(&alloc, 25) != NULL || errno != ENOMEM )
+          has_failed = true;
+     lputil_pool_destroy(pool);
+
+     /* handles can come from a pool and are reused after destroying them */
+     if ( (pool = lputil_pool_create(sizeof(lpatom_t))) == NULL )
+          return EXIT_FAILURE;
+     lputil_alloc_init_pool(&alloc, pool);
+     if ( (atom = lpatom_create_alloc(&alloc)) == NULL )
+          return EXIT_FAILURE;
+     lpatom_init(atom);
+     if ( lpatom_parse(atom, ">=cat/foo-1.0:2[bar]") == -1 )
+          has_failed = true;
+     lpatom_destroy_alloc(atom, &alloc);
+     if ( (again = lpatom_create_alloc(&alloc)) != atom )
+          has_failed = true;
+     lpatom_init(again);
+     lpatom_destroy_alloc(again, &alloc);
+     lputil_pool_destroy(pool);
+
+     /* or from an arena, together with all their members */
+     if ( (arena = lputil_arena_create(0)) == NULL )
+          return EXIT_FAILURE;
+     lputil_alloc_init_arena(&alloc, arena);
+     for ( i=0; i < 100; ++i ) {
+          if ( (atom = lpatom_create_alloc(&alloc)) == NULL )
+               return EXIT_FAILURE;
+          lpatom_init_arena(atom, arena);
+          if ( lpatom_parse(atom, "=cat/foo-1.0-r1::repo") == -1 )
+               has_failed = true;
+     }
+     lputil_arena_destroy(arena);
+
+     if ( (atom = lpatom_create_alloc(NULL)) == NULL )
+          return EXIT_FAILURE;
+     lpatom_init(atom);
+     lpatom_destroy_alloc(atom, NULL);
+
+     free(objs);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
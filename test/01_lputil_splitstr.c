@@ -43,6 +43,8 @@ int main(void)
      int len, i;
      char *srcpath, s[MAXLEN], delim[MAXLEN], entry[MAXLEN], t[MAXLEN], *join;
      char **split;
+     lputil_span_t spans[MAXLEN];
+     size_t n;
 
      if ( (srcpath = getenv("srcdir")) != NULL )
           if ( chdir(srcpath) == -1 )
@@ -80,6 +82,15 @@ int main(void)
                if ( strcmp(s, join) != 0 )
                     has_failed = true;
                free(join);
+               /* the spans must point at the same tokens */
+               n = lputil_splitstr_span(s, strlen(s), delim, NULL, 0);
+               if ( n != (size_t)len ||
+                    lputil_splitstr_span(s, strlen(s), delim, spans,
+                                         MAXLEN) != n )
+                    has_failed = true;
+               for ( i=0; i < len && ! has_failed; ++i )
+                    if ( ! lputil_span_eq(spans[i], split[i]) )
+                         has_failed = true;
                lputil_splitstr_destroy(split);
           }
      }
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <util.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+int main(void)
+{
+     lputil_strbuf_t sb;
+     bool has_failed = false;
+     char expect[4096], num[32], *s;
+     const char *empty[] = { NULL }, *one[] = { "foo", NULL };
+     size_t len = 0, i;
+     uint64_t v;
+
+     /* grow from the inline storage over several reallocations */
+     lputil_strbuf_init(&sb);
+     for ( i=0, v=1; i < 200; ++i, v = v*7+i ) {
+          snprintf(num, sizeof(num), "%llu,", (unsigned long long)v);
+          memcpy(expect+len, num, strlen(num));
+          len += strlen(num);
+          if ( lputil_strbuf_append_u64(&sb, v) == -1 ||
+               lputil_strbuf_append(&sb, ",", 1) == -1 )
+               return EXIT_FAILURE;
+          expect[len] = '\0';
+          if ( lputil_strbuf_len(&sb) != len ||
+               strcmp(lputil_strbuf_str(&sb), expect) != 0 )
+               has_failed = true;
+          if ( len >= sizeof(expect)-64 )
+               break;
+     }
+     lputil_strbuf_reset(&sb);
+     if ( lputil_strbuf_len(&sb) != 0 || *lputil_strbuf_str(&sb) != '\0' )
+          has_failed = true;
+
+     if ( lputil_strbuf_append_u64(&sb, 0) == -1 ||
+          lputil_strbuf_append_u64(&sb, UINT64_MAX) == -1 ||
+          (s = lputil_strbuf_extend(&sb, 3)) == NULL )
+          return EXIT_FAILURE;
+     memcpy(s, "end", 3);
+
+     /* lengths that would wrap around are rejected, the string stays */
+     errno = 0;
+     if ( lputil_strbuf_extend(&sb, SIZE_MAX) != NULL || errno != ENOMEM )
+          has_failed = true;
+     errno = 0;
+     if ( lputil_strbuf_append(&sb, "x", SIZE_MAX-lputil_strbuf_len(&sb))
+          != -1 || errno != ENOMEM )
+          has_failed = true;
+     errno = 0;
+     if ( lputil_strbuf_reserve(&sb, SIZE_MAX-1) != -1 || errno != ENOMEM )
+          has_failed = true;
+     if ( strcmp(lputil_strbuf_str(&sb), "018446744073709551615end") != 0 )
+          has_failed = true;
+
+     if ( (s = lputil_strbuf_detach(&sb)) == NULL )
+          return EXIT_FAILURE;
+     if ( strcmp(s, "018446744073709551615end") != 0 ||
+          lputil_strbuf_len(&sb) != 0 )
+          has_failed = true;
+     free(s);
+
+     /* joining no tokens gives an empty string */
+     if ( (s = lputil_joinstr(empty, ";")) == NULL || *s != '\0' )
+          has_failed = true;
+     free(s);
+     if ( (s = lputil_joinstr(one, ";")) == NULL || strcmp(s, "foo") != 0 )
+          has_failed = true;
+     free(s);
+
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#define MAXLEN 1024
+#define MAXVERSIONS 64
+
+static const char *files[] = {
+     "02_lpversion_parse.txt", "02_lpversion_key.txt"
+};
+
+/* other spellings of versions, they must get the same handle */
+static const char *spellings[][2] = {
+     { "1.0-r0", "1.0" },
+     { "1.00", "1.0" },
+     { "1.0_rc0", "1.0_rc" },
+     { "01.2", "1.2" }
+};
+
+int
+main(void)
+{
+     const lpversion_t *v[MAXVERSIONS];
+     char *srcpath, s[MAXLEN];
+     FILE *file;
+     bool has_failed = false;
+     size_t n = 0, i, j;
+     
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     for ( i=0; i < sizeof(files)/sizeof(files[0]); ++i ) {
+          if ( (file = fopen(files[i], "r")) == NULL )
+               return EXIT_FAILURE;
+          while ( n < MAXVERSIONS && fgets(s, MAXLEN, file) != NULL ) {
+               s[strlen(s)-1] = '\0';
+               if ( (v[n] = lpversion_intern(s, strlen(s))) == NULL ||
+                    lpversion_intern(s, strlen(s)) != v[n] )
+                    has_failed = true;
+               else
+                    ++n;
+          }
+          fclose(file);
+     }
+     if ( has_failed )
+          return EXIT_FAILURE;
+
+     /* handles are equal if and only if the versions are */
+     for ( i=0; i < n; ++i )
+          for ( j=0; j < n; ++j )
+               if ( (v[i] == v[j]) != (lpversion_cmp(v[i], v[j]) == 0) ) {
+                    printf("%zu and %zu differ\n", i, j);
+                    has_failed = true;
+               }
+
+     for ( i=0; i < sizeof(spellings)/sizeof(spellings[0]); ++i )
+          if ( lpversion_intern(spellings[i][0], strlen(spellings[i][0])) !=
+               lpversion_intern(spellings[i][1], strlen(spellings[i][1])) ) {
+               printf("not shared: %s\n", spellings[i][0]);
+               has_failed = true;
+          }
+
+     /* the length must be honoured */
+     if ( lpversion_intern("1.0-r1", 3) != lpversion_intern("1.0", 3) )
+          has_failed = true;
+
+     if ( lpversion_intern("1.0-", 4) != NULL || errno != EINVAL )
+          has_failed = true;
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+     
+     return 0;
+}
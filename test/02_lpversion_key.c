@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define MAXLEN 1024
+#define MAXVERSIONS 64
+
+int
+main(void)
+{
+     lpversion_t *v[MAXVERSIONS];
+     unsigned char key[MAXVERSIONS][MAXLEN];
+     size_t keylen[MAXVERSIONS], len;
+     char *srcpath, s[MAXLEN];
+     FILE *file;
+     bool has_failed = false;
+     int i, j, n, c;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (file = fopen("02_lpversion_key.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+
+     /* the input file lists the versions in ascending order */
+     for ( n=0; n < MAXVERSIONS && fgets(s, MAXLEN, file) != NULL; ++n ) {
+          s[strlen(s)-1] = '\0';
+          if ( (v[n] = lpversion_create()) == NULL )
+               return EXIT_FAILURE;
+          lpversion_init(v[n]);
+          if ( lpversion_parse(v[n], s) == -1 )
+               return EXIT_FAILURE;
+          /* a too small buffer must report the same length */
+          len = lpversion_key(v[n], NULL, 0);
+          keylen[n] = lpversion_key(v[n], key[n], MAXLEN);
+          if ( len != keylen[n] || len > MAXLEN )
+               return EXIT_FAILURE;
+     }
+     fclose(file);
+
+     for ( i=0; i < n; ++i ) {
+          for ( j=0; j < n; ++j ) {
+               len = keylen[i] < keylen[j] ? keylen[i] : keylen[j];
+               c = memcmp(key[i], key[j], len);
+               if ( c == 0 && keylen[i] != keylen[j] )
+                    has_failed = true;
+               if ( (c < 0) != (i < j) || (c > 0) != (i > j) )
+                    has_failed = true;
+               c = lpversion_cmp(v[i], v[j]);
+               if ( (c < 0) != (i < j) || (c > 0) != (i > j) )
+                    has_failed = true;
+          }
+     }
+     for ( i=0; i < n; ++i )
+          lpversion_destroy(v[i]);
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define MAXLEN 1024
+#define MAXVERSIONS 64
+#define NSORT 20000
+
+int
+main(void)
+{
+     lpversion_t v[MAXVERSIONS];
+     const lpversion_t **a;
+     char *srcpath, s[MAXLEN];
+     FILE *file;
+     bool has_failed = false;
+     unsigned int seed = 1;
+     size_t i, n;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (file = fopen("02_lpversion_key.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+
+     /* the input file lists the versions in ascending order */
+     for ( n=0; n < MAXVERSIONS && fgets(s, MAXLEN, file) != NULL; ++n ) {
+          s[strlen(s)-1] = '\0';
+          lpversion_init(&v[n]);
+          if ( lpversion_parse(&v[n], s) == -1 )
+               return EXIT_FAILURE;
+     }
+     fclose(file);
+
+     /* enough duplicates in random order to be split over threads */
+     if ( (a = malloc(NSORT*sizeof(*a))) == NULL )
+          return EXIT_FAILURE;
+     for ( i=0; i < NSORT; ++i ) {
+          seed = seed*1103515245+12345;
+          a[i] = &v[(seed >> 16)%n];
+     }
+     if ( lpversion_sort(a, NSORT, 4) == -1 )
+          return EXIT_FAILURE;
+     for ( i=1; i < NSORT; ++i )
+          if ( a[i-1] > a[i] )
+               has_failed = true;
+
+     /* the sorted input must stay as it is */
+     for ( i=0; i < n; ++i )
+          a[i] = &v[i];
+     if ( lpversion_sort(a, n, 0) == -1 )
+          return EXIT_FAILURE;
+     for ( i=0; i < n; ++i )
+          if ( a[i] != &v[i] )
+               has_failed = true;
+
+     free(a);
+     for ( i=0; i < n; ++i )
+          lpversion_reset(&v[i]);
+
+     if ( has_failed )
+          return EXIT_FAILURE;
+
+     return EXIT_SUCCESS;
+}
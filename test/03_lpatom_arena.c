@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atom.h>
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define ATOMS_MAX       256
+
+int main(void)
+{
+     lputil_arena_t *arena;
+     lpatom_t *atoms[ATOMS_MAX];
+     char s[1024], *lines[ATOMS_MAX], *srcpath, *sa;
+     bool has_failed = false;
+     size_t n = 0, i;
+     FILE *file;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (file = fopen("03_lpatom_parse.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+
+     /* small chunks, so that the arena has to grow several times */
+     if ( (arena = lputil_arena_create(256)) == NULL )
+          return EXIT_FAILURE;
+
+     /* keep all atoms alive until the end, nothing is freed on its own */
+     while ( n < ATOMS_MAX && fgets(s, sizeof(s), file) != NULL) {
+          s[strlen(s)-1] = '\0';
+          if ( (lines[n] = lputil_arena_strndup(arena, s, strlen(s))) == NULL ||
+               (atoms[n] = lputil_arena_alloc(arena, sizeof(lpatom_t)))
+               == NULL )
+               return EXIT_FAILURE;
+          lpatom_init_arena(atoms[n], arena);
+          if ( lpatom_parse(atoms[n], s) == -1 ) {
+               printf("failed to parse: %s\n", s);
+               has_failed = true;
+               lpatom_reset(atoms[n]);
+          }
+          ++n;
+     }
+     fclose(file);
+
+     for ( i=0; i < n; ++i ) {
+          if ( atoms[i]->name == NULL )
+               continue;
+          if ( (sa = lpatom_compile(atoms[i])) == NULL )
+               has_failed = true;
+          else if ( strcmp(sa, lines[i]) != 0 ) {
+               printf("input: %s <> sa: %s\n", lines[i], sa);
+               has_failed = true;
+          }
+          free(sa);
+     }
+     lputil_arena_destroy(arena);
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
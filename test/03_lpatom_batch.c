@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atom.h>
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define LINES_MAX       256
+#define REPEAT          100
+
+int main(void)
+{
+     lpatom_batch_t *batch;
+     lpatom_batch_entry_t *e;
+     char s[1024], *lines[LINES_MAX], *buf, *p, *sa;
+     size_t n = 0, i, j, k, line = 0, size;
+     size_t *expline;
+     char **expstr;
+     bool has_failed = false;
+     FILE *file;
+
+     if ( (p = getenv("srcdir")) != NULL )
+          if ( chdir(p) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (file = fopen("03_lpatom_parse.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+     while ( n < LINES_MAX && fgets(s, sizeof(s), file) != NULL) {
+          s[strlen(s)-1] = '\0';
+          if ( (lines[n++] = strdup(s)) == NULL )
+               return EXIT_FAILURE;
+     }
+     fclose(file);
+
+     /* every line of the file in a number of variants plus comments, empty
+      * lines and an invalid atom */
+     size = REPEAT*(n*(1024+32)+64);
+     if ( (p = buf = malloc(size)) == NULL ||
+          (expline = malloc(sizeof(size_t)*REPEAT*(n+1))) == NULL ||
+          (expstr = malloc(sizeof(char *)*REPEAT*(n+1))) == NULL )
+          return EXIT_FAILURE;
+     for ( i=0, k=0; i < REPEAT; ++i ) {
+          for ( j=0; j < n; ++j, ++k ) {
+               switch ( k%4 ) {
+               case 0:
+                    p += sprintf(p, "%s\n", lines[j]);
+                    break;
+               case 1:
+                    p += sprintf(p, "\t %s -foo bar\n", lines[j]);
+                    break;
+               case 2:
+                    p += sprintf(p, "# comment\n\n%s\r\n", lines[j]);
+                    line += 2;
+                    break;
+               default:
+                    p += sprintf(p, "  \n%s", lines[j]);
+                    ++line;
+                    /* the last line does not need a newline */
+                    if ( i != REPEAT-1 || j != n-1 )
+                         *p++ = '\n';
+                    break;
+               }
+               expline[k] = ++line;
+               expstr[k] = lines[j];
+          }
+          p += sprintf(p, "cat/foo-\n");
+          expline[k] = ++line;
+          expstr[k++] = NULL;
+     }
+
+     if ( (batch = lpatom_parse_batch(buf, (size_t)(p-buf), 4)) == NULL )
+          return EXIT_FAILURE;
+     if ( batch->len != k || batch->failed != REPEAT ) {
+          printf("got %zu entries, %zu failed\n", batch->len, batch->failed);
+          has_failed = true;
+          k = 0;
+     }
+     for ( i=0; i < k; ++i ) {
+          e = &batch->entries[i];
+          if ( e->line != expline[i] ) {
+               printf("entry %zu: line %zu <> %zu\n", i, e->line, expline[i]);
+               has_failed = true;
+          }
+          if ( expstr[i] == NULL ) {
+               if ( e->error != EINVAL )
+                    has_failed = true;
+               continue;
+          }
+          if ( e->error != 0 ||
+               (sa = lpatom_compile(&e->atom)) == NULL ) {
+               has_failed = true;
+               continue;
+          }
+          /* the symbols interned by the workers are the process wide ones */
+          if ( e->atom.name_id != lputil_intern_lookup(e->atom.name,
+                    strlen(e->atom.name)) ||
+               e->atom.name != lputil_intern_str(e->atom.name_id) ||
+               (e->atom.cat != NULL &&
+                    (e->atom.cat_id != lputil_intern_lookup(e->atom.cat,
+                         strlen(e->atom.cat)) ||
+                     e->atom.cat != lputil_intern_str(e->atom.cat_id))) ) {
+               printf("entry %zu: symbol IDs differ\n", i);
+               has_failed = true;
+          }
+          if ( strcmp(sa, expstr[i]) != 0 ||
+               strncmp(buf+e->token.off, sa, e->token.len) != 0 ) {
+               printf("input: %s <> sa: %s\n", expstr[i], sa);
+               has_failed = true;
+          }
+          free(sa);
+     }
+     lpatom_batch_destroy(batch);
+
+     /* an empty buffer gives an empty batch */
+     if ( (batch = lpatom_parse_batch("", 0, 0)) == NULL || batch->len != 0 )
+          has_failed = true;
+     lpatom_batch_destroy(batch);
+
+     for ( j=0; j < n; ++j )
+          free(lines[j]);
+     free(expstr);
+     free(expline);
+     free(buf);
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
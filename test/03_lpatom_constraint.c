@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atom.h>
+#include <version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* the candidates are repeated, so that the filter works on several blocks */
+#define COPIES 4
+
+int main(void)
+{
+     lpatom_t *atom = NULL;
+     lpatom_constraint_t c;
+     lpversion_t version;
+     char s[1024], *ver, *exp;
+     uint8_t key[256], mask, *all, *masks;
+     const void *keys[1], **allkeys;
+     size_t len, *lens, n = 0, i;
+     bool has_failed = false;
+     FILE *file;
+
+     if ( (ver = getenv("srcdir")) != NULL )
+          if ( chdir(ver) == -1 )
+               return EXIT_FAILURE;
+     
+     if ( (file = fopen("03_lpatom_constraint.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+
+     if ( (atom = lpatom_create()) == NULL )
+          return EXIT_FAILURE;
+     lpatom_init(atom);
+     lpversion_init(&version);
+
+     while ( fgets(s, sizeof(s), file) != NULL) {
+          s[strlen(s)-1] = '\0';
+          if ( (ver = strchr(s, ' ')) == NULL ||
+               (exp = strchr(ver+1, ' ')) == NULL )
+               return EXIT_FAILURE;
+          *ver++ = '\0';
+          *exp++ = '\0';
+          if ( lpatom_parse(atom, s) == -1 ||
+               lpversion_parse(&version, ver) == -1 ||
+               lpatom_constraint_compile(&c, atom) == -1 ) {
+               printf("failed to parse: %s %s\n", s, ver);
+               return EXIT_FAILURE;
+          }
+          /* the single check and the filter must agree */
+          len = lpversion_key(&version, key, sizeof(key));
+          keys[0] = key;
+          if ( lpatom_constraint_match_version(&c, &version) != atoi(exp) ||
+               lpatom_constraint_filter(&c, keys, &len, 1, &mask) !=
+               (size_t)atoi(exp) || mask != atoi(exp) ) {
+               printf("wrong match: %s %s\n", s, ver);
+               has_failed = true;
+          }
+          lpatom_constraint_reset(&c);
+          lpversion_reset(&version);
+          lpatom_reset(atom);
+          ++n;
+     }
+
+     /* filtering all candidates at once agrees with single checks */
+     if ( (all = malloc(n*COPIES*sizeof(key))) == NULL ||
+          (allkeys = malloc(n*COPIES*sizeof(*allkeys))) == NULL ||
+          (lens = malloc(n*COPIES*sizeof(*lens))) == NULL ||
+          (masks = malloc(n*COPIES)) == NULL )
+          return EXIT_FAILURE;
+     rewind(file);
+     for ( i=0; fgets(s, sizeof(s), file) != NULL; ++i ) {
+          ver = strchr(s, ' ')+1;
+          *strchr(ver, ' ') = '\0';
+          if ( lpversion_parse(&version, ver) == -1 )
+               return EXIT_FAILURE;
+          allkeys[i] = all+i*sizeof(key);
+          lens[i] = lpversion_key(&version, all+i*sizeof(key), sizeof(key));
+          lpversion_reset(&version);
+     }
+     for ( i=n; i < n*COPIES; ++i ) {
+          allkeys[i] = allkeys[i%n];
+          lens[i] = lens[i%n];
+     }
+     rewind(file);
+     while ( fgets(s, sizeof(s), file) != NULL) {
+          *strchr(s, ' ') = '\0';
+          if ( lpatom_parse(atom, s) == -1 ||
+               lpatom_constraint_compile(&c, atom) == -1 )
+               return EXIT_FAILURE;
+          len = 0;
+          for ( i=0; i < n*COPIES; ++i )
+               len += (size_t)lpatom_constraint_match(&c, allkeys[i],
+                                                      lens[i]);
+          if ( lpatom_constraint_filter(&c, allkeys, lens, n*COPIES, masks)
+               != len )
+               has_failed = true;
+          for ( i=0; i < n*COPIES; ++i )
+               if ( masks[i] !=
+                    lpatom_constraint_match(&c, allkeys[i], lens[i]) ) {
+                    printf("wrong filter: %s\n", s);
+                    has_failed = true;
+               }
+          lpatom_constraint_reset(&c);
+          lpatom_reset(atom);
+     }
+     free(masks);
+     free(lens);
+     free(allkeys);
+     free(all);
+     lpatom_destroy(atom);
+     fclose(file);
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
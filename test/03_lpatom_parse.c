@@ -34,6 +34,25 @@
 #include <stdbool.h>
 #include <unistd.h>
 
+/* lpatom_compile_into() must truncate like snprintf(3) for every size */
+static bool
+compile_into_matches(const lpatom_t *atom, const char *s)
+{
+     char buf[1024];
+     size_t len = strlen(s), cap;
+
+     if ( lpatom_compile_into(atom, NULL, 0) != len )
+          return false;
+     for ( cap=1; cap <= len+1; ++cap ) {
+          memset(buf, 'x', sizeof(buf));
+          if ( lpatom_compile_into(atom, buf, cap) != len ||
+               strncmp(buf, s, cap-1) != 0 || buf[cap-1] != '\0' ||
+               buf[cap] != 'x' )
+               return false;
+     }
+     return true;
+}
+
 int main(void)
 {
      lpatom_t *atom1 = NULL;
@@ -72,6 +91,9 @@ int main(void)
                } else if ( strcmp(sa1, s) != 0 ) {
                     printf("input: %s <> sa1: %s\n", s, sa1);
                     has_failed = true;
+               } else if ( ! compile_into_matches(atom1, s) ) {
+                    printf("compile_into differs: %s\n", s);
+                    has_failed = true;
                }
           }
           lpatom_reset(atom1);
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atom.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define NSORT 20000
+
+int main(void)
+{
+     lpatom_t *atoms;
+     const lpatom_t **a, **b;
+     lputil_arena_t *arena;
+     char s[256];
+     bool has_failed = false;
+     unsigned int seed = 1, r;
+     size_t i;
+     int c;
+
+     if ( (atoms = malloc(NSORT*sizeof(*atoms))) == NULL ||
+          (a = malloc(NSORT*sizeof(*a))) == NULL ||
+          (b = malloc(NSORT*sizeof(*b))) == NULL ||
+          (arena = lputil_arena_create(0)) == NULL )
+          return EXIT_FAILURE;
+
+     /* few distinct atoms, so that there are many equal ones */
+     for ( i=0; i < NSORT; ++i ) {
+          seed = seed*1103515245+12345;
+          r = seed >> 8;
+          snprintf(s, sizeof(s), "=cat-%u/pkg%u-%u.%u%s", r%3, (r>>2)%5,
+                   (r>>5)%11, (r>>9)%3, (r>>11)%2 ? "-r1" : "");
+          lpatom_init_arena(&atoms[i], arena);
+          if ( lpatom_parse(&atoms[i], s) == -1 )
+               return EXIT_FAILURE;
+          a[i] = b[i] = &atoms[i];
+     }
+
+     if ( lpatom_sort(a, NSORT, 4) == -1 || lpatom_sort(b, NSORT, 1) == -1 )
+          return EXIT_FAILURE;
+     for ( i=1; i < NSORT; ++i ) {
+          /* equal atoms must keep the order of the input */
+          c = lpatom_cmp(a[i-1], a[i]);
+          if ( c > 0 || (c == 0 && a[i-1] > a[i]) ) {
+               printf("not sorted at %zu\n", i);
+               has_failed = true;
+          }
+     }
+     if ( memcmp(a, b, NSORT*sizeof(*a)) != 0 ) {
+          printf("threads changed the order\n");
+          has_failed = true;
+     }
+
+     lputil_arena_destroy(arena);
+     free(atoms);
+     free(a);
+     free(b);
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
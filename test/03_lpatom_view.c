@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atom.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+/* a missing part must be missing in both, an existing one equal */
+static bool
+field_matches(const lpatom_view_t *view, const lpatom_field_t *field,
+              const char *s)
+{
+     if ( s == NULL )
+          return field->len == 0;
+     return lpatom_view_eq(view, field, s) != 0;
+}
+
+int main(void)
+{
+     lpatom_t *atom = NULL;
+     lpatom_view_t view;
+     lpversion_t version;
+     char s[1024], buf[2048], *srcpath, *cat;
+     bool has_failed = false;
+     size_t len;
+     FILE *file;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+     
+     if ( (file = fopen("03_lpatom_parse.txt", "r")) == NULL )
+          return EXIT_FAILURE;
+
+     if ( (atom = lpatom_create()) == NULL )
+          return EXIT_FAILURE;
+     lpatom_init(atom);
+     lpversion_init(&version);
+
+     while ( fgets(s, sizeof(s), file) != NULL) {
+          s[strlen(s)-1] = '\0';
+          /* the view must not read past the given length */
+          len = strlen(s);
+          memcpy(buf, s, len);
+          strcpy(buf+len, "-1.0:2[x]");
+          if ( lpatom_parse(atom, s) == -1 ||
+               lpatom_view_parse(&view, buf, len) == -1 ) {
+               printf("failed to parse: %s\n", s);
+               has_failed = true;
+               lpatom_reset(atom);
+               continue;
+          }
+          if ( ! field_matches(&view, &view.cat, atom->cat) ||
+               ! field_matches(&view, &view.name, atom->name) ||
+               ! field_matches(&view, &view.slot, atom->slot) ||
+               ! field_matches(&view, &view.subslot, atom->subslot) ||
+               ! field_matches(&view, &view.repo, atom->repo) ||
+               (view.use.len != 0) != (atom->use_len != 0) ||
+               view.op != atom->op || view.blocker != atom->blocker ||
+               view.slotop != atom->slotop ) {
+               printf("view differs: %s\n", s);
+               has_failed = true;
+          }
+          if ( atom->cat != NULL ) {
+               if ( (cat = lpatom_view_strdup(&view, &view.cat)) == NULL ||
+                    strcmp(cat, atom->cat) != 0 )
+                    has_failed = true;
+               free(cat);
+          }
+          if ( atom->version != NULL ) {
+               if ( lpatom_view_version(&view, &version) == -1 ||
+                    lpversion_cmp(&version, atom->version) != 0 )
+                    has_failed = true;
+               lpversion_reset(&version);
+          } else if ( lpatom_view_version(&view, &version) != -1 )
+               has_failed = true;
+          lpatom_reset(atom);
+     }
+     lpatom_destroy(atom);
+     fclose(file);
+     if ( has_failed )
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+
+int
+main(void)
+{
+     char *path = "04_lpxpak.tbz2";
+     char *srcpath;
+     lputil_arena_t *arena;
+     lputil_alloc_t alloc;
+     lputil_memstat_t st;
+     lpxpak_t *xpak, *mapped, *plain;
+     lpxpak_blob_t *blob;
+     lpxpak_entry_t *e;
+     bool has_failed = false;
+     int fd, i;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (fd = open(path, O_RDONLY)) == -1 )
+          return EXIT_FAILURE;
+     if ( (blob = lpxpak_blob_get_fd(fd)) == NULL ||
+          (plain = lpxpak_create()) == NULL ||
+          (arena = lputil_arena_create(0)) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(plain);
+     if ( lpxpak_parse_data(plain, blob) == -1 )
+          return EXIT_FAILURE;
+     lputil_alloc_init_arena(&alloc, arena);
+
+     /* handles, entries, names, values and the hash table all come from the
+      * arena, nothing is taken from malloc */
+     lputil_mem_stat_reset();
+     lputil_mem_set_counting(1);
+     for ( i=0; i < 100; ++i ) {
+          if ( (xpak = lpxpak_create_alloc(&alloc)) == NULL )
+               return EXIT_FAILURE;
+          lpxpak_init_arena(xpak, arena);
+          if ( lpxpak_parse_data(xpak, blob) == -1 ||
+               xpak->size != plain->size )
+               return EXIT_FAILURE;
+          if ( (e = lpxpak_get(xpak, "CATEGORY")) == NULL ||
+               e->value_len != 10 || memcmp(e->value, "sys-devel\n", 10) != 0 )
+               has_failed = true;
+          if ( lpxpak_get(xpak, "NO_SUCH_KEY") != NULL )
+               has_failed = true;
+     }
+     lputil_mem_set_counting(0);
+     if ( lputil_mem_stat(LPUTIL_MEM_XPAK, &st) == -1 || st.allocs != 0 ||
+          st.frees != 0 )
+          has_failed = true;
+
+     /* the mapping of a parsed file is still removed by destroying */
+     if ( (mapped = lpxpak_create_alloc(&alloc)) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init_arena(mapped, arena);
+     if ( lpxpak_parse_fd(mapped, fd) == -1 || mapped->blob == NULL ||
+          mapped->size != plain->size )
+          return EXIT_FAILURE;
+     for ( i=0; i < (int)plain->size; ++i )
+          if ( strcmp(mapped->entries[i].name, plain->entries[i].name) != 0 ||
+               mapped->entries[i].value_len != plain->entries[i].value_len ||
+               memcmp(mapped->entries[i].value, plain->entries[i].value,
+                      plain->entries[i].value_len) != 0 )
+               has_failed = true;
+     lpxpak_destroy_alloc(mapped, &alloc);
+     (void)close(fd);
+
+     lputil_arena_destroy(arena);
+     lpxpak_destroy(plain);
+     lpxpak_blob_destroy(blob);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+
+int
+main(void)
+{
+     const char *keys[] = { "CATEGORY", "PF", "SLOT", "USE", "IUSE",
+                            "KEYWORDS", "RDEPEND", "CFLAGS", "NO_SUCH_KEY",
+                            "" };
+     const size_t nkeys = sizeof(keys)/sizeof(keys[0]);
+     char *path = "04_lpxpak.tbz2";
+     char *srcpath;
+     lpxpak_entry_t *found[sizeof(keys)/sizeof(keys[0])];
+     lpxpak_entry_t *e;
+     lpxpak_t *xpak;
+     bool has_failed = false;
+     char *name;
+     size_t i, n;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (xpak = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(xpak);
+     if ( lpxpak_parse_path(xpak, path) == -1 )
+          return EXIT_FAILURE;
+
+     /* the table is built by the first lookup */
+     if ( xpak->lookup != NULL )
+          has_failed = true;
+     if ( (e = lpxpak_get(xpak, "CFLAGS")) != &xpak->entries[22] )
+          has_failed = true;
+     if ( xpak->lookup == NULL )
+          has_failed = true;
+
+     /* every entry is found by its name */
+     for ( i=0; i < xpak->size; ++i ) {
+          e = lpxpak_get(xpak, xpak->entries[i].name);
+          if ( e == NULL || strcmp(e->name, xpak->entries[i].name) != 0 )
+               has_failed = true;
+     }
+     if ( lpxpak_get(xpak, "NO_SUCH_KEY") != NULL ||
+          lpxpak_get(xpak, "") != NULL )
+          has_failed = true;
+
+     /* a bulk lookup gives the same entries as single ones */
+     n = lpxpak_get_n(xpak, keys, nkeys, found);
+     for ( i=0; i < nkeys; ++i ) {
+          if ( found[i] != lpxpak_get(xpak, (char *)keys[i]) )
+               has_failed = true;
+          if ( found[i] == NULL )
+               ++n;
+     }
+     if ( n != nkeys || found[7] == NULL || found[8] != NULL )
+          has_failed = true;
+
+     /* entries changed by hand are found after the table was dropped */
+     name = xpak->entries[0].name;
+     xpak->entries[0].name = "RENAMED";
+     lpxpak_reindex(xpak);
+     if ( lpxpak_get(xpak, "RENAMED") != &xpak->entries[0] ||
+          lpxpak_get(xpak, name) == &xpak->entries[0] )
+          has_failed = true;
+     xpak->entries[0].name = name;
+
+     lpxpak_destroy(xpak);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
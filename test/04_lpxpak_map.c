@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+
+int
+main(void)
+{
+     char *path = "04_lpxpak.tbz2";
+     char *srcpath;
+     lpxpak_t *mapped, *copied;
+     lpxpak_blob_t *map, *read;
+     bool has_failed = false;
+     uint8_t *lo, *hi, *v;
+     size_t i;
+     int fd;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (fd = open(path, O_RDONLY)) == -1 )
+          return EXIT_FAILURE;
+     if ( (map = lpxpak_blob_map_fd(fd)) == NULL ||
+          (read = lpxpak_blob_get_fd(fd)) == NULL )
+          return EXIT_FAILURE;
+
+     /* the mapping holds the same bytes as the copy */
+     if ( map->map == NULL || read->map != NULL || map->len != read->len ||
+          memcmp(map->data, read->data, map->len) != 0 )
+          has_failed = true;
+
+     if ( (mapped = lpxpak_create()) == NULL ||
+          (copied = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(mapped);
+     lpxpak_init(copied);
+     if ( lpxpak_parse_fd(mapped, fd) == -1 ||
+          lpxpak_parse_data(copied, read) == -1 )
+          return EXIT_FAILURE;
+     (void)close(fd);
+
+     /* the values of a parsed file point into its mapping, which outlives
+      * the file descriptor */
+     if ( mapped->blob == NULL || mapped->data != NULL ||
+          copied->blob != NULL || copied->data == NULL ||
+          mapped->size != copied->size )
+          return EXIT_FAILURE;
+     lo = mapped->blob->data;
+     hi = lo + mapped->blob->len;
+     for ( i=0; i < mapped->size; ++i ) {
+          v = mapped->entries[i].value;
+          if ( v < lo || v + mapped->entries[i].value_len > hi )
+               has_failed = true;
+          if ( strcmp(mapped->entries[i].name, copied->entries[i].name) != 0 ||
+               mapped->entries[i].value_len != copied->entries[i].value_len ||
+               memcmp(v, copied->entries[i].value,
+                      copied->entries[i].value_len) != 0 )
+               has_failed = true;
+     }
+
+     /* a file without a xpak is rejected */
+     if ( (fd = open("04_lpxpak_map.c", O_RDONLY)) == -1 )
+          return EXIT_FAILURE;
+     if ( lpxpak_blob_map_fd(fd) != NULL )
+          has_failed = true;
+     (void)close(fd);
+
+     lpxpak_destroy(mapped);
+     lpxpak_destroy(copied);
+     lpxpak_blob_destroy(map);
+     lpxpak_blob_destroy(read);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
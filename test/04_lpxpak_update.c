@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+static void *
+slurp(const char *path, size_t *len)
+{
+     struct stat st;
+     void *buf;
+     int fd;
+
+     if ( (fd = open(path, O_RDONLY)) == -1 )
+          return NULL;
+     if ( fstat(fd, &st) == -1 || (buf = malloc(st.st_size)) == NULL ||
+          read(fd, buf, st.st_size) != st.st_size )
+          return NULL;
+     (void)close(fd);
+     *len = st.st_size;
+     return buf;
+}
+
+/* writes the journal an update of the xpak at start leaves behind when it
+ * dies after the journal was synced: the magic, the offset and length of the
+ * saved bytes in network byte order, the bytes and their FNV-1a hash */
+static int
+journal_write(int jfd, const uint8_t *pkg, size_t start, size_t len)
+{
+     uint8_t head[24], sum[8];
+     uint64_t h = 14695981039346656037ULL;
+     size_t i;
+
+     memcpy(head, "XPAKJRNL", 8);
+     for ( i=0; i < 8; ++i ) {
+          head[8+i] = (uint8_t)((uint64_t)start >> (56-8*i));
+          head[16+i] = (uint8_t)((uint64_t)len >> (56-8*i));
+     }
+     for ( i=0; i < sizeof(head); ++i ) {
+          h ^= head[i];
+          h *= 1099511628211ULL;
+     }
+     for ( i=0; i < len; ++i ) {
+          h ^= pkg[start+i];
+          h *= 1099511628211ULL;
+     }
+     for ( i=0; i < 8; ++i )
+          sum[i] = (uint8_t)(h >> (56-8*i));
+     if ( ftruncate(jfd, 0) == -1 ||
+          pwrite(jfd, head, sizeof(head), 0) != (ssize_t)sizeof(head) ||
+          pwrite(jfd, pkg+start, len, sizeof(head)) != (ssize_t)len ||
+          pwrite(jfd, sum, sizeof(sum), sizeof(head)+len) !=
+          (ssize_t)sizeof(sum) )
+          return -1;
+     return 0;
+}
+
+static bool
+same_values(const lpxpak_t *a, const lpxpak_t *b)
+{
+     size_t i;
+
+     if ( a->size != b->size )
+          return false;
+     for ( i=0; i < a->size; ++i )
+          if ( a->entries[i].value_len != b->entries[i].value_len ||
+               memcmp(a->entries[i].value, b->entries[i].value,
+                      a->entries[i].value_len) != 0 )
+               return false;
+     return true;
+}
+
+int
+main(void)
+{
+     char *path = "04_lpxpak.tbz2";
+     char tmp[] = "/tmp/04_lpxpak_update.XXXXXX";
+     char jpath[sizeof(tmp)+sizeof(".xpak-journal")];
+     char *srcpath;
+     lpxpak_t *orig, *xpak, *reader;
+     lpxpak_entry_t *e;
+     uint8_t *pkg, *now, *now2, *grown;
+     char big[20000];
+     bool has_failed = false;
+     size_t pkg_len, now_len, now2_len, grown_len, tar_len;
+     off_t jlen;
+     int fd, jfd;
+     char c;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     /* work on a copy of the package */
+     if ( (pkg = slurp(path, &pkg_len)) == NULL ||
+          (fd = mkstemp(tmp)) == -1 )
+          return EXIT_FAILURE;
+     if ( write(fd, pkg, pkg_len) != (ssize_t)pkg_len )
+          return EXIT_FAILURE;
+     (void)close(fd);
+     (void)snprintf(jpath, sizeof(jpath), "%s.xpak-journal", tmp);
+
+     if ( (orig = lpxpak_create()) == NULL ||
+          (xpak = lpxpak_create()) == NULL ||
+          (reader = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(orig);
+     lpxpak_init(xpak);
+     lpxpak_init(reader);
+     if ( lpxpak_parse_path(orig, path) == -1 ||
+          lpxpak_parse_path(xpak, tmp) == -1 ||
+          lpxpak_parse_path(reader, tmp) == -1 )
+          return EXIT_FAILURE;
+     tar_len = pkg_len - orig->blob->len - 8;
+
+     /* a shorter value, the handle was parsed from the file it updates */
+     if ( (e = lpxpak_get(xpak, "CATEGORY")) == NULL )
+          return EXIT_FAILURE;
+     e->value = "app-misc\n";
+     e->value_len = 9;
+     if ( lpxpak_update_path(xpak, tmp) == -1 )
+          return EXIT_FAILURE;
+     /* the package was replaced, handles still read the old file */
+     if ( ! same_values(reader, orig) )
+          has_failed = true;
+     lpxpak_destroy(reader);
+     lpxpak_destroy(xpak);
+     if ( (xpak = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(xpak);
+     if ( lpxpak_parse_path(xpak, tmp) == -1 ||
+          (now = slurp(tmp, &now_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now_len != pkg_len-1 || memcmp(now, pkg, tar_len) != 0 ||
+          xpak->size != orig->size ||
+          (e = lpxpak_get(xpak, "CATEGORY")) == NULL ||
+          e->value_len != 9 || memcmp(e->value, "app-misc\n", 9) != 0 ||
+          (e = lpxpak_get(xpak, "PF")) == NULL || e->value_len != 14 )
+          has_failed = true;
+     free(now);
+
+     /* a longer value */
+     memset(big, 'x', sizeof(big));
+     e = lpxpak_get(xpak, "USE");
+     e->value = big;
+     e->value_len = sizeof(big);
+     if ( lpxpak_update_path(xpak, tmp) == -1 ||
+          (grown = slurp(tmp, &grown_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( grown_len != pkg_len-1-2178+sizeof(big) ||
+          memcmp(grown, pkg, tar_len) != 0 )
+          has_failed = true;
+     lpxpak_destroy(xpak);
+
+     /* in place, a handle mapped from the file keeps working after the file
+      * was cut short */
+     if ( (xpak = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(xpak);
+     if ( (fd = open(tmp, O_RDWR)) == -1 ||
+          (jfd = open(jpath, O_RDWR|O_CREAT|O_EXCL, 0600)) == -1 ||
+          lpxpak_parse_fd(xpak, fd) == -1 )
+          return EXIT_FAILURE;
+     e = lpxpak_get(xpak, "USE");
+     e->value = orig->entries[0].value;
+     e->value_len = orig->entries[0].value_len;
+     if ( lpxpak_update_fd(xpak, fd, jfd) == -1 )
+          return EXIT_FAILURE;
+     if ( xpak->blob != NULL || (e = lpxpak_get(xpak, "CATEGORY")) == NULL ||
+          e->value_len != 9 || memcmp(e->value, "app-misc\n", 9) != 0 )
+          has_failed = true;
+     e = lpxpak_get(xpak, "CATEGORY");
+     e->value = orig->entries[17].value;
+     e->value_len = orig->entries[17].value_len;
+     if ( ! same_values(xpak, orig) )
+          has_failed = true;
+     if ( (now = slurp(tmp, &now_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now_len != pkg_len-1 )
+          has_failed = true;
+
+     /* the journal of a finished update is empty and recovering is a no-op */
+     if ( lseek(jfd, 0, SEEK_END) != 0 || lpxpak_recover_fd(fd, jfd) != 0 )
+          has_failed = true;
+     free(now);
+     if ( (now = slurp(tmp, &now_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now_len != pkg_len-1 )
+          has_failed = true;
+
+     /* an update that died after its journal was synced is undone, unless a
+      * saved byte did not reach the disk and fails the checksum */
+     if ( journal_write(jfd, grown, tar_len, grown_len-tar_len) == -1 ||
+          pread(jfd, &c, 1, 100) != 1 )
+          return EXIT_FAILURE;
+     c ^= 0x20;
+     if ( pwrite(jfd, &c, 1, 100) != 1 )
+          return EXIT_FAILURE;
+     if ( lpxpak_recover_fd(fd, jfd) != 0 ||
+          (now2 = slurp(tmp, &now2_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now2_len != now_len || memcmp(now2, now, now_len) != 0 )
+          has_failed = true;
+     free(now2);
+     c ^= 0x20;
+     if ( pwrite(jfd, &c, 1, 100) != 1 )
+          return EXIT_FAILURE;
+     if ( lpxpak_recover_fd(fd, jfd) != 1 ||
+          (now2 = slurp(tmp, &now2_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now2_len != grown_len || memcmp(now2, grown, grown_len) != 0 )
+          has_failed = true;
+     free(now2);
+     free(now);
+     now = NULL;
+
+     /* a journal of the right size that holds only zeros was never synced,
+      * neither was one that was not completely written */
+     jlen = lseek(jfd, 0, SEEK_END);
+     if ( ftruncate(jfd, 0) == -1 || ftruncate(jfd, jlen) == -1 )
+          return EXIT_FAILURE;
+     if ( lpxpak_recover_fd(fd, jfd) != 0 )
+          has_failed = true;
+     if ( ftruncate(jfd, 0) == -1 || pwrite(jfd, "XPA", 3, 0) != 3 )
+          return EXIT_FAILURE;
+     if ( lpxpak_recover_fd(fd, jfd) != 0 ||
+          (now = slurp(tmp, &now_len)) == NULL )
+          has_failed = true;
+     else if ( now_len != grown_len || memcmp(now, grown, grown_len) != 0 )
+          has_failed = true;
+     free(now);
+     (void)close(jfd);
+     (void)unlink(jpath);
+     (void)close(fd);
+
+     /* and the original xpak gives back the original package */
+     if ( lpxpak_update_path(orig, tmp) == -1 ||
+          (now = slurp(tmp, &now_len)) == NULL )
+          return EXIT_FAILURE;
+     if ( now_len != pkg_len || memcmp(now, pkg, pkg_len) != 0 )
+          has_failed = true;
+     free(now);
+
+     (void)unlink(tmp);
+     lpxpak_destroy(orig);
+     lpxpak_destroy(xpak);
+     free(grown);
+     free(pkg);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+#include <util.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+int
+main(void)
+{
+     char *path = "04_lpxpak.tbz2";
+     char *srcpath;
+     lpxpak_t *view, *copied, *bad;
+     lpxpak_blob_t *blob, *compiled;
+     lpxpak_entry_t *e;
+     lputil_memstat_t st;
+     bool has_failed = false;
+     uint8_t *lo, *hi, *p;
+     size_t i;
+     int fd;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (fd = open(path, O_RDONLY)) == -1 )
+          return EXIT_FAILURE;
+     if ( (blob = lpxpak_blob_get_fd(fd)) == NULL )
+          return EXIT_FAILURE;
+     (void)close(fd);
+     if ( (view = lpxpak_create()) == NULL ||
+          (copied = lpxpak_create()) == NULL ||
+          (bad = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(view);
+     lpxpak_init(copied);
+     lpxpak_init(bad);
+
+     /* a view costs a single allocation */
+     lputil_mem_set_counting(1);
+     if ( lpxpak_parse_view(view, blob) == -1 )
+          return EXIT_FAILURE;
+     lputil_mem_set_counting(0);
+     if ( lputil_mem_stat(LPUTIL_MEM_XPAK, &st) == -1 || st.allocs != 1 )
+          has_failed = true;
+     if ( lpxpak_parse_data(copied, blob) == -1 )
+          return EXIT_FAILURE;
+
+     /* names and values point into the blob and match the copies */
+     lo = blob->data;
+     hi = lo + blob->len;
+     if ( ! view->borrowed || copied->borrowed ||
+          view->size != copied->size )
+          return EXIT_FAILURE;
+     for ( i=0; i < view->size; ++i ) {
+          e = &view->entries[i];
+          p = (uint8_t *)e->name;
+          if ( p < lo || p + e->name_len > hi )
+               has_failed = true;
+          p = e->value;
+          if ( p < lo || p + e->value_len > hi )
+               has_failed = true;
+          if ( e->name_len != strlen(copied->entries[i].name) ||
+               memcmp(e->name, copied->entries[i].name, e->name_len) != 0 ||
+               e->value_len != copied->entries[i].value_len ||
+               memcmp(e->value, copied->entries[i].value, e->value_len) != 0 )
+               has_failed = true;
+     }
+
+     /* keys are found in views although the names are not terminated */
+     if ( (e = lpxpak_get(view, "CFLAGS")) == NULL ||
+          e != &view->entries[22] )
+          has_failed = true;
+     if ( (e = lpxpak_get(view, "USE")) == NULL || e != &view->entries[0] )
+          has_failed = true;
+     if ( lpxpak_get(view, "CFLAG") != NULL ||
+          lpxpak_get(view, "NO_SUCH_KEY") != NULL )
+          has_failed = true;
+
+     /* a view compiles into the blob it was parsed from */
+     if ( (compiled = lpxpak_blob_compile(view)) == NULL )
+          return EXIT_FAILURE;
+     if ( compiled->len != blob->len ||
+          memcmp(compiled->data, blob->data, blob->len) != 0 )
+          has_failed = true;
+
+     /* a name that runs past the index is rejected, the length of the first
+      * name follows the magic and the two lengths */
+     memset((uint8_t *)compiled->data+16, 0xff, 4);
+     errno = 0;
+     if ( lpxpak_parse_view(bad, compiled) != -1 || errno != EINVAL )
+          has_failed = true;
+
+     lpxpak_destroy(view);
+     lpxpak_destroy(copied);
+     lpxpak_destroy(bad);
+
+     /* handles and everything they own are freed under the same subsystem
+      * they were allocated under */
+     lputil_mem_stat_reset();
+     lputil_mem_set_counting(1);
+     for ( i=0; i < 10; ++i ) {
+          if ( (view = i % 2 ? lpxpak_create() : lpxpak_create_alloc(NULL))
+               == NULL )
+               return EXIT_FAILURE;
+          lpxpak_init(view);
+          if ( (i % 4 < 2 ? lpxpak_parse_view(view, blob) :
+                lpxpak_parse_data(view, blob)) == -1 ||
+               lpxpak_get(view, "CFLAGS") == NULL )
+               has_failed = true;
+          if ( i % 2 )
+               lpxpak_destroy(view);
+          else
+               lpxpak_destroy_alloc(view, NULL);
+     }
+     lputil_mem_set_counting(0);
+     if ( lputil_mem_stat(LPUTIL_MEM_XPAK, &st) == -1 || st.allocs == 0 ||
+          st.allocs != st.frees )
+          has_failed = true;
+     if ( lputil_mem_stat(LPUTIL_MEM_UTIL, &st) == -1 ||
+          st.allocs != st.frees )
+          has_failed = true;
+     lpxpak_blob_destroy(compiled);
+     lpxpak_blob_destroy(blob);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2009 Lars Hartmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *      
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <xpak.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* more entries than writev(2) takes iovecs at once */
+#define NENTRIES 3000
+
+int
+main(void)
+{
+     char *path = "04_lpxpak.tbz2";
+     char *srcpath;
+     lpxpak_t *xpak, *many, *back;
+     lpxpak_blob_t *blob, *compiled;
+     lpxpak_entry_t *entries;
+     char names[NENTRIES][16];
+     char *buf;
+     bool has_failed = false;
+     FILE *f;
+     size_t i;
+     int fd;
+
+     if ( (srcpath = getenv("srcdir")) != NULL )
+          if ( chdir(srcpath) == -1 )
+               return EXIT_FAILURE;
+
+     if ( (xpak = lpxpak_create()) == NULL ||
+          (back = lpxpak_create()) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(xpak);
+     lpxpak_init(back);
+     if ( (fd = open(path, O_RDONLY)) == -1 )
+          return EXIT_FAILURE;
+     if ( lpxpak_parse_fd(xpak, fd) == -1 ||
+          (blob = lpxpak_blob_get_fd(fd)) == NULL )
+          return EXIT_FAILURE;
+     (void)close(fd);
+
+     /* without the trailer the file holds exactly the compiled blob */
+     if ( (compiled = lpxpak_blob_compile(xpak)) == NULL )
+          return EXIT_FAILURE;
+     if ( compiled->len != blob->len ||
+          memcmp(compiled->data, blob->data, blob->len) != 0 )
+          has_failed = true;
+     if ( (f = tmpfile()) == NULL || (buf = malloc(blob->len)) == NULL )
+          return EXIT_FAILURE;
+     fd = fileno(f);
+     if ( lpxpak_write_fd(xpak, fd, 0) == -1 )
+          return EXIT_FAILURE;
+     if ( lseek(fd, 0, SEEK_END) != (off_t)blob->len ||
+          pread(fd, buf, blob->len, 0) != (ssize_t)blob->len ||
+          memcmp(buf, blob->data, blob->len) != 0 )
+          has_failed = true;
+
+     /* with the trailer it can be read back like a binary package */
+     if ( ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) == -1 )
+          return EXIT_FAILURE;
+     if ( write(fd, "tarball", 7) != 7 ||
+          lpxpak_write_fd(xpak, fd, 1) == -1 )
+          return EXIT_FAILURE;
+     lpxpak_blob_destroy(compiled);
+     if ( (compiled = lpxpak_blob_get_fd(fd)) == NULL )
+          return EXIT_FAILURE;
+     if ( compiled->len != blob->len ||
+          memcmp(compiled->data, blob->data, blob->len) != 0 )
+          has_failed = true;
+     (void)fclose(f);
+
+     /* a xpak with many entries is written in several writev calls */
+     if ( (many = lpxpak_create()) == NULL ||
+          (entries = malloc(sizeof(lpxpak_entry_t)*NENTRIES)) == NULL )
+          return EXIT_FAILURE;
+     lpxpak_init(many);
+     for ( i=0; i < NENTRIES; ++i ) {
+          (void)snprintf(names[i], sizeof(names[i]), "KEY%zu", i);
+          entries[i].name = names[i];
+          entries[i].value = names[i];
+          entries[i].value_len = i % 3 == 0 ? 0 : strlen(names[i]);
+     }
+     many->entries = entries;
+     many->size = NENTRIES;
+     if ( (f = tmpfile()) == NULL )
+          return EXIT_FAILURE;
+     fd = fileno(f);
+     if ( lpxpak_write_fd(many, fd, 1) == -1 ||
+          lpxpak_parse_fd(back, fd) == -1 )
+          return EXIT_FAILURE;
+     (void)fclose(f);
+     if ( back->size != NENTRIES )
+          has_failed = true;
+     for ( i=0; i < back->size && i < NENTRIES; ++i )
+          if ( strcmp(back->entries[i].name, names[i]) != 0 ||
+               back->entries[i].value_len != entries[i].value_len ||
+               memcmp(back->entries[i].value, names[i],
+                      entries[i].value_len) != 0 )
+               has_failed = true;
+
+     lpxpak_destroy(xpak);
+     lpxpak_destroy(back);
+     free(entries);
+     free(many);
+     free(buf);
+     lpxpak_blob_destroy(blob);
+     lpxpak_blob_destroy(compiled);
+     if (has_failed)
+          return EXIT_FAILURE;
+     return EXIT_SUCCESS;
+}